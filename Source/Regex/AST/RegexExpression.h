@@ -33,6 +33,13 @@ namespace vl
 	{
 		class IRegexExpressionAlgorithm;
 
+		// shapes in an expression making the backtracking interpretor take exponential time, found by Expression::AnalyzeComplexity
+		struct ExpressionComplexity
+		{
+			vint						nestedQuantifiers = 0;			// repeating loops containing another repeating loop
+			vint						overlappingAlternations = 0;	// alternations in a repeating loop whose branches could start with the same char
+		};
+
 /***********************************************************************
 Regex Expression AST
 ***********************************************************************/
@@ -48,7 +55,10 @@ Regex Expression AST
 			virtual void				Apply(IRegexExpressionAlgorithm& algorithm)=0;
 			bool						IsEqual(Expression* expression);
 			bool						HasNoExtension();
+			bool						IsLiteral(U32String& text);
 			bool						CanTreatAsPure();
+			Ptr<Expression>				RelaxToPure();
+			void						AnalyzeComplexity(ExpressionComplexity& complexity);
 			void						NormalizeCharSet(CharRange::List& subsets);
 			void						CollectCharSet(CharRange::List& subsets);
 			void						ApplyCharSet(CharRange::List& subsets);
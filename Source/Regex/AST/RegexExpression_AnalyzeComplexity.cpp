@@ -0,0 +1,207 @@
+/***********************************************************************
+Author: Zihan Chen (vczh)
+Licensed under https://github.com/vczh-libraries/License
+***********************************************************************/
+
+#include "RegexExpression.h"
+
+namespace vl
+{
+	namespace regex_internal
+	{
+
+/***********************************************************************
+FirstCharSetAlgorithm
+***********************************************************************/
+
+		// collects chars that the expression could start with, returns true if the expression could match an empty string
+		// char sets should have been normalized, so no reversed char set remains
+		class FirstCharSetAlgorithm : public RegexExpressionAlgorithm<bool, CharRange::List*>
+		{
+		public:
+			bool Apply(CharSetExpression* expression, CharRange::List* target) override
+			{
+				for (auto range : expression->ranges)
+				{
+					if (!target->Contains(range))
+					{
+						target->Add(range);
+					}
+				}
+				return false;
+			}
+
+			bool Apply(LoopExpression* expression, CharRange::List* target) override
+			{
+				bool nullable = Invoke(expression->expression, target);
+				return nullable || expression->min == 0;
+			}
+
+			bool Apply(SequenceExpression* expression, CharRange::List* target) override
+			{
+				return Invoke(expression->left, target) && Invoke(expression->right, target);
+			}
+
+			bool Apply(AlternateExpression* expression, CharRange::List* target) override
+			{
+				bool left = Invoke(expression->left, target);
+				bool right = Invoke(expression->right, target);
+				return left || right;
+			}
+
+			bool Apply(BeginExpression* expression, CharRange::List* target) override
+			{
+				return true;
+			}
+
+			bool Apply(EndExpression* expression, CharRange::List* target) override
+			{
+				return true;
+			}
+
+			bool Apply(CaptureExpression* expression, CharRange::List* target) override
+			{
+				return Invoke(expression->expression, target);
+			}
+
+			bool Apply(MatchExpression* expression, CharRange::List* target) override
+			{
+				// the captured text is unknown
+				return true;
+			}
+
+			bool Apply(PositiveExpression* expression, CharRange::List* target) override
+			{
+				return true;
+			}
+
+			bool Apply(NegativeExpression* expression, CharRange::List* target) override
+			{
+				return true;
+			}
+
+			bool Apply(UsingExpression* expression, CharRange::List* target) override
+			{
+				CHECK_FAIL(L"FirstCharSetAlgorithm::Apply(UsingExpression*, CharRange::List*)#UsingExpression should have been merged.");
+			}
+		};
+
+/***********************************************************************
+AnalyzeComplexityAlgorithm
+***********************************************************************/
+
+		// the argument is true if the expression is in a repeating loop
+		// returns true if the expression contains a repeating loop
+		class AnalyzeComplexityAlgorithm : public RegexExpressionAlgorithm<bool, bool>
+		{
+		public:
+			ExpressionComplexity&		complexity;
+
+			AnalyzeComplexityAlgorithm(ExpressionComplexity& _complexity)
+				: complexity(_complexity)
+			{
+			}
+
+			static bool Overlaps(const CharRange::List& a, const CharRange::List& b)
+			{
+				for (auto x : a)
+				{
+					for (auto y : b)
+					{
+						if (x.begin <= y.end && y.begin <= x.end)
+						{
+							return true;
+						}
+					}
+				}
+				return false;
+			}
+
+			bool Apply(CharSetExpression* expression, bool repeating) override
+			{
+				return false;
+			}
+
+			bool Apply(LoopExpression* expression, bool repeating) override
+			{
+				bool loop = expression->max == -1 || expression->max > 1;
+				bool nested = Invoke(expression->expression, repeating || loop);
+				if (loop && nested)
+				{
+					// e.g. (a+)+, a string could be split between the two loops in exponential ways
+					complexity.nestedQuantifiers++;
+				}
+				return loop || nested;
+			}
+
+			bool Apply(SequenceExpression* expression, bool repeating) override
+			{
+				bool left = Invoke(expression->left, repeating);
+				bool right = Invoke(expression->right, repeating);
+				return left || right;
+			}
+
+			bool Apply(AlternateExpression* expression, bool repeating) override
+			{
+				if (repeating)
+				{
+					// e.g. (a|ab)*, each iteration could try both branches for the same char
+					CharRange::List left, right;
+					FirstCharSetAlgorithm().Invoke(expression->left, &left);
+					FirstCharSetAlgorithm().Invoke(expression->right, &right);
+					if (Overlaps(left, right))
+					{
+						complexity.overlappingAlternations++;
+					}
+				}
+				bool left = Invoke(expression->left, repeating);
+				bool right = Invoke(expression->right, repeating);
+				return left || right;
+			}
+
+			bool Apply(BeginExpression* expression, bool repeating) override
+			{
+				return false;
+			}
+
+			bool Apply(EndExpression* expression, bool repeating) override
+			{
+				return false;
+			}
+
+			bool Apply(CaptureExpression* expression, bool repeating) override
+			{
+				return Invoke(expression->expression, repeating);
+			}
+
+			bool Apply(MatchExpression* expression, bool repeating) override
+			{
+				return false;
+			}
+
+			bool Apply(PositiveExpression* expression, bool repeating) override
+			{
+				return Invoke(expression->expression, repeating);
+			}
+
+			bool Apply(NegativeExpression* expression, bool repeating) override
+			{
+				return Invoke(expression->expression, repeating);
+			}
+
+			bool Apply(UsingExpression* expression, bool repeating) override
+			{
+				CHECK_FAIL(L"AnalyzeComplexityAlgorithm::Apply(UsingExpression*, bool)#UsingExpression should have been merged.");
+			}
+		};
+
+/***********************************************************************
+Expression
+***********************************************************************/
+
+		void Expression::AnalyzeComplexity(ExpressionComplexity& complexity)
+		{
+			AnalyzeComplexityAlgorithm(complexity).Invoke(this, false);
+		}
+	}
+}
@@ -0,0 +1,95 @@
+/***********************************************************************
+Author: Zihan Chen (vczh)
+Licensed under https://github.com/vczh-libraries/License
+***********************************************************************/
+
+#include "RegexExpression.h"
+
+namespace vl
+{
+	namespace regex_internal
+	{
+
+/***********************************************************************
+IsLiteralAlgorithm
+***********************************************************************/
+
+		class IsLiteralAlgorithm : public RegexExpressionAlgorithm<bool, U32String*>
+		{
+		public:
+			bool Apply(CharSetExpression* expression, U32String* target) override
+			{
+				if (expression->reverse || expression->ranges.Count() != 1) return false;
+				auto range = expression->ranges[0];
+				if (range.begin != range.end) return false;
+				*target += U32String::FromChar(range.begin);
+				return true;
+			}
+
+			bool Apply(LoopExpression* expression, U32String* target) override
+			{
+				return false;
+			}
+
+			bool Apply(SequenceExpression* expression, U32String* target) override
+			{
+				return Invoke(expression->left, target) && Invoke(expression->right, target);
+			}
+
+			bool Apply(AlternateExpression* expression, U32String* target) override
+			{
+				return false;
+			}
+
+			bool Apply(BeginExpression* expression, U32String* target) override
+			{
+				return false;
+			}
+
+			bool Apply(EndExpression* expression, U32String* target) override
+			{
+				return false;
+			}
+
+			bool Apply(CaptureExpression* expression, U32String* target) override
+			{
+				return false;
+			}
+
+			bool Apply(MatchExpression* expression, U32String* target) override
+			{
+				return false;
+			}
+
+			bool Apply(PositiveExpression* expression, U32String* target) override
+			{
+				return false;
+			}
+
+			bool Apply(NegativeExpression* expression, U32String* target) override
+			{
+				return false;
+			}
+
+			bool Apply(UsingExpression* expression, U32String* target) override
+			{
+				return false;
+			}
+		};
+
+/***********************************************************************
+Expression
+***********************************************************************/
+
+		bool Expression::IsLiteral(U32String& text)
+		{
+			U32String result;
+			if (IsLiteralAlgorithm().Invoke(this, &result))
+			{
+				text = result;
+				return true;
+			}
+			return false;
+		}
+	}
+}
@@ -0,0 +1,131 @@
+/***********************************************************************
+Author: Zihan Chen (vczh)
+Licensed under https://github.com/vczh-libraries/License
+***********************************************************************/
+
+#include "RegexExpression.h"
+
+namespace vl
+{
+	namespace regex_internal
+	{
+
+/***********************************************************************
+RelaxToPureAlgorithm
+***********************************************************************/
+
+		// nullptr means the expression is relaxed to an empty string
+		class RelaxToPureAlgorithm : public RegexExpressionAlgorithm<Ptr<Expression>, void*>
+		{
+		public:
+			Ptr<Expression> Apply(CharSetExpression* expression, void* target) override
+			{
+				auto result = Ptr(new CharSetExpression);
+				CopyFrom(result->ranges, expression->ranges);
+				result->reverse = expression->reverse;
+				return result;
+			}
+
+			Ptr<Expression> Apply(LoopExpression* expression, void* target) override
+			{
+				auto body = Invoke(expression->expression, 0);
+				if (!body) return nullptr;
+
+				auto result = Ptr(new LoopExpression);
+				result->max = expression->max;
+				result->min = expression->min;
+				result->preferLong = true;
+				result->expression = body;
+				return result;
+			}
+
+			Ptr<Expression> Apply(SequenceExpression* expression, void* target) override
+			{
+				auto left = Invoke(expression->left, 0);
+				auto right = Invoke(expression->right, 0);
+				if (!left) return right;
+				if (!right) return left;
+
+				auto result = Ptr(new SequenceExpression);
+				result->left = left;
+				result->right = right;
+				return result;
+			}
+
+			Ptr<Expression> Apply(AlternateExpression* expression, void* target) override
+			{
+				auto left = Invoke(expression->left, 0);
+				auto right = Invoke(expression->right, 0);
+				if (!left && !right) return nullptr;
+				if (!left || !right)
+				{
+					auto result = Ptr(new LoopExpression);
+					result->min = 0;
+					result->max = 1;
+					result->preferLong = true;
+					result->expression = left ? left : right;
+					return result;
+				}
+
+				auto result = Ptr(new AlternateExpression);
+				result->left = left;
+				result->right = right;
+				return result;
+			}
+
+			Ptr<Expression> Apply(BeginExpression* expression, void* target) override
+			{
+				return nullptr;
+			}
+
+			Ptr<Expression> Apply(EndExpression* expression, void* target) override
+			{
+				return nullptr;
+			}
+
+			Ptr<Expression> Apply(CaptureExpression* expression, void* target) override
+			{
+				return Invoke(expression->expression, 0);
+			}
+
+			Ptr<Expression> Apply(MatchExpression* expression, void* target) override
+			{
+				// the captured text could be anything
+				auto charset = Ptr(new CharSetExpression);
+				charset->ranges.Add(CharRange(1, MaxChar32));
+				charset->reverse = false;
+
+				auto result = Ptr(new LoopExpression);
+				result->min = 0;
+				result->max = -1;
+				result->preferLong = true;
+				result->expression = charset;
+				return result;
+			}
+
+			Ptr<Expression> Apply(PositiveExpression* expression, void* target) override
+			{
+				return nullptr;
+			}
+
+			Ptr<Expression> Apply(NegativeExpression* expression, void* target) override
+			{
+				return nullptr;
+			}
+
+			Ptr<Expression> Apply(UsingExpression* expression, void* target) override
+			{
+				CHECK_FAIL(L"RelaxToPureAlgorithm::Apply(UsingExpression*, void*)#UsingExpression should have been merged.");
+			}
+		};
+
+/***********************************************************************
+Expression
+***********************************************************************/
+
+		Ptr<Expression> Expression::RelaxToPure()
+		{
+			return RelaxToPureAlgorithm().Invoke(this, 0);
+		}
+	}
+}
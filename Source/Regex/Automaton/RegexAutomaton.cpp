@@ -245,7 +245,7 @@ Helpers
 			return target;
 		}
 
-		Ptr<Automaton> NfaToDfa(Ptr<Automaton> source, Group<State*, State*>& dfaStateMap)
+		Ptr<Automaton> NfaToDfa(Ptr<Automaton> source, Group<State*, State*>& dfaStateMap, vint maxStateCount)
 		{
 			auto target = Ptr(new Automaton);
 			CopyFrom(target->captureNames, source->captureNames);
@@ -329,6 +329,10 @@ Helpers
 					// Create a new DFA state if there is not
 					if (!dfaState)
 					{
+						if (maxStateCount != -1 && target->states.Count() >= maxStateCount)
+						{
+							return nullptr;
+						}
 						dfaState = target->NewState();
 						// TODO: (enumerable) foreach
 						for (vint k = 0; k < transitionTargets.Count(); k++)
@@ -81,7 +81,8 @@ namespace vl
 		extern bool								RichEpsilonChecker(Transition* transition);
 		extern bool								AreEqual(Transition* transA, Transition* transB);
 		extern Ptr<Automaton>					EpsilonNfaToNfa(Ptr<Automaton> source, bool(*epsilonChecker)(Transition*), collections::Dictionary<State*, State*>& nfaStateMap);
-		extern Ptr<Automaton>					NfaToDfa(Ptr<Automaton> source, collections::Group<State*, State*>& dfaStateMap);
+		// returns nullptr if the DFA needs more than maxStateCount states, -1 for no limit
+		extern Ptr<Automaton>					NfaToDfa(Ptr<Automaton> source, collections::Group<State*, State*>& dfaStateMap, vint maxStateCount = -1);
 	}
 }
 
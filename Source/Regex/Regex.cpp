@@ -7,23 +7,70 @@ Licensed under https://github.com/vczh-libraries/License
 #include "Regex.h"
 #include "./AST/RegexExpression.h"
 #include "RegexPure.h"
+#include "RegexLazy.h"
 #include "RegexRich.h"
+#include "RegexCharReader.h"
+#ifdef VCZH_REGEX_STATISTICS
+#include <chrono>
+#endif
 
 namespace vl
 {
-	namespace regex_internal
-	{
-		void ReadInt(stream::IStream& inputStream, vint& value);
-		void ReadInts(stream::IStream& inputStream, vint count, vint* values);
-		void WriteInt(stream::IStream& outputStream, vint value);
-		void WriteInts(stream::IStream& outputStream, vint count, vint* values);
-	}
-
 	namespace regex
 	{
 		using namespace collections;
 		using namespace regex_internal;
 
+/***********************************************************************
+Statistics
+***********************************************************************/
+
+#ifdef VCZH_REGEX_STATISTICS
+		struct RegexPhaseTimer
+		{
+			vuint64_t&								nanoseconds;
+			std::chrono::steady_clock::time_point	begin = std::chrono::steady_clock::now();
+
+			~RegexPhaseTimer()
+			{
+				nanoseconds += (vuint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+			}
+		};
+
+		template<typename TProc>
+		decltype(auto) MeasureRegexPhase(vuint64_t& nanoseconds, TProc&& proc)
+		{
+			RegexPhaseTimer timer{ nanoseconds };
+			return proc();
+		}
+
+		void AddPureStatistics(RegexStatistics& statistics, PureInterpretor* pure)
+		{
+			statistics.dfaStateCount += pure->GetStateCount();
+			statistics.dfaCharSetCount += pure->GetCharSetCount();
+			statistics.tableBytes += pure->GetImageSize();
+		}
+
+		void AddCounters(RegexStatistics& statistics, const InterpretorCounters& counters)
+		{
+			statistics.matchHeads += counters.matchHeads;
+			statistics.matchHeadRestarts += counters.matchHeadRestarts;
+			statistics.prefilterRejections += counters.prefilterRejections;
+			statistics.scannedChars += counters.scannedChars;
+			statistics.backtracks += counters.backtracks;
+			statistics.lazyFlushes += counters.lazyFlushes;
+			if (statistics.stateSaverHighWaterMark < counters.stateSaverHighWaterMark)
+			{
+				statistics.stateSaverHighWaterMark = counters.stateSaverHighWaterMark;
+			}
+		}
+
+// measures an expression in a compile phase, NAME is one of parse, epsilonNfa, nfa, dfa and table
+#define REGEX_PHASE(NAME, ...) MeasureRegexPhase(statistics.NAME##Nanoseconds, [&]() { return __VA_ARGS__; })
+#else
+#define REGEX_PHASE(NAME, ...) (__VA_ARGS__)
+#endif
+
 /***********************************************************************
 String Conversion
 ***********************************************************************/
@@ -75,10 +122,9 @@ RegexMatch_<T>
 			: success(true)
 			, result(_string, _result->start, _result->length)
 		{
-			// TODO: (enumerable) foreach
-			for (vint i = 0; i < _result->captures.Count(); i++)
+			// records are grouped by capture in ascending order, so every named capture is appended after existing keys
+			for (auto&& capture : _result->captures)
 			{
-				CaptureRecord& capture = _result->captures[i];
 				if (capture.capture == -1)
 				{
 					captures.Add(RegexString_<T>(_string, capture.start, capture.length));
@@ -125,6 +171,34 @@ RegexMatch_<T>
 RegexBase_
 ***********************************************************************/
 
+		template<typename T>
+		bool RegexBase_::MatchHeadPure(const T* input, const T* start, PureResult& result)const
+		{
+			REGEX_STATISTICS(statistics.dfaCalls++);
+			return lazy ? lazy->MatchHead(input, start, result) : pure->MatchHead(input, start, result);
+		}
+
+		template<typename T>
+		bool RegexBase_::MatchPure(const T* input, const T* start, PureResult& result)const
+		{
+			REGEX_STATISTICS(statistics.dfaCalls++);
+			return lazy ? lazy->Match(input, start, result) : pure->Match(input, start, result);
+		}
+
+		template<typename T>
+		bool RegexBase_::MatchHeadRich(const T* input, const T* start, RichResult& result)const
+		{
+			REGEX_STATISTICS(statistics.backtrackingCalls++);
+			return rich->MatchHead(input, start, result);
+		}
+
+		template<typename T>
+		bool RegexBase_::MatchRich(const T* input, const T* start, RichResult& result)const
+		{
+			REGEX_STATISTICS(statistics.backtrackingCalls++);
+			return rich->Match(input, start, result);
+		}
+
 		template<typename T>
 		void RegexBase_::Process(const ObjectString<T>& text, bool keepEmpty, bool keepSuccess, bool keepFail, typename RegexMatch_<T>::List& matches)const
 		{
@@ -133,7 +207,7 @@ RegexBase_
 				const T* start = text.Buffer();
 				const T* input = start;
 				RichResult result;
-				while (rich->Match(input, start, result))
+				while (MatchRich(input, start, result))
 				{
 					vint offset = input - start;
 					if (keepFail)
@@ -164,7 +238,7 @@ RegexBase_
 				const T* start = text.Buffer();
 				const T* input = start;
 				PureResult result;
-				while (pure->Match(input, start, result))
+				while (MatchPure(input, start, result))
 				{
 					vint offset = input - start;
 					if (keepFail)
@@ -195,8 +269,54 @@ RegexBase_
 		RegexBase_::~RegexBase_()
 		{
 			if (pure) delete pure;
+			if (lazy) delete lazy;
 			if (rich) delete rich;
+			if (prefilter) delete prefilter;
+		}
+
+#ifdef VCZH_REGEX_STATISTICS
+		RegexStatistics RegexBase_::GetStatistics()const
+		{
+			RegexStatistics result = statistics;
+			result.dfa = pure || lazy;
+			result.lazyDfa = lazy != nullptr;
+			result.backtracking = rich != nullptr;
+			result.prefilter = prefilter != nullptr;
+			if (pure)
+			{
+				AddPureStatistics(result, pure);
+				AddCounters(result, pure->counters);
+			}
+			if (prefilter)
+			{
+				AddPureStatistics(result, prefilter);
+			}
+			if (lazy)
+			{
+				result.dfaStateCount += lazy->GetCachedStateCount();
+				result.dfaCharSetCount += lazy->GetCharSetCount();
+				result.tableBytes += lazy->GetTableSize();
+				AddCounters(result, lazy->counters);
+			}
+			if (rich)
+			{
+				result.backtrackingStateCount = rich->GetStateCount();
+				result.backtrackingInstructionCount = rich->GetInstructionCount();
+				result.tableBytes += rich->GetTableSize();
+				AddCounters(result, rich->counters);
+			}
+			return result;
+		}
+
+		void RegexBase_::ResetStatistics()const
+		{
+			statistics.dfaCalls = 0;
+			statistics.backtrackingCalls = 0;
+			if (pure) pure->counters = {};
+			if (lazy) lazy->counters = {};
+			if (rich) rich->counters = {};
 		}
+#endif
 
 		template<typename T>
 		typename RegexMatch_<T>::Ref RegexBase_::MatchHead(const ObjectString<T>& text)const
@@ -204,7 +324,7 @@ RegexBase_
 			if (rich)
 			{
 				RichResult result;
-				if (rich->MatchHead(text.Buffer(), text.Buffer(), result))
+				if (MatchHeadRich(text.Buffer(), text.Buffer(), result))
 				{
 					return Ptr(new RegexMatch_<T>(text, &result));
 				}
@@ -216,7 +336,7 @@ RegexBase_
 			else
 			{
 				PureResult result;
-				if (pure->MatchHead(text.Buffer(), text.Buffer(), result))
+				if (MatchHeadPure(text.Buffer(), text.Buffer(), result))
 				{
 					return Ptr(new RegexMatch_<T>(text, &result));
 				}
@@ -233,7 +353,7 @@ RegexBase_
 			if (rich)
 			{
 				RichResult result;
-				if (rich->Match(text.Buffer(), text.Buffer(), result))
+				if (MatchRich(text.Buffer(), text.Buffer(), result))
 				{
 					return Ptr(new RegexMatch_<T>(text, &result));
 				}
@@ -245,7 +365,7 @@ RegexBase_
 			else
 			{
 				PureResult result;
-				if (pure->Match(text.Buffer(), text.Buffer(), result))
+				if (MatchPure(text.Buffer(), text.Buffer(), result))
 				{
 					return Ptr(new RegexMatch_<T>(text, &result));
 				}
@@ -259,30 +379,30 @@ RegexBase_
 		template<typename T>
 		bool RegexBase_::TestHead(const ObjectString<T>& text)const
 		{
-			if (pure)
+			if (pure || lazy)
 			{
 				PureResult result;
-				return pure->MatchHead(text.Buffer(), text.Buffer(), result);
+				return MatchHeadPure(text.Buffer(), text.Buffer(), result);
 			}
 			else
 			{
 				RichResult result;
-				return rich->MatchHead(text.Buffer(), text.Buffer(), result);
+				return MatchHeadRich(text.Buffer(), text.Buffer(), result);
 			}
 		}
 
 		template<typename T>
 		bool RegexBase_::Test(const ObjectString<T>& text)const
 		{
-			if (pure)
+			if (pure || lazy)
 			{
 				PureResult result;
-				return pure->Match(text.Buffer(), text.Buffer(), result);
+				return MatchPure(text.Buffer(), text.Buffer(), result);
 			}
 			else
 			{
 				RichResult result;
-				return rich->Match(text.Buffer(), text.Buffer(), result);
+				return MatchRich(text.Buffer(), text.Buffer(), result);
 			}
 		}
 
@@ -310,15 +430,24 @@ Regex_<T>
 		
 		template<typename T>
 		Regex_<T>::Regex_(const ObjectString<T>& code, bool preferPure)
+			: Regex_(code, RegexOptions{ preferPure })
+		{
+		}
+
+		template<typename T>
+		Regex_<T>::Regex_(const ObjectString<T>& code, RegexOptions options)
 		{
 			CharRange::List subsets;
-			auto regex = ParseRegexExpression(U32<T>::ToU32(code));
-			auto expression = regex->Merge();
-			expression->NormalizeCharSet(subsets);
+			auto regex = REGEX_PHASE(parse, ParseRegexExpression(U32<T>::ToU32(code)));
+			auto expression = REGEX_PHASE(parse, regex->Merge());
+			REGEX_PHASE(parse, expression->NormalizeCharSet(subsets));
 
 			bool pureRequired = false;
 			bool richRequired = false;
-			if (preferPure)
+			CHECK_ERROR(options.maxDfaStateCount == -1 || options.maxDfaStateCount > 0, L"Regex_<T>::Regex_(const ObjectString<T>&, RegexOptions)#The DFA should be allowed to have at least one state.");
+			vint lazyStateCount = options.maxDfaStateCount == -1 ? LazyInterpretor::DefaultMaxStateCount : options.maxDfaStateCount;
+
+			if (options.preferPure)
 			{
 				if (expression->HasNoExtension())
 				{
@@ -342,38 +471,384 @@ Regex_<T>
 				richRequired = true;
 			}
 
-			try
+			// a prefilter accepting an empty string cannot reject any position
+			// it is decided on the NFA, because NfaToDfa never makes the start state a final state
+			bool pureAcceptsEmpty = false;
+
+			// interpretors are deleted in ~RegexBase_ if the constructor throws
+			if (pureRequired)
 			{
-				if (pureRequired)
+				Dictionary<State*, State*> nfaStateMap;
+				Group<State*, State*> dfaStateMap;
+				Ptr<Automaton> eNfa = REGEX_PHASE(epsilonNfa, expression->GenerateEpsilonNfa());
+				Ptr<Automaton> nfa = REGEX_PHASE(nfa, EpsilonNfaToNfa(eNfa, PureEpsilonChecker, nfaStateMap));
+				pureAcceptsEmpty = nfa->startState->finalState;
+				if (options.lazyDfa)
 				{
-					Dictionary<State*, State*> nfaStateMap;
-					Group<State*, State*> dfaStateMap;
-					Ptr<Automaton> eNfa = expression->GenerateEpsilonNfa();
-					Ptr<Automaton> nfa = EpsilonNfaToNfa(eNfa, PureEpsilonChecker, nfaStateMap);
-					Ptr<Automaton> dfa = NfaToDfa(nfa, dfaStateMap);
-					pure = new PureInterpretor(dfa, subsets);
+					lazy = REGEX_PHASE(table, new LazyInterpretor(nfa, subsets, lazyStateCount));
+				}
+				else if (Ptr<Automaton> dfa = REGEX_PHASE(dfa, NfaToDfa(nfa, dfaStateMap, options.maxDfaStateCount)))
+				{
+					pure = REGEX_PHASE(table, new PureInterpretor(dfa, subsets));
+				}
+				else
+				{
+					// the DFA is too large, build states on demand instead
+					lazy = REGEX_PHASE(table, new LazyInterpretor(nfa, subsets, lazyStateCount));
+				}
+			}
+			if (richRequired)
+			{
+				Dictionary<State*, State*> nfaStateMap;
+				Group<State*, State*> dfaStateMap;
+				Ptr<Automaton> eNfa = REGEX_PHASE(epsilonNfa, expression->GenerateEpsilonNfa());
+				Ptr<Automaton> nfa = REGEX_PHASE(nfa, EpsilonNfaToNfa(eNfa, RichEpsilonChecker, nfaStateMap));
+				Ptr<Automaton> dfa = REGEX_PHASE(dfa, NfaToDfa(nfa, dfaStateMap, options.maxDfaStateCount));
+				if (!dfa)
+				{
+					throw RegexLimitException(L"Regex_<T>::Regex_(const ObjectString<T>&, RegexOptions)#The DFA for captures or extensions needs more states than RegexOptions::maxDfaStateCount.", options.maxDfaStateCount);
+				}
+				rich = REGEX_PHASE(table, new RichInterpretor(dfa));
+
+				for (auto&& name : rich->CaptureNames())
+				{
+					captureNames.Add(U32<T>::FromU32(name));
+				}
+
+				if (pure)
+				{
+					if (!pureAcceptsEmpty)
+					{
+						rich->SetPrefilter(pure);
+					}
 				}
-				if (richRequired)
+				else if (auto relaxed = expression->RelaxToPure(); relaxed && !options.lazyDfa)
 				{
+					// build a DFA accepting a superset of the regex, to skip positions where no match could start
+					CharRange::List relaxedSubsets;
+					REGEX_PHASE(parse, relaxed->NormalizeCharSet(relaxedSubsets));
+
 					Dictionary<State*, State*> nfaStateMap;
 					Group<State*, State*> dfaStateMap;
-					Ptr<Automaton> eNfa = expression->GenerateEpsilonNfa();
-					Ptr<Automaton> nfa = EpsilonNfaToNfa(eNfa, RichEpsilonChecker, nfaStateMap);
-					Ptr<Automaton> dfa = NfaToDfa(nfa, dfaStateMap);
-					rich = new RichInterpretor(dfa);
+					Ptr<Automaton> eNfa = REGEX_PHASE(epsilonNfa, relaxed->GenerateEpsilonNfa());
+					Ptr<Automaton> nfa = REGEX_PHASE(nfa, EpsilonNfaToNfa(eNfa, PureEpsilonChecker, nfaStateMap));
+
+					// a prefilter is only an optimization, so it is not built when the DFA is too large
+					Ptr<Automaton> dfa = nfa->startState->finalState ? nullptr : REGEX_PHASE(dfa, NfaToDfa(nfa, dfaStateMap, options.maxDfaStateCount));
+					if (dfa)
+					{
+						prefilter = REGEX_PHASE(table, new PureInterpretor(dfa, relaxedSubsets));
+						rich->SetPrefilter(prefilter);
+					}
+				}
+			}
+		}
+
+		template<typename T>
+		RegexComplexity Regex_<T>::Analyze(const ObjectString<T>& code, vint maxDfaStateCount)
+		{
+			CHECK_ERROR(maxDfaStateCount > 0, L"Regex_<T>::Analyze(const ObjectString<T>&, vint)#The DFA should be allowed to have at least one state.");
+
+			CharRange::List subsets;
+			auto regex = ParseRegexExpression(U32<T>::ToU32(code));
+			auto expression = regex->Merge();
+			expression->NormalizeCharSet(subsets);
+
+			RegexComplexity complexity;
+			complexity.requiresBacktracking = !expression->HasNoExtension();
+			complexity.canTestWithDfa = !complexity.requiresBacktracking || expression->CanTreatAsPure();
+
+			ExpressionComplexity expressionComplexity;
+			expression->AnalyzeComplexity(expressionComplexity);
+			complexity.nestedQuantifiers = expressionComplexity.nestedQuantifiers;
+			complexity.overlappingAlternations = expressionComplexity.overlappingAlternations;
+			complexity.exponentialBacktracking = complexity.requiresBacktracking && (complexity.nestedQuantifiers > 0 || complexity.overlappingAlternations > 0);
+
+			// build every DFA that the constructor would build, the DFA for matching is reported
+			auto buildDfa = [&](bool (*epsilonChecker)(Transition*))
+			{
+				Dictionary<State*, State*> nfaStateMap;
+				Group<State*, State*> dfaStateMap;
+				Ptr<Automaton> eNfa = expression->GenerateEpsilonNfa();
+				Ptr<Automaton> nfa = EpsilonNfaToNfa(eNfa, epsilonChecker, nfaStateMap);
+				Ptr<Automaton> dfa = NfaToDfa(nfa, dfaStateMap, maxDfaStateCount);
+				complexity.nfaStateCount = nfa->states.Count();
+				complexity.dfaStateCount = dfa ? dfa->states.Count() : maxDfaStateCount;
+				complexity.dfaStateCountExceeded = !dfa;
+				return !dfa;
+			};
+
+			// a DFA for testing over the limit falls back to building states on demand
+			bool pureExceeded = complexity.canTestWithDfa && buildDfa(PureEpsilonChecker);
+			// a DFA for backtracking over the limit makes the constructor throw RegexLimitException
+			bool richExceeded = complexity.requiresBacktracking && buildDfa(RichEpsilonChecker);
+
+			if (complexity.requiresBacktracking)
+			{
+				complexity.recommendedEngine = RegexComplexity::Engine::Backtracking;
+			}
+			else if (pureExceeded)
+			{
+				complexity.recommendedEngine = RegexComplexity::Engine::LazyDfa;
+			}
+			else
+			{
+				complexity.recommendedEngine = RegexComplexity::Engine::Dfa;
+			}
+			complexity.recommendedOptions.lazyDfa = pureExceeded;
+			complexity.recommendedOptions.maxDfaStateCount = richExceeded ? -1 : maxDfaStateCount;
+			return complexity;
+		}
+
+/***********************************************************************
+Regex_<T> (Serialization)
+***********************************************************************/
+
+		// the serialized Regex_ is this header followed by serialized interpretors in the order of the flags
+		struct RegexStreamHeader
+		{
+			static const vuint32_t	Magic = 0x52475256;			// "VRGR"
+			static const vuint32_t	Endian = 0x01020304;
+			static const vuint32_t	Version = 1;
+			static const vuint32_t	HasPure = 1;
+			static const vuint32_t	HasPrefilter = 2;
+			static const vuint32_t	HasRich = 4;
+			static const vuint32_t	PureIsPrefilter = 8;		// the pure interpretor is also the prefilter of the rich interpretor
+
+			vuint32_t			magic;
+			vuint32_t			endian;
+			vuint32_t			version;
+			vuint32_t			flags;
+		};
+
+		void RegexBase_::Serialize(stream::IStream& outputStream)const
+		{
+			CHECK_ERROR(!lazy, L"RegexBase_::Serialize(IStream&)#A regular expression building DFA states on demand cannot be serialized.");
+
+			RegexStreamHeader header;
+			header.magic = RegexStreamHeader::Magic;
+			header.endian = RegexStreamHeader::Endian;
+			header.version = RegexStreamHeader::Version;
+			header.flags =
+				(pure ? RegexStreamHeader::HasPure : 0) |
+				(prefilter ? RegexStreamHeader::HasPrefilter : 0) |
+				(rich ? RegexStreamHeader::HasRich : 0) |
+				(pure && rich && rich->GetPrefilter() == pure ? RegexStreamHeader::PureIsPrefilter : 0);
+			CHECK_ERROR(outputStream.Write(&header, sizeof(header)) == sizeof(header), L"Failed to serialize Regex.");
+
+			if (pure) pure->Serialize(outputStream);
+			if (prefilter) prefilter->Serialize(outputStream);
+			if (rich) rich->Serialize(outputStream);
+		}
+
+		template<typename T>
+		Regex_<T>::Regex_(stream::IStream& inputStream)
+		{
+			using Reason = RegexImageException::Reason;
+			RegexStreamHeader header;
+			if (inputStream.Read(&header, sizeof(header)) != sizeof(header))
+			{
+				throw RegexImageException(L"Regex_<T>::Regex_(IStream&)#The stream is truncated.", Reason::Truncated);
+			}
+			if (header.magic != RegexStreamHeader::Magic)
+			{
+				throw RegexImageException(L"Regex_<T>::Regex_(IStream&)#The stream does not contain a serialized regular expression.", Reason::NotAnImage);
+			}
+			if (header.endian != RegexStreamHeader::Endian)
+			{
+				throw RegexImageException(L"Regex_<T>::Regex_(IStream&)#The stream is serialized on a machine with a different byte order.", Reason::ByteOrder);
+			}
+			if (header.version != RegexStreamHeader::Version)
+			{
+				throw RegexImageException(L"Regex_<T>::Regex_(IStream&)#The stream is serialized in an unsupported version.", Reason::Version);
+			}
+			if ((header.flags & (RegexStreamHeader::HasPure | RegexStreamHeader::HasRich)) == 0 || (header.flags & ~(RegexStreamHeader::HasPure | RegexStreamHeader::HasPrefilter | RegexStreamHeader::HasRich | RegexStreamHeader::PureIsPrefilter)) != 0)
+			{
+				throw RegexImageException(L"Regex_<T>::Regex_(IStream&)#The stream is corrupted.", Reason::Corrupted);
+			}
+
+			// interpretors are deleted by ~RegexBase_ if any of them fails to load
+			if (header.flags & RegexStreamHeader::HasPure)
+			{
+				pure = new PureInterpretor(inputStream);
+			}
+			if (header.flags & RegexStreamHeader::HasPrefilter)
+			{
+				prefilter = new PureInterpretor(inputStream);
+			}
+			if (header.flags & RegexStreamHeader::HasRich)
+			{
+				rich = new RichInterpretor(inputStream);
+				for (auto&& name : rich->CaptureNames())
+				{
+					captureNames.Add(U32<T>::FromU32(name));
+				}
+
+				if (pure && (header.flags & RegexStreamHeader::PureIsPrefilter))
+				{
+					rich->SetPrefilter(pure);
+				}
+				else if (prefilter)
+				{
+					rich->SetPrefilter(prefilter);
+				}
+			}
+		}
+
+/***********************************************************************
+RegexSetBase_
+***********************************************************************/
+
+		RegexSetBase_::~RegexSetBase_()
+		{
+			if (pure) delete pure;
+		}
 
-					for (auto&& name : rich->CaptureNames())
+		template<typename T>
+		void RegexSetBase_::Matches(const ObjectString<T>& text, collections::List<vint>& ids)const
+		{
+			ids.Clear();
+			Array<bool> matched(patternCount);
+			for (vint i = 0; i < patternCount; i++)
+			{
+				matched[i] = false;
+			}
+
+			if (pure)
+			{
+				// the start state loops on all characters, so the DFA is run on the text only once
+				// a character that is not used in any pattern restarts the DFA
+				vint startState = pure->GetStartState();
+				vint state = startState;
+				CharReader<T> reader(text.Buffer());
+				while (true)
+				{
+					for (vint i = stateIdStarts[state]; i < stateIdStarts[state + 1]; i++)
 					{
-						captureNames.Add(U32<T>::FromU32(name));
+						matched[stateIds[i]] = true;
 					}
+
+					auto c = reader.Read();
+					if (!c) break;
+					state = pure->Transit(c, state);
+					if (state == -1) state = startState;
+				}
+			}
+
+			for (auto [id, index] : indexed(richIds))
+			{
+				matched[id] = richPatterns[index]->Test(text);
+			}
+
+			for (vint i = 0; i < patternCount; i++)
+			{
+				if (matched[i]) ids.Add(i);
+			}
+		}
+
+/***********************************************************************
+RegexSet_<T>
+***********************************************************************/
+
+		template<typename T>
+		RegexSet_<T>::RegexSet_(const collections::IEnumerable<ObjectString<T>>& patterns)
+		{
+			// Patterns that need a rich interpretor are tested one by one
+			List<Ptr<Expression>> expressions;
+			List<vint> pureIds;
+			CharRange::List subsets;
+			for (auto&& code : patterns)
+			{
+				auto regex = ParseRegexExpression(U32<T>::ToU32(code));
+				auto expression = regex->Merge();
+				if (expression->CanTreatAsPure())
+				{
+					expression->CollectCharSet(subsets);
+					expressions.Add(expression);
+					pureIds.Add(patternCount);
+				}
+				else
+				{
+					richIds.Add(patternCount);
+					richPatterns.Add(Ptr(new Regex_<T>(code)));
+				}
+				patternCount++;
+			}
+
+			if (expressions.Count() == 0) return;
+
+			// Build DFA for all patterns, final states are marked with the pattern id
+			List<Ptr<Automaton>> dfas;
+			for (auto [expression, index] : indexed(expressions))
+			{
+				Dictionary<State*, State*> nfaStateMap;
+				Group<State*, State*> dfaStateMap;
+				expression->ApplyCharSet(subsets);
+				auto eNfa = expression->GenerateEpsilonNfa();
+				auto nfa = EpsilonNfaToNfa(eNfa, PureEpsilonChecker, nfaStateMap);
+				auto dfa = NfaToDfa(nfa, dfaStateMap);
+				dfas.Add(dfa);
+
+				for (auto state : dfa->states)
+				{
+					state->userData = (void*)(state->finalState ? pureIds[index] : patternCount);
 				}
 			}
-			catch (...)
+
+			// Connect all DFAs to an e-NFA, with a loop at the start state to match from any position
+			auto bigEnfa = Ptr(new Automaton);
+			for (auto dfa : dfas)
+			{
+				CopyFrom(bigEnfa->states, dfa->states, true);
+				CopyFrom(bigEnfa->transitions, dfa->transitions, true);
+			}
+			bigEnfa->startState = bigEnfa->NewState();
+			bigEnfa->startState->userData = (void*)patternCount;
+			for (auto dfa : dfas)
+			{
+				bigEnfa->NewEpsilon(bigEnfa->startState, dfa->startState);
+			}
+			for (auto range : subsets)
+			{
+				bigEnfa->NewChars(bigEnfa->startState, bigEnfa->startState, range);
+			}
+
+			// Build a single DFA out of the e-NFA
+			Dictionary<State*, State*> nfaStateMap;
+			Group<State*, State*> dfaStateMap;
+			auto bigNfa = EpsilonNfaToNfa(bigEnfa, PureEpsilonChecker, nfaStateMap);
+			for (auto [nfaState, eNfaState] : nfaStateMap)
+			{
+				nfaState->userData = eNfaState->userData;
+			}
+			auto bigDfa = NfaToDfa(bigNfa, dfaStateMap);
+
+			// Collect all accepted patterns for each DFA state
+			pure = new PureInterpretor(bigDfa, subsets);
+			stateIdStarts.Resize(bigDfa->states.Count() + 1);
+			List<vint> allIds;
+			for (auto [state, i] : indexed(bigDfa->states))
 			{
-				if (pure)delete pure;
-				if (rich)delete rich;
-				throw;
+				auto dfaState = state.Obj();
+				SortedList<vint> ids;
+				vint index = dfaStateMap.Keys().IndexOf(dfaState);
+				if (index != -1)
+				{
+					for (auto nfaState : dfaStateMap.GetByIndex(index))
+					{
+						vint id = (vint)nfaState->userData;
+						if (nfaState->finalState && id != patternCount && !ids.Contains(id))
+						{
+							ids.Add(id);
+						}
+					}
+				}
+
+				stateIdStarts[i] = allIds.Count();
+				CopyFrom(allIds, ids, true);
 			}
+			stateIdStarts[bigDfa->states.Count()] = allIds.Count();
+			CopyFrom(stateIds, allIds);
 		}
 
 /***********************************************************************
@@ -398,6 +873,8 @@ RegexTokens_<T>
 			vint					columnStart = 0;
 			bool					cacheAvailable = false;
 			RegexToken_<T>			cacheToken;
+			vint					scannedEnd = 0;				// the position where the DFA stops when producing the current token, exclusive
+			vint					cacheScannedEnd = 0;
 
 		public:
 			RegexTokenEnumerator(const RegexTokenEnumerator& enumerator)
@@ -413,6 +890,8 @@ RegexTokens_<T>
 				, columnStart(enumerator.columnStart)
 				, cacheAvailable(enumerator.cacheAvailable)
 				, cacheToken(enumerator.cacheToken)
+				, scannedEnd(enumerator.scannedEnd)
+				, cacheScannedEnd(enumerator.cacheScannedEnd)
 			{
 			}
 
@@ -448,6 +927,7 @@ RegexTokens_<T>
 				if (cacheAvailable)
 				{
 					token = cacheToken;
+					scannedEnd = cacheScannedEnd;
 					cacheAvailable = false;
 				}
 				else
@@ -457,6 +937,7 @@ RegexTokens_<T>
 					token.length = 0;
 					token.token = -2;
 					token.completeToken = true;
+					scannedEnd = 0;
 				}
 
 				token.rowStart = rowStart;
@@ -512,20 +993,24 @@ RegexTokens_<T>
 						completeToken = token.completeToken;
 					}
 
+					vint resultScannedEnd = result.start + (result.scannedLength > result.length ? result.scannedLength : result.length);
 					if (token.token == -2)
 					{
 						token.start = result.start;
 						token.length = result.length;
 						token.token = id;
 						token.completeToken = completeToken;
+						scannedEnd = resultScannedEnd;
 					}
 					else if (token.token == id && id == -1)
 					{
 						token.length += result.length;
+						if (scannedEnd < resultScannedEnd) scannedEnd = resultScannedEnd;
 					}
 					else
 					{
 						cacheAvailable = true;
+						cacheScannedEnd = resultScannedEnd;
 						cacheToken.reading = reading;
 						cacheToken.start = result.start;
 						cacheToken.length = result.length;
@@ -567,6 +1052,30 @@ RegexTokens_<T>
 				cacheAvailable = false;
 			}
 
+			void Restart(vint position, vint row, vint column)
+			{
+				index = -1;
+				reading = start + position;
+				rowStart = row;
+				columnStart = column;
+				cacheAvailable = false;
+			}
+
+			vint GetScannedEnd()const
+			{
+				return scannedEnd;
+			}
+
+			vint GetRow()const
+			{
+				return rowStart;
+			}
+
+			vint GetColumn()const
+			{
+				return columnStart;
+			}
+
 			void ReadToEnd(List<RegexToken_<T>>& tokens, bool(*discard)(vint))
 			{
 				while (Next())
@@ -621,11 +1130,140 @@ RegexTokens_<T>
 		}
 
 /***********************************************************************
-RegexLexerWalker_<T>
+RegexIncrementalTokens_<T>
 ***********************************************************************/
 
 		template<typename T>
-		RegexLexerWalker_<T>::RegexLexerWalker_(PureInterpretor* _pure, const Array<vint>& _stateTokens)
+		vint RegexIncrementalTokens_<T>::Lex(vint first, vint editEnd, vint delta)
+		{
+			// tokens before first are kept, tokens beginning at or after editEnd in the old text could be reused after shifting by delta
+			vint position = 0;
+			vint row = 0;
+			vint column = 0;
+			if (first < tokens.Count())
+			{
+				position = tokens[first].start;
+				row = tokens[first].rowStart;
+				column = tokens[first].columnStart;
+			}
+
+			List<RegexToken_<T>> newTokens;
+			List<vint> newScannedEnds;
+			vint reused = tokens.Count();
+			vint candidate = first;
+			RegexTokenEnumerator<T> enumerator(pure, *stateTokens, code.Buffer(), codeIndex, {});
+			enumerator.Restart(position, row, column);
+			while (enumerator.Next())
+			{
+				auto&& token = enumerator.Current();
+				newTokens.Add(token);
+				newScannedEnds.Add(enumerator.GetScannedEnd());
+
+				// a token after the edited range only reads unchanged text, so it stays the same if tokenizing begins at the same position
+				// but an unrecognized token is merged to the previous one if they are both unrecognized
+				vint oldEnd = token.start + token.length - delta;
+				if (oldEnd < editEnd) continue;
+				while (candidate < tokens.Count() && tokens[candidate].start < oldEnd)
+				{
+					candidate++;
+				}
+				if (candidate < tokens.Count() && tokens[candidate].start == oldEnd && !(token.token == -1 && tokens[candidate].token == -1))
+				{
+					reused = candidate;
+					break;
+				}
+			}
+
+			// shift reused tokens, columns only change for those in the same row of where tokenizing stops
+			vint rowDelta = 0;
+			vint columnDelta = 0;
+			vint resyncRow = -1;
+			if (reused < tokens.Count())
+			{
+				resyncRow = tokens[reused].rowStart;
+				rowDelta = enumerator.GetRow() - resyncRow;
+				columnDelta = enumerator.GetColumn() - tokens[reused].columnStart;
+			}
+
+			for (vint i = reused; i < tokens.Count(); i++)
+			{
+				auto token = tokens[i];
+				token.start += delta;
+				token.reading = code.Buffer() + token.start;
+				if (token.rowStart == resyncRow) token.columnStart += columnDelta;
+				if (token.rowEnd == resyncRow) token.columnEnd += columnDelta;
+				token.rowStart += rowDelta;
+				token.rowEnd += rowDelta;
+				newTokens.Add(token);
+				newScannedEnds.Add(scannedEnds[i] + delta);
+			}
+			for (vint i = 0; i < first; i++)
+			{
+				tokens[i].reading = code.Buffer() + tokens[i].start;
+			}
+
+			vint relexed = newTokens.Count() - (tokens.Count() - reused);
+			tokens.RemoveRange(first, tokens.Count() - first);
+			scannedEnds.RemoveRange(first, scannedEnds.Count() - first);
+			CopyFrom(tokens, newTokens, true);
+			CopyFrom(scannedEnds, newScannedEnds, true);
+			return relexed;
+		}
+
+		template<typename T>
+		RegexIncrementalTokens_<T>::RegexIncrementalTokens_(PureInterpretor* _pure, const Array<vint>& _stateTokens, const ObjectString<T>& _code, vint _codeIndex)
+			:pure(_pure)
+			, stateTokens(&_stateTokens)
+			, code(_code)
+			, codeIndex(_codeIndex)
+		{
+			Lex(0, 0, 0);
+		}
+
+		template<typename T>
+		const ObjectString<T>& RegexIncrementalTokens_<T>::GetCode()const
+		{
+			return code;
+		}
+
+		template<typename T>
+		const collections::List<RegexToken_<T>>& RegexIncrementalTokens_<T>::GetTokens()const
+		{
+			return tokens;
+		}
+
+		template<typename T>
+		vint RegexIncrementalTokens_<T>::Edit(const ObjectString<T>& newCode, vint editStart, vint removedLength, vint insertedLength)
+		{
+			vint delta = insertedLength - removedLength;
+			CHECK_ERROR(
+				0 <= editStart && 0 <= removedLength && 0 <= insertedLength &&
+				editStart + removedLength <= code.Length() &&
+				newCode.Length() == code.Length() + delta,
+				L"RegexIncrementalTokens_<T>::Edit(const ObjectString<T>&, vint, vint, vint)#Argument out of range.");
+
+			// the first token that reads the edited text, the terminating zero is also read when a token stops at the end of the text
+			vint first = 0;
+			while (first < tokens.Count() && scannedEnds[first] <= editStart)
+			{
+				first++;
+			}
+			if (first > 0 && tokens[first - 1].token == -1)
+			{
+				first--;
+			}
+
+			code = newCode;
+			code.Buffer();
+			return Lex(first, editStart + removedLength, delta);
+		}
+
+/***********************************************************************
+RegexLexerWalker_<T>
+***********************************************************************/
+
+		template<typename T>
+		RegexLexerWalker_<T>::RegexLexerWalker_(PureInterpretor* _pure, const Array<vint>& _stateTokens)
 			:pure(_pure)
 			, stateTokens(_stateTokens)
 		{
@@ -751,6 +1389,33 @@ RegexLexerWalker_<T>
 			return state;
 		}
 
+		template<typename T>
+		vint RegexLexerWalker_<T>::WalkRange(const T* input, vint length, vint state, collections::List<RegexWalkEvent>& events)const
+		{
+			CHECK_ERROR(readingLength == 0, L"RegexLexerWalker::WalkRange(const T*, vint, vint, List<RegexWalkEvent>&)#Walk(T) must complete a UTF sequence before walking a range.");
+			encoding::UtfStringRangeToStringRangeReader<T, char32_t> reader(input, length);
+			while (auto c = reader.Read())
+			{
+				vint token = -1;
+				bool finalState = false;
+				bool previousTokenStop = false;
+				WalkScalar(c, state, token, finalState, previousTokenStop);
+				if (finalState || previousTokenStop)
+				{
+					auto cluster = reader.SourceCluster();
+					RegexWalkEvent event;
+					event.start = cluster.index;
+					event.length = cluster.size;
+					event.state = state;
+					event.token = token;
+					event.finalState = finalState;
+					event.previousTokenStop = previousTokenStop;
+					events.Add(event);
+				}
+			}
+			return state;
+		}
+
 		template<typename T>
 		bool RegexLexerWalker_<T>::IsClosedToken(const T* input, vint length)const
 		{
@@ -761,6 +1426,7 @@ RegexLexerWalker_<T>
 				state = pure->Transit(c, state);
 				if (state == -1) return true;
 				if (pure->IsDeadState(state)) return true;
+				if (!pure->CanReachFinalState(state)) return true;
 			}
 			return false;
 		}
@@ -831,7 +1497,7 @@ RegexLexerColorizer_<T>
 
 			vint length = readingLength;
 			readingLength = 0;
-			WalkOneToken(buffer, length, 0, false);
+			WalkOneToken(buffer, length, 0, [](vint, vint, vint) {});
 		}
 
 		template<typename T>
@@ -841,7 +1507,7 @@ RegexLexerColorizer_<T>
 		}
 
 		template<typename T>
-		void RegexLexerColorizer_<T>::CallExtendProcAndColorizeProc(const T* input, vint length, RegexProcessingToken& token, bool colorize)
+		void RegexLexerColorizer_<T>::CallExtendProc(const T* input, vint length, RegexProcessingToken& token)
 		{
 			vint oldTokenLength = token.length;
 			proc.extendProc(proc.argument, input + token.start, length - token.start, false, token);
@@ -850,15 +1516,15 @@ RegexLexerColorizer_<T>
 				bool pausedAtTheEnd = token.start + token.length == length && !token.completeToken;
 				CHECK_ERROR(
 					token.completeToken || pausedAtTheEnd,
-					L"RegexLexerColorizer::WalkOneToken(const T*, vint, vint, bool)#The extendProc is not allowed pause before the end of the input."
+					L"RegexLexerColorizer::WalkOneToken(const T*, vint, vint, TColorize&&)#The extendProc is not allowed pause before the end of the input."
 				);
 				CHECK_ERROR(
 					token.completeToken || token.token != -1,
-					L"RegexLexerColorizer::WalkOneToken(const T*, vint, vint, bool)#The extendProc is not allowed to pause without a valid token id."
+					L"RegexLexerColorizer::WalkOneToken(const T*, vint, vint, TColorize&&)#The extendProc is not allowed to pause without a valid token id."
 				);
 				CHECK_ERROR(
 					oldTokenLength <= token.length,
-					L"RegexLexerColorizer::WalkOneToken(const T*, vint, vint, bool)#The extendProc is not allowed to decrease the token length."
+					L"RegexLexerColorizer::WalkOneToken(const T*, vint, vint, TColorize&&)#The extendProc is not allowed to decrease the token length."
 				);
 				CHECK_ERROR(
 					(token.interTokenState == nullptr) == !pausedAtTheEnd,
@@ -870,138 +1536,267 @@ RegexLexerColorizer_<T>
 			{
 				internalState.interTokenId = token.token;
 			}
-			if (colorize)
+		}
+
+		template<typename T>
+		void RegexLexerColorizer_<T>::CallExtendProcForInterToken(const T* input, vint length, RegexProcessingToken& token)
+		{
+			proc.extendProc(proc.argument, input, length, false, token);
+#if _DEBUG
+			{
+				bool pausedAtTheEnd = token.length == length && !token.completeToken;
+				CHECK_ERROR(
+					token.completeToken || pausedAtTheEnd,
+					L"RegexLexerColorizer::WalkOneToken(const T*, vint, vint, TColorize&&)#The extendProc is not allowed to pause before the end of the input."
+				);
+				CHECK_ERROR(
+					token.completeToken || token.token == internalState.interTokenId,
+					L"RegexLexerColorizer::WalkOneToken(const T*, vint, vint, TColorize&&)#The extendProc is not allowed to continue pausing with a different token id."
+				);
+				CHECK_ERROR(
+					(token.interTokenState == nullptr) == !pausedAtTheEnd,
+					L"RegexLexerColorizer::Colorize(const T*, vint)#The extendProc should return an inter token state object if and only if a valid token does not end at the end of the input."
+				);
+			}
+#endif
+			if (!(internalState.interTokenState = token.interTokenState))
 			{
-				proc.colorizeProc(proc.argument, token.start, token.length, token.token);
+				internalState.interTokenId = -1;
 			}
 		}
 
 		template<typename T>
-		vint RegexLexerColorizer_<T>::WalkOneToken(const T* input, vint length, vint start, bool colorize)
+		void* RegexLexerColorizer_<T>::Colorize(const T* input, vint length)
 		{
-			if (internalState.interTokenState)
+			CHECK_ERROR(
+				internalState.readingLength == 0,
+				L"RegexLexerColorizer::Colorize(const T*, vint)#Pass(T) must complete a UTF sequence before colorizing a buffer."
+			);
+			return Colorize(input, length, [this](vint tokenStart, vint tokenLength, vint token)
 			{
-				RegexProcessingToken token(-1, -1, internalState.interTokenId, false, internalState.interTokenState);
-				proc.extendProc(proc.argument, input, length, false, token);
-#if _DEBUG
-				{
-					bool pausedAtTheEnd = token.length == length && !token.completeToken;
-					CHECK_ERROR(
-						token.completeToken || pausedAtTheEnd,
-						L"RegexLexerColorizer::WalkOneToken(const T*, vint, vint, bool)#The extendProc is not allowed to pause before the end of the input."
-					);
-					CHECK_ERROR(
-						token.completeToken || token.token == internalState.interTokenId,
-						L"RegexLexerColorizer::WalkOneToken(const T*, vint, vint, bool)#The extendProc is not allowed to continue pausing with a different token id."
-					);
-					CHECK_ERROR(
-						(token.interTokenState == nullptr) == !pausedAtTheEnd,
-						L"RegexLexerColorizer::Colorize(const T*, vint)#The extendProc should return an inter token state object if and only if a valid token does not end at the end of the input."
-					);
-				}
-#endif
-				if (colorize)
+				proc.colorizeProc(proc.argument, tokenStart, tokenLength, token);
+			});
+		}
+
+		template<typename T>
+		vint RegexLexerColorizer_<T>::ColorizeSpans(const T* input, vint length, RegexColorizeSpan* spans, vint capacity)
+		{
+			vint count = 0;
+			RegexColorizeSpan last;
+			Colorize(input, length, [&](vint tokenStart, vint tokenLength, vint token)
+			{
+				if (tokenLength == 0) return;
+				if (count > 0 && last.token == token && last.start + last.length == tokenStart)
 				{
-					proc.colorizeProc(proc.argument, 0, token.length, token.token);
+					last.length += tokenLength;
 				}
-				if (!(internalState.interTokenState = token.interTokenState))
+				else
 				{
-					internalState.interTokenId = -1;
+					if (count > 0 && count <= capacity)
+					{
+						spans[count - 1] = last;
+					}
+					last = { tokenStart, tokenLength, token };
+					count++;
 				}
-				return token.length;
+			});
+			if (count > 0 && count <= capacity)
+			{
+				spans[count - 1] = last;
 			}
+			return count;
+		}
 
-			vint lastFinalStateLength = 0;
-			vint lastFinalStateToken = -1;
-			vint lastFinalStateState = -1;
-
-			vint tokenStartState = internalState.currentState;
-			encoding::UtfStringRangeToStringRangeReader<T, char32_t> reader(input + start, length - start);
-			while (auto c = reader.Read())
+		template<typename T>
+		vint RegexLexerColorizer_<T>::ColorizeTokens(const T* input, vint length, vuint16_t* tokens)
+		{
+			vint count = 0;
+			vint lastToken = -1;
+			vint lastEnd = -1;
+			Colorize(input, length, [&](vint tokenStart, vint tokenLength, vint token)
 			{
-				auto cluster = reader.SourceCluster();
-				vint i = start + cluster.index;
-				vint next = i + cluster.size;
-				vint currentToken = -1;
-				bool finalState = false;
-				bool previousTokenStop = false;
-				walker.WalkScalar(c, internalState.currentState, currentToken, finalState, previousTokenStop);
-
-				if (previousTokenStop)
+				if (tokenLength == 0) return;
+				CHECK_ERROR(token < 0xFFFF, L"RegexLexerColorizer::ColorizeTokens(const T*, vint, vuint16_t*)#Token index is too large to be stored in vuint16_t.");
+				if (count == 0 || lastToken != token || lastEnd != tokenStart)
 				{
-					if (proc.extendProc && lastFinalStateToken != -1)
-					{
-						RegexProcessingToken token(start, lastFinalStateLength, lastFinalStateToken, true, nullptr);
-						CallExtendProcAndColorizeProc(input, length, token, colorize);
-						if (token.completeToken)
-						{
-							internalState.currentState = walker.GetStartState();
-						}
-						return start + token.length;
-					}
-					else if (i == start)
-					{
-						if (tokenStartState == GetStartState())
-						{
-							if (colorize)
-							{
-								proc.colorizeProc(proc.argument, start, cluster.size, -1);
-							}
-							internalState.currentState = walker.GetStartState();
-							return next;
-						}
-					}
-					else
-					{
-						if (colorize)
-						{
-							proc.colorizeProc(proc.argument, start, lastFinalStateLength, lastFinalStateToken);
-						}
-						internalState.currentState = lastFinalStateState;
-						return start + lastFinalStateLength;
-					}
+					count++;
 				}
+				lastToken = token;
+				lastEnd = tokenStart + tokenLength;
 
-				if (finalState)
+				// a plain loop on a contiguous range, which the compiler turns into vectorized stores
+				vuint16_t value = (vuint16_t)token;
+				vuint16_t* writing = tokens + tokenStart;
+				for (vint i = 0; i < tokenLength; i++)
 				{
-					lastFinalStateLength = next - start;
-					lastFinalStateToken = currentToken;
-					lastFinalStateState = internalState.currentState;
+					writing[i] = value;
 				}
+			});
+			return count;
+		}
+
+/***********************************************************************
+RegexDocumentColorizer_<T>
+***********************************************************************/
+
+		template<typename T>
+		void RegexDocumentColorizer_<T>::MarkDirty(vint first, vint last)
+		{
+			if (firstDirtyLine == -1)
+			{
+				firstDirtyLine = first;
+				lastDirtyLine = last;
+			}
+			else
+			{
+				if (firstDirtyLine > first) firstDirtyLine = first;
+				if (lastDirtyLine < last) lastDirtyLine = last;
+			}
+		}
+
+		template<typename T>
+		void RegexDocumentColorizer_<T>::StoreLineEndState(vint line)
+		{
+			// following lines are not affected if this line ends in the same state as before
+			auto state = colorizer.GetInternalState();
+			bool unchanged = lineStates[line + 1] == state;
+			lineStates[line + 1] = state;
+
+			if ((unchanged && line >= lastDirtyLine) || line + 1 == GetLineCount())
+			{
+				firstDirtyLine = -1;
+				lastDirtyLine = -1;
+			}
+			else
+			{
+				firstDirtyLine = line + 1;
+				if (lastDirtyLine < firstDirtyLine) lastDirtyLine = firstDirtyLine;
+			}
+		}
+
+		template<typename T>
+		bool RegexDocumentColorizer_<T>::IsLineStateKnown(vint line)const
+		{
+			return 0 <= line && line < lineStates.Count() && (firstDirtyLine == -1 || line <= firstDirtyLine);
+		}
+
+		template<typename T>
+		RegexDocumentColorizer_<T>::RegexDocumentColorizer_(const RegexLexerColorizer_<T>& _colorizer)
+			:colorizer(_colorizer)
+		{
+			lineStates.Add(colorizer.GetInternalState());
+		}
+
+		template<typename T>
+		vint RegexDocumentColorizer_<T>::GetLineCount()const
+		{
+			return lineStates.Count() - 1;
+		}
+
+		template<typename T>
+		vint RegexDocumentColorizer_<T>::GetFirstDirtyLine()const
+		{
+			return firstDirtyLine;
+		}
+
+		template<typename T>
+		void RegexDocumentColorizer_<T>::InsertLines(vint line, vint count)
+		{
+			CHECK_ERROR(0 <= line && line <= GetLineCount() && count >= 0, L"RegexDocumentColorizer_<T>::InsertLines(vint, vint)#Argument out of range.");
+			if (count == 0) return;
+
+			// the last inserted item keeps the old start state of the line after inserted lines, which is compared with when walking stops
+			auto state = lineStates[line];
+			for (vint i = 0; i < count; i++)
+			{
+				lineStates.Insert(line, state);
+			}
+			if (firstDirtyLine != -1)
+			{
+				if (firstDirtyLine >= line) firstDirtyLine += count;
+				if (lastDirtyLine >= line) lastDirtyLine += count;
 			}
+			MarkDirty(line, line + count - 1);
+		}
 
-			if (lastFinalStateToken != -1 && start + lastFinalStateLength == length)
+		template<typename T>
+		void RegexDocumentColorizer_<T>::RemoveLines(vint line, vint count)
+		{
+			CHECK_ERROR(0 <= line && count >= 0 && line + count <= GetLineCount(), L"RegexDocumentColorizer_<T>::RemoveLines(vint, vint)#Argument out of range.");
+			if (count == 0) return;
+
+			// the line after removed lines begins in the old start state of the first removed line, but its end state is still cached
+			lineStates.RemoveRange(line + 1, count);
+			if (firstDirtyLine != -1)
 			{
-				if (proc.extendProc)
+				auto shift = [=](vint dirtyLine) { return dirtyLine < line ? dirtyLine : dirtyLine < line + count ? line : dirtyLine - count; };
+				firstDirtyLine = shift(firstDirtyLine);
+				lastDirtyLine = shift(lastDirtyLine);
+				if (firstDirtyLine >= GetLineCount())
 				{
-					RegexProcessingToken token(start, lastFinalStateLength, lastFinalStateToken, true, nullptr);
-					CallExtendProcAndColorizeProc(input, length, token, colorize);
+					firstDirtyLine = -1;
+					lastDirtyLine = -1;
 				}
-				else if (colorize)
+				else if (lastDirtyLine >= GetLineCount())
 				{
-					proc.colorizeProc(proc.argument, start, lastFinalStateLength, lastFinalStateToken);
+					lastDirtyLine = GetLineCount() - 1;
 				}
 			}
-			else if (colorize)
+			if (line < GetLineCount())
 			{
-				proc.colorizeProc(proc.argument, start, length - start, walker.GetRelatedToken(internalState.currentState));
+				MarkDirty(line, line);
 			}
-			return length;
 		}
 
 		template<typename T>
-		void* RegexLexerColorizer_<T>::Colorize(const T* input, vint length)
+		void RegexDocumentColorizer_<T>::EditLine(vint line)
 		{
-			CHECK_ERROR(
-				internalState.readingLength == 0,
-				L"RegexLexerColorizer::Colorize(const T*, vint)#Pass(T) must complete a UTF sequence before colorizing a buffer."
-			);
-			vint index = 0;
-			while (index != length)
+			CHECK_ERROR(0 <= line && line < GetLineCount(), L"RegexDocumentColorizer_<T>::EditLine(vint)#Argument out of range.");
+			MarkDirty(line, line);
+		}
+
+		template<typename T>
+		vint RegexDocumentColorizer_<T>::Update(vint lastLine, ReadLineProc readLine, void* argument)
+		{
+			vint walked = 0;
+			while (firstDirtyLine != -1 && firstDirtyLine < lastLine)
 			{
-				index = WalkOneToken(input, length, index, true);
+				vint line = firstDirtyLine;
+				vint length = 0;
+				auto input = readLine(argument, line, length);
+
+				colorizer.SetInternalState(lineStates[line]);
+				vint index = 0;
+				while (index != length)
+				{
+					index = colorizer.WalkOneToken(input, length, index, [](vint, vint, vint) {});
+				}
+				StoreLineEndState(line);
+				walked++;
 			}
-			return internalState.interTokenState;
+			return walked;
+		}
+
+		template<typename T>
+		RegexLexerColorizer_<T> RegexDocumentColorizer_<T>::GetLineColorizer(vint line)const
+		{
+			CHECK_ERROR(IsLineStateKnown(line), L"RegexDocumentColorizer_<T>::GetLineColorizer(vint)#The start state of the line is unknown.");
+			auto lineColorizer = colorizer;
+			lineColorizer.SetInternalState(lineStates[line]);
+			return lineColorizer;
+		}
+
+		template<typename T>
+		void* RegexDocumentColorizer_<T>::ColorizeLine(vint line, const T* input, vint length)
+		{
+			CHECK_ERROR(IsLineStateKnown(line) && line < GetLineCount(), L"RegexDocumentColorizer_<T>::ColorizeLine(vint, const T*, vint)#The start state of the line is unknown.");
+			colorizer.SetInternalState(lineStates[line]);
+			auto interTokenState = colorizer.Colorize(input, length);
+			if (line == firstDirtyLine)
+			{
+				StoreLineEndState(line);
+			}
+			return interTokenState;
 		}
 
 /***********************************************************************
@@ -1013,14 +1808,56 @@ RegexLexerBase_
 			if (pure) delete pure;
 		}
 
+#ifdef VCZH_REGEX_STATISTICS
+		RegexStatistics RegexLexerBase_::GetStatistics()const
+		{
+			RegexStatistics result = statistics;
+			result.dfa = true;
+			AddPureStatistics(result, pure);
+			AddCounters(result, pure->counters);
+			return result;
+		}
+
+		void RegexLexerBase_::ResetStatistics()const
+		{
+			statistics.dfaCalls = 0;
+			pure->counters = {};
+		}
+#endif
+
+		void RegexLexerBase_::LoadStateTokens()
+		{
+			auto tokens = pure->GetStateTokens();
+			if (!tokens)
+			{
+				throw RegexImageException(L"RegexLexerBase_::LoadStateTokens()#The image is not a serialized lexical analyzer.", RegexImageException::Reason::Incompatible);
+			}
+
+			stateTokens.Resize(pure->GetStateCount());
+			for (vint i = 0; i < stateTokens.Count(); i++)
+			{
+				stateTokens[i] = tokens[i];
+			}
+		}
+
 		template<typename T>
 		RegexTokens_<T> RegexLexerBase_::Parse(const ObjectString<T>& code, RegexProc_<T> proc, vint codeIndex)const
 		{
 			code.Buffer();
 			pure->PrepareForRelatedFinalStateTable();
+			REGEX_STATISTICS(statistics.dfaCalls++);
 			return RegexTokens_<T>(pure, stateTokens, code, codeIndex, proc);
 		}
 
+		template<typename T>
+		RegexIncrementalTokens_<T> RegexLexerBase_::ParseIncrementally(const ObjectString<T>& code, vint codeIndex)const
+		{
+			code.Buffer();
+			pure->PrepareForRelatedFinalStateTable();
+			REGEX_STATISTICS(statistics.dfaCalls++);
+			return RegexIncrementalTokens_<T>(pure, stateTokens, code, codeIndex);
+		}
+
 		template<typename T>
 		RegexLexerWalker_<T> RegexLexerBase_::Walk()const
 		{
@@ -1040,6 +1877,306 @@ RegexLexerBase_
 			return RegexLexerColorizer_<T>(Walk<T>(), proc);
 		}
 
+		template<typename T>
+		RegexDocumentColorizer_<T> RegexLexerBase_::ColorizeDocument(RegexProc_<T> proc)const
+		{
+			return RegexDocumentColorizer_<T>(Colorize<T>(proc));
+		}
+
+/***********************************************************************
+Code Generation
+***********************************************************************/
+
+		void WriteGeneratedLines(stream::TextWriter_<wchar_t>& writer, const wchar_t* const* lines, vint count)
+		{
+			for (vint i = 0; i < count; i++)
+			{
+				writer.WriteLine(lines[i]);
+			}
+		}
+
+		template<typename F>
+		void WriteGeneratedStateTable(stream::TextWriter_<wchar_t>& writer, vint stateCount, const wchar_t* comment, const wchar_t* declaration, F&& getItem)
+		{
+			writer.WriteLine(WString(L"\t// ") + comment);
+			writer.WriteLine(WString(L"\tstatic constexpr ") + declaration + L" = {");
+			for (vint i = 0; i < stateCount; i++)
+			{
+				writer.WriteLine(L"\t\t" + getItem(i) + L",");
+			}
+			writer.WriteLine(L"\t};");
+			writer.WriteLine(L"");
+		}
+
+		void WriteGeneratedClassBegin(stream::TextWriter_<wchar_t>& writer, PureInterpretor* pure, const wchar_t* generator, const WString& className, const WString& includeFile)
+		{
+			vint charRangeCount = pure->GetCharRangeCount();
+			vint stateCount = pure->GetStateCount();
+
+			WString guard = L"VCZH_REGEX_GENERATED_" + wupper(className);
+			writer.WriteLine(L"/***********************************************************************");
+			writer.WriteLine(WString(L"This file is generated by ") + generator + L", DO NOT MODIFY");
+			writer.WriteLine(L"***********************************************************************/");
+			writer.WriteLine(L"");
+			writer.WriteLine(L"#ifndef " + guard);
+			writer.WriteLine(L"#define " + guard);
+			writer.WriteLine(L"");
+			writer.WriteLine(L"#include \"" + includeFile + L"\"");
+			writer.WriteLine(L"");
+			writer.WriteLine(L"class " + className);
+			writer.WriteLine(L"{");
+			writer.WriteLine(L"public:");
+			writer.WriteLine(L"\tstatic constexpr vl::vint StateCount = " + itow(stateCount) + L";");
+			writer.WriteLine(L"\tstatic constexpr vl::vint CharSetCount = " + itow(charRangeCount) + L";");
+			writer.WriteLine(L"\tstatic constexpr vl::vint StartState = " + itow(pure->GetStartState()) + L";");
+			writer.WriteLine(L"");
+
+			writer.WriteLine(L"\t// char set -> { begin, end }");
+			writer.WriteLine(L"\tstatic constexpr char32_t CharRanges[CharSetCount][2] = {");
+			for (vint i = 0; i < charRangeCount; i++)
+			{
+				auto range = pure->GetCharRange(i);
+				writer.WriteLine(L"\t\t{ " + itow((vint)range.begin) + L", " + itow((vint)range.end) + L" },");
+			}
+			writer.WriteLine(L"\t};");
+			writer.WriteLine(L"");
+
+			WriteGeneratedStateTable(writer, stateCount, L"(state, char set) -> state", L"vl::vint Transitions[StateCount][CharSetCount]", [&](vint state)
+			{
+				WString line = L"{";
+				for (vint i = 0; i < charRangeCount; i++)
+				{
+					line += (i == 0 ? L" " : L", ") + itow(pure->Transit(pure->GetCharRange(i).begin, state));
+				}
+				return line + L" }";
+			});
+		}
+
+		void WriteGeneratedGetCharSet(stream::TextWriter_<wchar_t>& writer)
+		{
+			const wchar_t* getCharSet[] = {
+				L"\tstatic constexpr vl::vint GetCharSet(char32_t c)",
+				L"\t{",
+				L"\t\tvl::vint start = 0;",
+				L"\t\tvl::vint end = CharSetCount - 1;",
+				L"\t\twhile (start <= end)",
+				L"\t\t{",
+				L"\t\t\tvl::vint middle = (start + end) / 2;",
+				L"\t\t\tif (c < CharRanges[middle][0]) end = middle - 1;",
+				L"\t\t\telse if (c > CharRanges[middle][1]) start = middle + 1;",
+				L"\t\t\telse return middle;",
+				L"\t\t}",
+				L"\t\treturn -1;",
+				L"\t}",
+				L"",
+			};
+			WriteGeneratedLines(writer, getCharSet, sizeof(getCharSet) / sizeof(*getCharSet));
+		}
+
+		void WriteGeneratedFooter(stream::TextWriter_<wchar_t>& writer)
+		{
+			writer.WriteLine(L"};");
+			writer.WriteLine(L"");
+			writer.WriteLine(L"#endif");
+		}
+
+		void RegexBase_::GenerateCpp(stream::TextWriter_<wchar_t>& writer, const WString& className, const WString& includeFile)const
+		{
+			CHECK_ERROR(pure != nullptr, L"RegexBase_::GenerateCpp(TextWriter&, const WString&, const WString&)#Code generation requires a DFA, which is not built for this regular expression.");
+			CHECK_ERROR(pure->GetCharRangeCount() > 0, L"RegexBase_::GenerateCpp(TextWriter&, const WString&, const WString&)#The regular expression should consume at least one character.");
+
+			WriteGeneratedClassBegin(writer, pure, L"Regex::GenerateCpp", className, includeFile);
+			WriteGeneratedStateTable(writer, pure->GetStateCount(), L"state -> final", L"bool FinalStates[StateCount]", [&](vint state)
+			{
+				return WString(pure->IsFinalState(state) ? L"true" : L"false");
+			});
+			WriteGeneratedGetCharSet(writer);
+
+			const wchar_t* functions[] = {
+				L"\t// find the longest match at the beginning of the input",
+				L"\ttemplate<typename T>",
+				L"\tstatic bool MatchHead(const T* input, vl::vint& length)",
+				L"\t{",
+				L"\t\tvl::encoding::UtfStringToStringReader<T, char32_t> reader(input);",
+				L"\t\tvl::vint state = StartState;",
+				L"\t\tlength = -1;",
+				L"",
+				L"\t\twhile (state != -1)",
+				L"\t\t{",
+				L"\t\t\tauto c = reader.Read();",
+				L"\t\t\tif (FinalStates[state]) length = reader.SourceCluster().index;",
+				L"\t\t\tif (!c) break;",
+				L"\t\t\tvl::vint charSet = GetCharSet(c);",
+				L"\t\t\tstate = charSet == -1 ? -1 : Transitions[state][charSet];",
+				L"\t\t}",
+				L"\t\treturn length != -1;",
+				L"\t}",
+				L"",
+				L"\t// find the first match in the input",
+				L"\ttemplate<typename T>",
+				L"\tstatic bool Match(const T* input, vl::vint& start, vl::vint& length)",
+				L"\t{",
+				L"\t\tvl::encoding::UtfStringToStringReader<T, char32_t> reader(input);",
+				L"\t\twhile (reader.Read())",
+				L"\t\t{",
+				L"\t\t\tstart = reader.SourceCluster().index;",
+				L"\t\t\tif (MatchHead(input + start, length)) return true;",
+				L"\t\t}",
+				L"\t\tstart = -1;",
+				L"\t\tlength = -1;",
+				L"\t\treturn false;",
+				L"\t}",
+				L"",
+				L"\ttemplate<typename T>",
+				L"\tstatic bool TestHead(const T* input)",
+				L"\t{",
+				L"\t\tvl::vint length = -1;",
+				L"\t\treturn MatchHead(input, length);",
+				L"\t}",
+				L"",
+				L"\ttemplate<typename T>",
+				L"\tstatic bool Test(const T* input)",
+				L"\t{",
+				L"\t\tvl::vint start = -1;",
+				L"\t\tvl::vint length = -1;",
+				L"\t\treturn Match(input, start, length);",
+				L"\t}",
+			};
+			WriteGeneratedLines(writer, functions, sizeof(functions) / sizeof(*functions));
+			WriteGeneratedFooter(writer);
+		}
+
+		void RegexLexerBase_::GenerateCpp(stream::TextWriter_<wchar_t>& writer, const WString& className, const WString& includeFile)const
+		{
+			CHECK_ERROR(pure->GetCharRangeCount() > 0, L"RegexLexerBase_::GenerateCpp(TextWriter&, const WString&, const WString&)#The lexical analyzer should consume at least one character.");
+			pure->PrepareForRelatedFinalStateTable();
+
+			auto getToken = [&](vint state)
+			{
+				return state != -1 && pure->IsFinalState(state) ? stateTokens[state] : -1;
+			};
+
+			WriteGeneratedClassBegin(writer, pure, L"RegexLexer::GenerateCpp", className, includeFile);
+			WriteGeneratedStateTable(writer, pure->GetStateCount(), L"state -> token, -1 for non-final states", L"vl::vint StateTokens[StateCount]", [&](vint state)
+			{
+				return itow(getToken(state));
+			});
+			WriteGeneratedStateTable(writer, pure->GetStateCount(), L"state -> token of the related final state, which is the token of an incomplete token ending at this state", L"vl::vint RelatedStateTokens[StateCount]", [&](vint state)
+			{
+				return itow(getToken(pure->GetRelatedFinalState(state)));
+			});
+			WriteGeneratedGetCharSet(writer);
+
+			const wchar_t* functions[] = {
+				L"\t// find the longest token at the beginning of the input",
+				L"\t// when it fails, token is the token of an incomplete token ending at length, or -1",
+				L"\ttemplate<typename T>",
+				L"\tstatic bool MatchHead(const T* input, vl::vint& length, vl::vint& token)",
+				L"\t{",
+				L"\t\tvl::encoding::UtfStringToStringReader<T, char32_t> reader(input);",
+				L"\t\tvl::vint state = StartState;",
+				L"\t\tvl::vint terminateState = -1;",
+				L"\t\tvl::vint terminateLength = -1;",
+				L"\t\tlength = -1;",
+				L"\t\ttoken = -1;",
+				L"",
+				L"\t\twhile (state != -1)",
+				L"\t\t{",
+				L"\t\t\tauto c = reader.Read();",
+				L"\t\t\tterminateState = state;",
+				L"\t\t\tterminateLength = reader.SourceCluster().index;",
+				L"\t\t\tif (StateTokens[state] != -1)",
+				L"\t\t\t{",
+				L"\t\t\t\tlength = terminateLength;",
+				L"\t\t\t\ttoken = StateTokens[state];",
+				L"\t\t\t}",
+				L"",
+				L"\t\t\tif (!c) break;",
+				L"\t\t\tvl::vint charSet = GetCharSet(c);",
+				L"\t\t\tstate = charSet == -1 ? -1 : Transitions[state][charSet];",
+				L"\t\t}",
+				L"",
+				L"\t\tif (token != -1) return true;",
+				L"\t\tlength = terminateLength;",
+				L"\t\tif (terminateLength > 0) token = RelatedStateTokens[terminateState];",
+				L"\t\treturn false;",
+				L"\t}",
+				L"",
+				L"\t// tokenize the input in the same way as RegexLexer::Parse without any callback",
+				L"\ttemplate<typename T>",
+				L"\tstatic void Parse(const T* code, vl::collections::List<vl::regex::RegexToken_<T>>& tokens, vl::vint codeIndex = -1)",
+				L"\t{",
+				L"\t\tconst T* reading = code;",
+				L"\t\tvl::vint rowStart = 0;",
+				L"\t\tvl::vint columnStart = 0;",
+				L"\t\tvl::regex::RegexToken_<T> token;",
+				L"\t\ttoken.token = -2;",
+				L"",
+				L"\t\tauto addToken = [&]()",
+				L"\t\t{",
+				L"\t\t\ttoken.rowStart = rowStart;",
+				L"\t\t\ttoken.columnStart = columnStart;",
+				L"\t\t\ttoken.rowEnd = rowStart;",
+				L"\t\t\ttoken.columnEnd = columnStart;",
+				L"\t\t\tfor (vl::vint i = 0; i < token.length; i++)",
+				L"\t\t\t{",
+				L"\t\t\t\ttoken.rowEnd = rowStart;",
+				L"\t\t\t\ttoken.columnEnd = columnStart;",
+				L"\t\t\t\tif (token.reading[i] == '\\n')",
+				L"\t\t\t\t{",
+				L"\t\t\t\t\trowStart++;",
+				L"\t\t\t\t\tcolumnStart = 0;",
+				L"\t\t\t\t}",
+				L"\t\t\t\telse",
+				L"\t\t\t\t{",
+				L"\t\t\t\t\tcolumnStart++;",
+				L"\t\t\t\t}",
+				L"\t\t\t}",
+				L"\t\t\ttokens.Add(token);",
+				L"\t\t};",
+				L"",
+				L"\t\twhile (*reading)",
+				L"\t\t{",
+				L"\t\t\tvl::vint length = -1;",
+				L"\t\t\tvl::vint id = -1;",
+				L"\t\t\tbool completeToken = true;",
+				L"\t\t\tif (!MatchHead(reading, length, id))",
+				L"\t\t\t{",
+				L"\t\t\t\tif (id == -1)",
+				L"\t\t\t\t{",
+				L"\t\t\t\t\tvl::encoding::UtfStringToStringReader<T, char32_t> reader(reading);",
+				L"\t\t\t\t\treader.Read();",
+				L"\t\t\t\t\tlength = reader.SourceCluster().size;",
+				L"\t\t\t\t}",
+				L"\t\t\t\telse",
+				L"\t\t\t\t{",
+				L"\t\t\t\t\tcompleteToken = false;",
+				L"\t\t\t\t}",
+				L"\t\t\t}",
+				L"",
+				L"\t\t\tif (token.token == -1 && id == -1)",
+				L"\t\t\t{",
+				L"\t\t\t\ttoken.length += length;",
+				L"\t\t\t}",
+				L"\t\t\telse",
+				L"\t\t\t{",
+				L"\t\t\t\tif (token.token != -2) addToken();",
+				L"\t\t\t\ttoken.reading = reading;",
+				L"\t\t\t\ttoken.start = reading - code;",
+				L"\t\t\t\ttoken.length = length;",
+				L"\t\t\t\ttoken.token = id;",
+				L"\t\t\t\ttoken.codeIndex = codeIndex;",
+				L"\t\t\t\ttoken.completeToken = completeToken;",
+				L"\t\t\t}",
+				L"\t\t\treading += length;",
+				L"\t\t}",
+				L"\t\tif (token.token != -2) addToken();",
+				L"\t}",
+			};
+			WriteGeneratedLines(writer, functions, sizeof(functions) / sizeof(*functions));
+			WriteGeneratedFooter(writer);
+		}
+
 /***********************************************************************
 RegexLexer_<T> (Serialization)
 ***********************************************************************/
@@ -1048,24 +2185,20 @@ RegexLexer_<T> (Serialization)
 		RegexLexer_<T>::RegexLexer_(stream::IStream& inputStream)
 		{
 			pure = new PureInterpretor(inputStream);
-			vint count = 0;
-			ReadInt(inputStream, count);
-			stateTokens.Resize(count);
-			if (count > 0)
-			{
-				ReadInts(inputStream, count, &stateTokens[0]);
-			}
+			LoadStateTokens();
+		}
+
+		template<typename T>
+		RegexLexer_<T>::RegexLexer_(const void* image, vint size)
+		{
+			pure = new PureInterpretor(image, size);
+			LoadStateTokens();
 		}
 
 		template<typename T>
 		void RegexLexer_<T>::Serialize(stream::IStream& outputStream)
 		{
 			pure->Serialize(outputStream);
-			WriteInt(outputStream, stateTokens.Count());
-			if (stateTokens.Count() > 0)
-			{
-				WriteInts(outputStream, stateTokens.Count(), &stateTokens[0]);
-			}
 		}
 
 /***********************************************************************
@@ -1073,29 +2206,78 @@ RegexLexer_<T>
 ***********************************************************************/
 
 		template<typename T>
-		RegexLexer_<T>::RegexLexer_(const collections::IEnumerable<ObjectString<T>>& tokens)
+		RegexLexer_<T>::RegexLexer_(const collections::IEnumerable<ObjectString<T>>& tokens, vint maxDfaStateCount)
 		{
+			CHECK_ERROR(maxDfaStateCount == -1 || maxDfaStateCount > 0, L"RegexLexer_<T>::RegexLexer_(const IEnumerable<ObjectString<T>>&, vint)#The DFA should be allowed to have at least one state.");
+			auto checkDfa = [=](Ptr<Automaton> dfa)
+			{
+				if (!dfa)
+				{
+					throw RegexLimitException(L"RegexLexer_<T>::RegexLexer_(const IEnumerable<ObjectString<T>>&, vint)#The DFA needs more states than the limit.", maxDfaStateCount);
+				}
+				return dfa;
+			};
+
 			// Build DFA for all tokens
 			List<Ptr<Expression>> expressions;
 			List<Ptr<Automaton>> dfas;
+			List<vint> dfaTokens;
 			CharRange::List subsets;
 			for (auto&& code : tokens)
 			{
-				auto regex = ParseRegexExpression(U32<T>::ToU32(code));
-				auto expression = regex->Merge();
-				expression->CollectCharSet(subsets);
+				auto regex = REGEX_PHASE(parse, ParseRegexExpression(U32<T>::ToU32(code)));
+				auto expression = REGEX_PHASE(parse, regex->Merge());
+				REGEX_PHASE(parse, expression->CollectCharSet(subsets));
 				expressions.Add(expression);
 			}
+			vint tokenCount = expressions.Count();
+
+			// Literal tokens share a trie, which is already a DFA, instead of building a DFA for each of them
+			auto trie = Ptr(new Automaton);
+			trie->startState = trie->NewState();
 			// TODO: (enumerable) foreach
-			for (vint i = 0; i < expressions.Count(); i++)
+			for (vint i = 0; i < tokenCount; i++)
 			{
-				Dictionary<State*, State*> nfaStateMap;
-				Group<State*, State*> dfaStateMap;
-				expressions[i]->ApplyCharSet(subsets);
-				auto eNfa = expressions[i]->GenerateEpsilonNfa();
-				auto nfa = EpsilonNfaToNfa(eNfa, PureEpsilonChecker, nfaStateMap);
-				auto dfa = NfaToDfa(nfa, dfaStateMap);
-				dfas.Add(dfa);
+				U32String literal;
+				if (expressions[i]->IsLiteral(literal))
+				{
+					State* state = trie->startState;
+					for (vint j = 0; j < literal.Length(); j++)
+					{
+						State* next = nullptr;
+						for (auto transition : state->transitions)
+						{
+							if (transition->range.begin == literal[j])
+							{
+								next = transition->target;
+								break;
+							}
+						}
+						if (!next)
+						{
+							next = trie->NewState();
+							trie->NewChars(state, next, CharRange(literal[j], literal[j]));
+						}
+						state = next;
+					}
+					// the first token wins when a literal appears more than once
+					if (!state->finalState)
+					{
+						state->finalState = true;
+						state->userData = (void*)i;
+					}
+				}
+				else
+				{
+					Dictionary<State*, State*> nfaStateMap;
+					Group<State*, State*> dfaStateMap;
+					REGEX_PHASE(parse, expressions[i]->ApplyCharSet(subsets));
+					auto eNfa = REGEX_PHASE(epsilonNfa, expressions[i]->GenerateEpsilonNfa());
+					auto nfa = REGEX_PHASE(nfa, EpsilonNfaToNfa(eNfa, PureEpsilonChecker, nfaStateMap));
+					auto dfa = checkDfa(REGEX_PHASE(dfa, NfaToDfa(nfa, dfaStateMap, maxDfaStateCount)));
+					dfas.Add(dfa);
+					dfaTokens.Add(i);
+				}
 			}
 
 			// Mark all states in DFAs
@@ -1108,13 +2290,24 @@ RegexLexer_<T>
 				{
 					if (dfa->states[j]->finalState)
 					{
-						dfa->states[j]->userData = (void*)i;
+						dfa->states[j]->userData = (void*)dfaTokens[i];
 					}
 					else
 					{
-						dfa->states[j]->userData = (void*)dfas.Count();
+						dfa->states[j]->userData = (void*)tokenCount;
+					}
+				}
+			}
+			if (trie->states.Count() > 1)
+			{
+				for (auto state : trie->states)
+				{
+					if (!state->finalState)
+					{
+						state->userData = (void*)tokenCount;
 					}
 				}
+				dfas.Add(trie);
 			}
 
 			// Connect all DFAs to an e-NFA
@@ -1135,14 +2328,14 @@ RegexLexer_<T>
 			// Build a single DFA out of the e-NFA
 			Dictionary<State*, State*> nfaStateMap;
 			Group<State*, State*> dfaStateMap;
-			auto bigNfa = EpsilonNfaToNfa(bigEnfa, PureEpsilonChecker, nfaStateMap);
+			auto bigNfa = REGEX_PHASE(nfa, EpsilonNfaToNfa(bigEnfa, PureEpsilonChecker, nfaStateMap));
 			// TODO: (enumerable) foreach on dictionary
 			for (vint i = 0; i < nfaStateMap.Keys().Count(); i++)
 			{
 				void* userData = nfaStateMap.Values().Get(i)->userData;
 				nfaStateMap.Keys()[i]->userData = userData;
 			}
-			auto bigDfa = NfaToDfa(bigNfa, dfaStateMap);
+			auto bigDfa = checkDfa(REGEX_PHASE(dfa, NfaToDfa(bigNfa, dfaStateMap, maxDfaStateCount)));
 			// TODO: (enumerable) foreach on group
 			for (vint i = 0; i < dfaStateMap.Keys().Count(); i++)
 			{
@@ -1159,13 +2352,13 @@ RegexLexer_<T>
 			}
 
 			// Build state machine
-			pure = new PureInterpretor(bigDfa, subsets);
 			stateTokens.Resize(bigDfa->states.Count());
 			for (vint i = 0; i < stateTokens.Count(); i++)
 			{
 				void* userData = bigDfa->states[i]->userData;
 				stateTokens[i] = (vint)userData;
 			}
+			pure = REGEX_PHASE(table, new PureInterpretor(bigDfa, subsets, &stateTokens));
 		}
 
 /***********************************************************************
@@ -1219,11 +2412,26 @@ Template Instantiation
 		template class Regex_<char16_t>;
 		template class Regex_<char32_t>;
 
+		template void							RegexSetBase_::Matches<wchar_t>		(const ObjectString<wchar_t>& text, collections::List<vint>& ids)const;
+		template void							RegexSetBase_::Matches<char8_t>		(const ObjectString<char8_t>& text, collections::List<vint>& ids)const;
+		template void							RegexSetBase_::Matches<char16_t>	(const ObjectString<char16_t>& text, collections::List<vint>& ids)const;
+		template void							RegexSetBase_::Matches<char32_t>	(const ObjectString<char32_t>& text, collections::List<vint>& ids)const;
+
+		template class RegexSet_<wchar_t>;
+		template class RegexSet_<char8_t>;
+		template class RegexSet_<char16_t>;
+		template class RegexSet_<char32_t>;
+
 		template class RegexTokens_<wchar_t>;
 		template class RegexTokens_<char8_t>;
 		template class RegexTokens_<char16_t>;
 		template class RegexTokens_<char32_t>;
 
+		template class RegexIncrementalTokens_<wchar_t>;
+		template class RegexIncrementalTokens_<char8_t>;
+		template class RegexIncrementalTokens_<char16_t>;
+		template class RegexIncrementalTokens_<char32_t>;
+
 		template class RegexLexerWalker_<wchar_t>;
 		template class RegexLexerWalker_<char8_t>;
 		template class RegexLexerWalker_<char16_t>;
@@ -1234,21 +2442,34 @@ Template Instantiation
 		template class RegexLexerColorizer_<char16_t>;
 		template class RegexLexerColorizer_<char32_t>;
 
+		template class RegexDocumentColorizer_<wchar_t>;
+		template class RegexDocumentColorizer_<char8_t>;
+		template class RegexDocumentColorizer_<char16_t>;
+		template class RegexDocumentColorizer_<char32_t>;
+
 		template RegexTokens_<wchar_t>				RegexLexerBase_::Parse<wchar_t>		(const ObjectString<wchar_t>& code, RegexProc_<wchar_t> _proc, vint codeIndex)const;
+		template RegexIncrementalTokens_<wchar_t>	RegexLexerBase_::ParseIncrementally<wchar_t>(const ObjectString<wchar_t>& code, vint codeIndex)const;
 		template RegexLexerWalker_<wchar_t>			RegexLexerBase_::Walk<wchar_t>		()const;
 		template RegexLexerColorizer_<wchar_t>		RegexLexerBase_::Colorize<wchar_t>	(RegexProc_<wchar_t> _proc)const;
+		template RegexDocumentColorizer_<wchar_t>	RegexLexerBase_::ColorizeDocument<wchar_t>(RegexProc_<wchar_t> _proc)const;
 
 		template RegexTokens_<char8_t>				RegexLexerBase_::Parse<char8_t>		(const ObjectString<char8_t>& code, RegexProc_<char8_t> _proc, vint codeIndex)const;
+		template RegexIncrementalTokens_<char8_t>	RegexLexerBase_::ParseIncrementally<char8_t>(const ObjectString<char8_t>& code, vint codeIndex)const;
 		template RegexLexerWalker_<char8_t>			RegexLexerBase_::Walk<char8_t>		()const;
 		template RegexLexerColorizer_<char8_t>		RegexLexerBase_::Colorize<char8_t>	(RegexProc_<char8_t> _proc)const;
+		template RegexDocumentColorizer_<char8_t>	RegexLexerBase_::ColorizeDocument<char8_t>(RegexProc_<char8_t> _proc)const;
 
 		template RegexTokens_<char16_t>				RegexLexerBase_::Parse<char16_t>	(const ObjectString<char16_t>& code, RegexProc_<char16_t> _proc, vint codeIndex)const;
+		template RegexIncrementalTokens_<char16_t>	RegexLexerBase_::ParseIncrementally<char16_t>(const ObjectString<char16_t>& code, vint codeIndex)const;
 		template RegexLexerWalker_<char16_t>		RegexLexerBase_::Walk<char16_t>		()const;
 		template RegexLexerColorizer_<char16_t>		RegexLexerBase_::Colorize<char16_t>	(RegexProc_<char16_t> _proc)const;
+		template RegexDocumentColorizer_<char16_t>	RegexLexerBase_::ColorizeDocument<char16_t>(RegexProc_<char16_t> _proc)const;
 
 		template RegexTokens_<char32_t>				RegexLexerBase_::Parse<char32_t>	(const ObjectString<char32_t>& code, RegexProc_<char32_t> _proc, vint codeIndex)const;
+		template RegexIncrementalTokens_<char32_t>	RegexLexerBase_::ParseIncrementally<char32_t>(const ObjectString<char32_t>& code, vint codeIndex)const;
 		template RegexLexerWalker_<char32_t>		RegexLexerBase_::Walk<char32_t>		()const;
 		template RegexLexerColorizer_<char32_t>		RegexLexerBase_::Colorize<char32_t>	(RegexProc_<char32_t> _proc)const;
+		template RegexDocumentColorizer_<char32_t>	RegexLexerBase_::ColorizeDocument<char32_t>(RegexProc_<char32_t> _proc)const;
 
 		template class RegexLexer_<wchar_t>;
 		template class RegexLexer_<char8_t>;
@@ -13,12 +13,16 @@ namespace vl
 	namespace stream
 	{
 		class IStream;
+
+		template<typename T>
+		class TextWriter_;
 	}
 
 	namespace regex_internal
 	{
 		class PureResult;
 		class PureInterpretor;
+		class LazyInterpretor;
 		class RichResult;
 		class RichInterpretor;
 	}
@@ -138,16 +142,210 @@ Data Structure
 			const CaptureGroup&												Groups()const;
 		};
 
+		/// <summary>
+		/// The exception thrown when a serialized regular expression or lexical analyzer cannot be loaded.
+		/// The serialized data should be rebuilt from regular expressions when it happens.
+		/// </summary>
+		class RegexImageException : public Exception
+		{
+		public:
+			/// <summary>The reason of the failure.</summary>
+			enum class Reason
+			{
+				/// <summary>The data is shorter than it claims.</summary>
+				Truncated,
+				/// <summary>The data is not a serialized regular expression.</summary>
+				NotAnImage,
+				/// <summary>The data is serialized on a machine with a different byte order.</summary>
+				ByteOrder,
+				/// <summary>The data is serialized in a format version that is not supported.</summary>
+				Version,
+				/// <summary>The data requires features that are not supported, or it is not the expected kind of serialized object.</summary>
+				Incompatible,
+				/// <summary>The checksum does not match the data.</summary>
+				Checksum,
+				/// <summary>The data is inconsistent.</summary>
+				Corrupted,
+			};
+
+		protected:
+			Reason														reason;
+
+		public:
+			RegexImageException(const WString& _message, Reason _reason)
+				: Exception(_message)
+				, reason(_reason)
+			{
+			}
+
+			/// <summary>Get the reason of the failure.</summary>
+			/// <returns>The reason of the failure.</returns>
+			Reason														GetReason()const { return reason; }
+		};
+
+		/// <summary>
+		/// The exception thrown when a regular expression or a lexical analyzer needs a DFA with more states than the limit.
+		/// See [F:vl.regex.RegexOptions.maxDfaStateCount].
+		/// </summary>
+		class RegexLimitException : public Exception
+		{
+		protected:
+			vint														maxStateCount;
+
+		public:
+			RegexLimitException(const WString& _message, vint _maxStateCount)
+				: Exception(_message)
+				, maxStateCount(_maxStateCount)
+			{
+			}
+
+			/// <summary>Get the limit that is exceeded.</summary>
+			/// <returns>The maximum number of DFA states.</returns>
+			vint														GetMaxStateCount()const { return maxStateCount; }
+		};
+
+/***********************************************************************
+Statistics
+***********************************************************************/
+
+#ifdef VCZH_REGEX_STATISTICS
+		/// <summary>
+		/// Statistics of a <see cref="Regex_`1"/> or a <see cref="RegexLexer_`1"/>, only available when VCZH_REGEX_STATISTICS is defined.
+		/// Counters are accumulated by all calls since the object is created or <see cref="RegexBase_::ResetStatistics"/> is called.
+		/// </summary>
+		struct RegexStatistics
+		{
+			/// <summary>True if a DFA is built.</summary>
+			bool										dfa = false;
+			/// <summary>True if DFA states are built on demand, see [F:vl.regex.RegexOptions.lazyDfa].</summary>
+			bool										lazyDfa = false;
+			/// <summary>True if the backtracking interpretor is built, for captures and extensions that a DFA does not support.</summary>
+			bool										backtracking = false;
+			/// <summary>True if a DFA accepting a superset of the regular expression is built to skip positions for the backtracking interpretor.</summary>
+			bool										prefilter = false;
+
+			/// <summary>Number of DFA states, including the prefilter. For a lazy DFA it is the number of states in the cache.</summary>
+			vint										dfaStateCount = 0;
+			/// <summary>Number of character classes of all DFAs, including the prefilter.</summary>
+			vint										dfaCharSetCount = 0;
+			/// <summary>Number of states of the backtracking interpretor.</summary>
+			vint										backtrackingStateCount = 0;
+			/// <summary>Number of instructions of the backtracking interpretor.</summary>
+			vint										backtrackingInstructionCount = 0;
+			/// <summary>Bytes of all tables used while matching.</summary>
+			vint										tableBytes = 0;
+
+			/// <summary>Time to parse the regular expression, in nanoseconds. Times are 0 for an object loaded from a stream.</summary>
+			vuint64_t									parseNanoseconds = 0;
+			/// <summary>Time to build epsilon-NFA, in nanoseconds.</summary>
+			vuint64_t									epsilonNfaNanoseconds = 0;
+			/// <summary>Time to remove epsilon transitions, in nanoseconds.</summary>
+			vuint64_t									nfaNanoseconds = 0;
+			/// <summary>Time to build DFA, in nanoseconds.</summary>
+			vuint64_t									dfaNanoseconds = 0;
+			/// <summary>Time to build tables used while matching, in nanoseconds.</summary>
+			vuint64_t									tableNanoseconds = 0;
+
+			/// <summary>Number of calls handled by a DFA.</summary>
+			vint										dfaCalls = 0;
+			/// <summary>Number of calls handled by the backtracking interpretor.</summary>
+			vint										backtrackingCalls = 0;
+			/// <summary>Number of attempts to match from a position. For a lexical analyzer it is the number of tokens.</summary>
+			vint										matchHeads = 0;
+			/// <summary>Number of attempts to match from a position after the first one failed in the same call.</summary>
+			vint										matchHeadRestarts = 0;
+			/// <summary>Number of positions skipped by the prefilter.</summary>
+			vint										prefilterRejections = 0;
+			/// <summary>Number of code units read. A code unit is counted again when it is read again after restarting or backtracking.</summary>
+			vint										scannedChars = 0;
+			/// <summary>Number of backtracking.</summary>
+			vint										backtracks = 0;
+			/// <summary>The maximum number of states saved for backtracking in a single attempt.</summary>
+			vint										stateSaverHighWaterMark = 0;
+			/// <summary>Number of times the cache of a lazy DFA is dropped because it is full.</summary>
+			vint										lazyFlushes = 0;
+		};
+#endif
+
 /***********************************************************************
 Regex
 ***********************************************************************/
 
+		/// <summary>Options to create a <see cref="Regex_`1"/>.</summary>
+		struct RegexOptions
+		{
+			/// <summary>Set to true to use DFA if possible.</summary>
+			bool										preferPure = true;
+			/// <summary>
+			/// Set to true to build DFA states on demand while matching, instead of building the whole DFA in the constructor.
+			/// DFA states are stored in a cache of limited size, it makes the constructor fast and memory usage bounded for regular expressions producing huge DFA.
+			/// The cache is used by one matching call at a time, other calls from different threads at the same time simulate the NFA without touching the cache,
+			/// so the regular expression could still be used from multiple threads.
+			/// </summary>
+			bool										lazyDfa = false;
+			/// <summary>
+			/// The maximum number of DFA states to build, -1 for no limit. It also limits the cache when DFA states are built on demand.
+			/// When a DFA without captures needs more states, DFA states are built on demand instead, as if [F:vl.regex.RegexOptions.lazyDfa] is set.
+			/// When a DFA for captures or extensions needs more states, <see cref="RegexLimitException"/> is thrown.
+			/// </summary>
+			vint										maxDfaStateCount = -1;
+		};
+
+		/// <summary>Complexity of a regular expression, estimated by <see cref="Regex_`1::Analyze"/> without creating it.</summary>
+		struct RegexComplexity
+		{
+			/// <summary>Engines to match a regular expression.</summary>
+			enum class Engine
+			{
+				/// <summary>A DFA built in the constructor, matching in linear time.</summary>
+				Dfa,
+				/// <summary>A DFA built on demand while matching, for a DFA too large to build in the constructor.</summary>
+				LazyDfa,
+				/// <summary>The backtracking interpretor, required by captures, backreferences, lookaheads, "^", "$" and lazy loops.</summary>
+				Backtracking,
+			};
+
+			/// <summary>True if <see cref="RegexBase_::Match"/> needs the backtracking interpretor.</summary>
+			bool										requiresBacktracking = false;
+			/// <summary>True if <see cref="RegexBase_::Test"/> could run in a DFA.</summary>
+			bool										canTestWithDfa = false;
+			/// <summary>Number of NFA states for matching, it is the NFA for the backtracking interpretor if [F:vl.regex.RegexComplexity.requiresBacktracking] is true.</summary>
+			vint										nfaStateCount = 0;
+			/// <summary>Number of DFA states that the constructor would build for matching, it is the DFA for the backtracking interpretor if [F:vl.regex.RegexComplexity.requiresBacktracking] is true. It stops counting at the limit given to <see cref="Regex_`1::Analyze"/>.</summary>
+			vint										dfaStateCount = 0;
+			/// <summary>True if the DFA for matching needs more states than the limit. If [F:vl.regex.RegexComplexity.requiresBacktracking] is true, creating the regular expression with this limit throws <see cref="RegexLimitException"/>.</summary>
+			bool										dfaStateCountExceeded = false;
+			/// <summary>Number of repeating loops containing another repeating loop, like "(a+)+".</summary>
+			vint										nestedQuantifiers = 0;
+			/// <summary>Number of alternations in a repeating loop whose branches could start with the same character, like "(a|ab)*".</summary>
+			vint										overlappingAlternations = 0;
+			/// <summary>True if the backtracking interpretor is required and the regular expression could take exponential time.</summary>
+			bool										exponentialBacktracking = false;
+			/// <summary>The engine that should be used to match.</summary>
+			Engine										recommendedEngine = Engine::Dfa;
+			/// <summary>Options to create the regular expression with the recommended engine. The limit given to <see cref="Regex_`1::Analyze"/> is kept unless the regular expression could not be created with it.</summary>
+			RegexOptions								recommendedOptions;
+		};
+
 		class RegexBase_ abstract : public Object
 		{
 		protected:
 			regex_internal::PureInterpretor*			pure = nullptr;
+			regex_internal::LazyInterpretor*			lazy = nullptr;
 			regex_internal::RichInterpretor*			rich = nullptr;
+			regex_internal::PureInterpretor*			prefilter = nullptr;
+#ifdef VCZH_REGEX_STATISTICS
+			mutable RegexStatistics						statistics;
+#endif
 
+			template<typename T>
+			bool										MatchHeadPure(const T* input, const T* start, regex_internal::PureResult& result)const;
+			template<typename T>
+			bool										MatchPure(const T* input, const T* start, regex_internal::PureResult& result)const;
+			template<typename T>
+			bool										MatchHeadRich(const T* input, const T* start, regex_internal::RichResult& result)const;
+			template<typename T>
+			bool										MatchRich(const T* input, const T* start, regex_internal::RichResult& result)const;
 			template<typename T>
 			void										Process(const ObjectString<T>& text, bool keepEmpty, bool keepSuccess, bool keepFail, typename RegexMatch_<T>::List& matches)const;
 		public:
@@ -159,7 +357,14 @@ Regex
 			bool										IsPureMatch() const { return rich ? false : true; }
 			/// <summary>Test is a DFA used to test a string. It ignores all capturing.</summary>
 			/// <returns>Returns true if a DFA is used.</returns>
-			bool										IsPureTest() const { return pure ? true : false; }
+			bool										IsPureTest() const { return pure || lazy ? true : false; }
+#ifdef VCZH_REGEX_STATISTICS
+			/// <summary>Get engines, tables, compile time and counters of all calls. Only available when VCZH_REGEX_STATISTICS is defined.</summary>
+			/// <returns>The statistics.</returns>
+			RegexStatistics								GetStatistics()const;
+			/// <summary>Reset counters of all calls to 0. Only available when VCZH_REGEX_STATISTICS is defined.</summary>
+			void										ResetStatistics()const;
+#endif
 
 			/// <summary>Match a prefix of the text.</summary>
 			/// <typeparam name="T>The character type of the text to match.</typeparam>
@@ -277,6 +482,25 @@ Regex
 			void										Cut(const ObjectString<T>& text, bool keepEmptyMatch, typename RegexMatch_<T>::List& matches)const;
 			template<typename T>
 			void										Cut(const T* text, bool keepEmptyMatch, typename RegexMatch_<T>::List& matches) const { return Cut<T>(ObjectString<T>(text), keepEmptyMatch, matches); }
+
+			/// <summary>
+			/// Generate a C++ header containing a class that matches a text in the same way as this regular expression, ignoring all capturing.
+			/// The DFA is stored in constexpr tables, nothing is built at runtime.
+			/// The generated class has static functions "MatchHead", "Match", "TestHead" and "Test", producing the same result as <see cref="TestHead"/> and <see cref="Test"/>.
+			/// It only works when <see cref="IsPureTest"/> returns true and the regular expression is not created with [F:vl.regex.RegexOptions.lazyDfa].
+			/// </summary>
+			/// <param name="writer">The writer to receive the generated header.</param>
+			/// <param name="className">The name of the generated class.</param>
+			/// <param name="includeFile">The file to include in the generated header for Vlpp.</param>
+			void										GenerateCpp(stream::TextWriter_<wchar_t>& writer, const WString& className, const WString& includeFile)const;
+
+			/// <summary>
+			/// Serialize the compiled regular expression, including the DFA, the program for capturing and backtracking, and names of captures.
+			/// It could be loaded by the constructor of <see cref="Regex_`1"/> accepting a stream, without parsing the regular expression again.
+			/// It does not work when the regular expression is created with [F:vl.regex.RegexOptions.lazyDfa].
+			/// </summary>
+			/// <param name="outputStream">The stream to store the regular expression.</param>
+			void										Serialize(stream::IStream& outputStream)const;
 		};
 
 		/// <summary>
@@ -369,6 +593,7 @@ Regex
 		/// <p>
 		///     The regular expression has pupre mode and rich mode.
 		///     Pure mode means the regular expression is driven by a DFA, while the rich mode is not.
+		///     In rich mode, a DFA accepting a superset of the regular expression is still used to skip positions where no match could start.
 		/// </p>
 		/// <p>
 		///     The regular expression can test a string instead of matching.
@@ -388,11 +613,93 @@ Regex
 			/// <param name="code">The regular expression in a string.</param>
 			/// <param name="preferPure">Set to true to use DFA if possible.</param>
 			Regex_(const ObjectString<T>& code, bool preferPure = true);
+			/// <summary>Create a regular expression. It will crash if the regular expression produces syntax error.</summary>
+			/// <param name="code">The regular expression in a string.</param>
+			/// <param name="options">Options to create the regular expression.</param>
+			Regex_(const ObjectString<T>& code, RegexOptions options);
+			/// <summary>
+			/// Load a regular expression serialized by <see cref="RegexBase_::Serialize"/>.
+			/// It throws <see cref="RegexImageException"/> if the stream is damaged or incompatible.
+			/// </summary>
+			/// <param name="inputStream">The stream storing the regular expression.</param>
+			Regex_(stream::IStream& inputStream);
 			~Regex_() = default;
 
 			/// <summary>Get all names of named captures</summary>
 			/// <returns>All names of named captures.</summary>
 			const collections::List<ObjectString<T>>&	CaptureNames()const { return captureNames; }
+
+			/// <summary>
+			/// Estimate the cost of a regular expression without creating it, so that a dangerous one could be rejected or created with other options.
+			/// The DFA is built and dropped at the limit, shapes that make backtracking exponential are found by a heuristic that could report false positives.
+			/// It throws the same error as the constructor if the regular expression produces syntax error.
+			/// </summary>
+			/// <returns>The complexity.</returns>
+			/// <param name="code">The regular expression in a string.</param>
+			/// <param name="maxDfaStateCount">The maximum number of DFA states to build.</param>
+			static RegexComplexity						Analyze(const ObjectString<T>& code, vint maxDfaStateCount = 4096);
+		};
+
+/***********************************************************************
+RegexSet
+***********************************************************************/
+
+		class RegexSetBase_ abstract : public Object
+		{
+		protected:
+			regex_internal::PureInterpretor*			pure = nullptr;
+			collections::Array<vint>					stateIdStarts;		// state -> the first accepted pattern in stateIds, there is one more item for the end
+			collections::Array<vint>					stateIds;			// accepted patterns of all states
+			collections::List<vint>						richIds;			// patterns that cannot be merged into the DFA
+			collections::List<Ptr<RegexBase_>>			richPatterns;
+			vint										patternCount = 0;
+
+		public:
+			~RegexSetBase_();
+
+			/// <summary>Get the number of regular expressions.</summary>
+			/// <returns>The number of regular expressions.</returns>
+			vint										Count()const { return patternCount; }
+
+			/// <summary>Find all regular expressions that match a sub string of the text, ignoring all capturing.</summary>
+			/// <typeparam name="T>The character type of the text to match.</typeparam>
+			/// <param name="text">The text to match.</param>
+			/// <param name="ids">Returns indices of all succeeded regular expressions in ascending order.</param>
+			/// <remarks>All regular expressions which could be driven by a DFA are tested together by scanning the text only once.</remarks>
+			/// <example><![CDATA[
+			/// int main()
+			/// {
+			///     List<WString> patterns;
+			///     patterns.Add(L"error");
+			///     patterns.Add(L"warning");
+			///     patterns.Add(L"/d+");
+			///     RegexSet regexSet(patterns);
+			///     List<vint> ids;
+			///     regexSet.Matches(L"2 errors", ids);
+			///     for (auto id : ids)
+			///     {
+			///         Console::WriteLine(itow(id));
+			///     }
+			/// }
+			/// ]]></example>
+			template<typename T>
+			void										Matches(const ObjectString<T>& text, collections::List<vint>& ids)const;
+			template<typename T>
+			void										Matches(const T* text, collections::List<vint>& ids) const { return Matches<T>(ObjectString<T>(text), ids); }
+		};
+
+		/// <summary>A set of regular expressions, which could be tested against a text at the same time.</summary>
+		/// <typeparam name="T>The character type of the regular expression itself.</typeparam>
+		template<typename T>
+		class RegexSet_ : public RegexSetBase_
+		{
+		public:
+			NOT_COPYABLE(RegexSet_<T>);
+
+			/// <summary>Create a set of regular expressions. It will crash if any regular expression produces syntax error.</summary>
+			/// <param name="patterns">All regular expressions. The index of a regular expression in this argument is its id.</param>
+			RegexSet_(const collections::IEnumerable<ObjectString<T>>& patterns);
+			~RegexSet_() = default;
 		};
 
 /***********************************************************************
@@ -762,9 +1069,90 @@ Tokenizer
 			void										ReadToEnd(collections::List<RegexToken_<T>>& tokens, bool(*discard)(vint)=0)const;
 		};
 
+/***********************************************************************
+RegexIncrementalTokens
+***********************************************************************/
+
+		/// <summary>Tokens of a text, which are updated incrementally when the text is edited. Call <see cref="RegexLexer::ParseIncrementally"/> to create this object.</summary>
+		/// <typeparam name="T">The encoded code-unit type of the text.</typeparam>
+		/// <example><![CDATA[
+		/// int main()
+		/// {
+		///     List<WString> tokenDefs;
+		///     tokenDefs.Add(L"/d+");
+		///     tokenDefs.Add(L"/w+");
+		///     tokenDefs.Add(L"/s+");
+		/// 
+		///     RegexLexer lexer(tokenDefs);
+		///     auto tokens = lexer.ParseIncrementally(WString(L"I have 2 books."));
+		/// 
+		///     // replace "2" with "12"
+		///     tokens.Edit(WString(L"I have 12 books."), 7, 1, 2);
+		///     for (auto&& token : tokens.GetTokens())
+		///     {
+		///         Console::WriteLine(itow(token.token) + L": <" + WString::CopyFrom(token.reading, token.length) + L">");
+		///     }
+		/// }
+		/// ]]></example>
+		template<typename T>
+		class RegexIncrementalTokens_ : public Object
+		{
+			friend class RegexLexerBase_;
+		protected:
+			regex_internal::PureInterpretor*			pure;
+			const collections::Array<vint>*				stateTokens;
+			ObjectString<T>								code;
+			vint										codeIndex;
+			collections::List<RegexToken_<T>>			tokens;
+			collections::List<vint>						scannedEnds;		// token -> the position where the DFA stops when producing this token, exclusive
+
+			vint										Lex(vint first, vint editEnd, vint delta);
+
+			RegexIncrementalTokens_(regex_internal::PureInterpretor* _pure, const collections::Array<vint>& _stateTokens, const ObjectString<T>& _code, vint _codeIndex);
+		public:
+			RegexIncrementalTokens_(const RegexIncrementalTokens_<T>& tokens) = default;
+			~RegexIncrementalTokens_() = default;
+
+			/// <summary>Get the text that is tokenized.</summary>
+			/// <returns>The text.</returns>
+			const ObjectString<T>&						GetCode()const;
+			/// <summary>Get all tokens, which are the same as those from <see cref="RegexLexer::Parse"/> without callbacks.</summary>
+			/// <returns>All tokens. [F:vl.regex.RegexToken.reading] points to the text returned by <see cref="GetCode"/>.</returns>
+			const collections::List<RegexToken_<T>>&	GetTokens()const;
+			/// <summary>Update tokens after the text is edited.</summary>
+			/// <returns>The number of tokens that are tokenized again. Other tokens are reused with their positions updated.</returns>
+			/// <param name="newCode">The text after editing.</param>
+			/// <param name="editStart">The position where the edit begins, in encoded code units of <typeparamref name="T"/>.</param>
+			/// <param name="removedLength">The number of encoded code units removed from the text before editing.</param>
+			/// <param name="insertedLength">The number of encoded code units inserted to the text, which are in <paramref name="newCode"/> beginning at <paramref name="editStart"/>.</param>
+			/// <remarks>
+			/// Tokenizing starts again from the first token whose result could be changed by this edit,
+			/// and stops as soon as a new token ends at the beginning of an old token after the edited range.
+			/// All positions should stop at character boundaries.
+			/// </remarks>
+			vint										Edit(const ObjectString<T>& newCode, vint editStart, vint removedLength, vint insertedLength);
+		};
+
 /***********************************************************************
 RegexLexerWalker
 ***********************************************************************/
+
+		/// <summary>A Unicode scalar that is reported by <see cref="RegexLexerWalker::WalkRange"/>.</summary>
+		struct RegexWalkEvent
+		{
+			/// <summary>The position of the Unicode scalar in the input, in encoded code units.</summary>
+			vint										start = 0;
+			/// <summary>Size of the Unicode scalar in encoded code units.</summary>
+			vint										length = 0;
+			/// <summary>The state after walking this Unicode scalar.</summary>
+			vint										state = -1;
+			/// <summary>The token index at the end of the token, or -1.</summary>
+			vint										token = -1;
+			/// <summary>True if it reach the end of the token.</summary>
+			bool										finalState = false;
+			/// <summary>True if the previous Unicode scalar is the end of the token.</summary>
+			bool										previousTokenStop = false;
+		};
 		
 		/// <summary>A type for walking through a text against a <see cref="RegexLexer"/>. Call <see cref="RegexLexer::Walk"/> to create this object.</summary>
 		/// <typeparam name="T">The encoded code-unit type accepted by <see cref="Walk"/> and range-based APIs.</typeparam>
@@ -888,6 +1276,23 @@ RegexLexerWalker
 			/// <param name="input">One encoded code unit of <typeparamref name="T"/>.</param>
 			/// <param name="state">The current state.</param>
 			vint										Walk(T input, vint state)const;
+			/// <summary>Step forward through a range of encoded code units.</summary>
+			/// <returns>Returns the new current state.</returns>
+			/// <param name="input">The input text.</param>
+			/// <param name="length">Size of the input text in encoded code units of <typeparamref name="T"/>.</param>
+			/// <param name="state">The current state.</param>
+			/// <param name="events">Unicode scalars that make "finalState" or "previousTokenStop" true are appended to this list.</param>
+			/// <remarks>
+			/// <p>
+			/// It is equivalent to calling <see cref="Walk"/> for each encoded code unit,
+			/// but the text is decoded at once and Unicode scalars that change nothing about tokens are not reported.
+			/// </p>
+			/// <p>
+			/// The input must contain valid, complete UTF sequences,
+			/// and it should not be called when <see cref="Walk"/> is in the middle of a UTF sequence.
+			/// </p>
+			/// </remarks>
+			vint										WalkRange(const T* input, vint length, vint state, collections::List<RegexWalkEvent>& events)const;
 			/// <summary>Test if the input text is a closed token.</summary>
 			/// <returns>Returns true if the input text is a closed token.</returns>
 			/// <param name="input">The input text.</param>
@@ -995,6 +1400,17 @@ RegexLexerWalker
 RegexLexerColorizer
 ***********************************************************************/
 
+		/// <summary>A range of encoded code units in the same color, filled by <see cref="RegexLexerColorizer::ColorizeSpans"/>.</summary>
+		struct RegexColorizeSpan
+		{
+			/// <summary>The position of the first encoded code unit.</summary>
+			vint										start = 0;
+			/// <summary>The number of encoded code units.</summary>
+			vint										length = 0;
+			/// <summary>The token index, or -1 for unrecognized text.</summary>
+			vint										token = -1;
+		};
+
 		/// <summary>Lexical colorizer. Call <see cref="RegexLexer::Colorize"/> to create this object.</summary>
 		/// <typeparam name="T">The encoded code-unit type of colorized buffers and callbacks.</typeparam>
 		/// <example><![CDATA[
@@ -1056,6 +1472,8 @@ RegexLexerColorizer
 		class RegexLexerColorizer_ : public Object
 		{
 			friend class RegexLexerBase_;
+			template<typename U>
+			friend class RegexDocumentColorizer_;
 		public:
 			struct InternalState
 			{
@@ -1064,6 +1482,19 @@ RegexLexerColorizer
 				void*									interTokenState = nullptr;
 				T									readingBuffer[6] = {};
 				vint									readingLength = 0;
+
+				bool operator==(const InternalState& state)const
+				{
+					if (currentState != state.currentState) return false;
+					if (interTokenId != state.interTokenId) return false;
+					if (interTokenState != state.interTokenState) return false;
+					if (readingLength != state.readingLength) return false;
+					for (vint i = 0; i < readingLength; i++)
+					{
+						if (readingBuffer[i] != state.readingBuffer[i]) return false;
+					}
+					return true;
+				}
 			};
 
 		protected:
@@ -1071,8 +1502,11 @@ RegexLexerColorizer
 			RegexProc_<T>								proc;
 			InternalState								internalState;
 
-			void										CallExtendProcAndColorizeProc(const T* input, vint length, RegexProcessingToken& token, bool colorize);
-			vint										WalkOneToken(const T* input, vint length, vint start, bool colorize);
+			void										CallExtendProc(const T* input, vint length, RegexProcessingToken& token);
+			void										CallExtendProcForInterToken(const T* input, vint length, RegexProcessingToken& token);
+
+			template<typename TColorize>
+			vint										WalkOneToken(const T* input, vint length, vint start, TColorize&& colorize);
 
 			RegexLexerColorizer_(const RegexLexerWalker_<T>& _walker, RegexProc_<T> _proc);
 		public:
@@ -1114,6 +1548,227 @@ RegexLexerColorizer
 			/// <p>Callbacks in <see cref="RegexProc"/> will be called, which is from the second argument of the constructor of <see cref="RegexLexer"/>.</p>
 			/// </remarks>
 			void*										Colorize(const T* input, vint length);
+			/// <summary>Colorize a text with a callable object instead of <see cref="RegexProc::colorizeProc"/>.</summary>
+			/// <typeparam name="TColorize">The type of the callable object, which could be inlined into the colorizing loop.</typeparam>
+			/// <returns>An inter token state at the end of this line. It could be the same object to which is returned from the previous call.</returns>
+			/// <param name="input">The text to colorize.</param>
+			/// <param name="length">Size of the text in encoded code units of <typeparamref name="T"/>.</param>
+			/// <param name="colorize">The callable object, called with the start, the length and the token index of each token, just like <see cref="RegexProc::colorizeProc"/>.</param>
+			/// <remarks>
+			/// <p>See <see cref="RegexProcessingToken::interTokenState"/> and <see cref="RegexProc::extendProc"/> for more information about the return value.</p>
+			/// <p>Callbacks in <see cref="RegexProc"/> will be called except colorizeProc.</p>
+			/// </remarks>
+			template<typename TColorize>
+			void*										Colorize(const T* input, vint length, TColorize&& colorize)
+			{
+				CHECK_ERROR(
+					internalState.readingLength == 0,
+					L"RegexLexerColorizer::Colorize(const T*, vint, TColorize&&)#Pass(T) must complete a UTF sequence before colorizing a buffer."
+				);
+				vint index = 0;
+				while (index != length)
+				{
+					index = WalkOneToken(input, length, index, colorize);
+				}
+				return internalState.interTokenState;
+			}
+			/// <summary>Colorize a text into spans instead of calling <see cref="RegexProc::colorizeProc"/>.</summary>
+			/// <returns>The number of spans, which could be larger than <paramref name="capacity"/>.</returns>
+			/// <param name="input">The text to colorize.</param>
+			/// <param name="length">Size of the text in encoded code units of <typeparamref name="T"/>.</param>
+			/// <param name="spans">The buffer of spans.</param>
+			/// <param name="capacity">Size of the buffer of spans. Spans over the capacity are counted but not written.</param>
+			/// <remarks>
+			/// <p>Adjacent tokens of the same token index are merged into one span, so the number of spans never exceeds <paramref name="length"/>.</p>
+			/// <p>The inter token state at the end of this line is stored in <see cref="GetInternalState"/>.</p>
+			/// <p>Callbacks in <see cref="RegexProc"/> will be called except colorizeProc.</p>
+			/// </remarks>
+			vint										ColorizeSpans(const T* input, vint length, RegexColorizeSpan* spans, vint capacity);
+			/// <summary>Colorize a text into token indices of each encoded code unit instead of calling <see cref="RegexProc::colorizeProc"/>.</summary>
+			/// <returns>The number of spans, see <see cref="ColorizeSpans"/>.</returns>
+			/// <param name="input">The text to colorize.</param>
+			/// <param name="length">Size of the text in encoded code units of <typeparamref name="T"/>.</param>
+			/// <param name="tokens">The buffer of token indices, containing at least <paramref name="length"/> items. -1 is stored as 0xFFFF.</param>
+			/// <remarks>
+			/// <p>Token indices should be less than 0xFFFF.</p>
+			/// <p>The inter token state at the end of this line is stored in <see cref="GetInternalState"/>.</p>
+			/// <p>Callbacks in <see cref="RegexProc"/> will be called except colorizeProc.</p>
+			/// </remarks>
+			vint										ColorizeTokens(const T* input, vint length, vuint16_t* tokens);
+		};
+
+		template<typename T>
+		template<typename TColorize>
+		vint RegexLexerColorizer_<T>::WalkOneToken(const T* input, vint length, vint start, TColorize&& colorize)
+		{
+			if (internalState.interTokenState)
+			{
+				RegexProcessingToken token(-1, -1, internalState.interTokenId, false, internalState.interTokenState);
+				CallExtendProcForInterToken(input, length, token);
+				colorize(0, token.length, token.token);
+				return token.length;
+			}
+
+			vint lastFinalStateLength = 0;
+			vint lastFinalStateToken = -1;
+			vint lastFinalStateState = -1;
+
+			vint tokenStartState = internalState.currentState;
+			encoding::UtfStringRangeToStringRangeReader<T, char32_t> reader(input + start, length - start);
+			while (auto c = reader.Read())
+			{
+				auto cluster = reader.SourceCluster();
+				vint i = start + cluster.index;
+				vint next = i + cluster.size;
+				vint currentToken = -1;
+				bool finalState = false;
+				bool previousTokenStop = false;
+				walker.WalkScalar(c, internalState.currentState, currentToken, finalState, previousTokenStop);
+
+				if (previousTokenStop)
+				{
+					if (proc.extendProc && lastFinalStateToken != -1)
+					{
+						RegexProcessingToken token(start, lastFinalStateLength, lastFinalStateToken, true, nullptr);
+						CallExtendProc(input, length, token);
+						colorize(token.start, token.length, token.token);
+						if (token.completeToken)
+						{
+							internalState.currentState = walker.GetStartState();
+						}
+						return start + token.length;
+					}
+					else if (i == start)
+					{
+						if (tokenStartState == GetStartState())
+						{
+							colorize(start, cluster.size, -1);
+							internalState.currentState = walker.GetStartState();
+							return next;
+						}
+					}
+					else if (lastFinalStateLength == 0)
+					{
+						// no token is recognized before the walking fails, skip the consumed prefix and restart from the current char
+						colorize(start, i - start, -1);
+						internalState.currentState = walker.GetStartState();
+						return i;
+					}
+					else
+					{
+						colorize(start, lastFinalStateLength, lastFinalStateToken);
+						internalState.currentState = lastFinalStateState;
+						return start + lastFinalStateLength;
+					}
+				}
+
+				if (finalState)
+				{
+					lastFinalStateLength = next - start;
+					lastFinalStateToken = currentToken;
+					lastFinalStateState = internalState.currentState;
+				}
+			}
+
+			if (lastFinalStateToken != -1 && start + lastFinalStateLength == length)
+			{
+				RegexProcessingToken token(start, lastFinalStateLength, lastFinalStateToken, true, nullptr);
+				if (proc.extendProc)
+				{
+					CallExtendProc(input, length, token);
+				}
+				colorize(token.start, token.length, token.token);
+			}
+			else
+			{
+				colorize(start, length - start, walker.GetRelatedToken(internalState.currentState));
+			}
+			return length;
+		}
+
+/***********************************************************************
+RegexDocumentColorizer
+***********************************************************************/
+
+		/// <summary>
+		/// Lexical colorizer for a multi-lined document, which caches the colorizer state at the beginning of each line.
+		/// Call <see cref="RegexLexer::ColorizeDocument"/> to create this object.
+		/// </summary>
+		/// <typeparam name="T">The encoded code-unit type of colorized buffers and callbacks.</typeparam>
+		/// <remarks>
+		/// <p>
+		/// Each line given to this object should contain its line break, except the last line.
+		/// After lines are edited, call <see cref="Update"/> to walk through edited lines again,
+		/// it stops as soon as a line ends in the same state as before, because all following lines are not affected.
+		/// </p>
+		/// <p>
+		/// When the start state of a line is known, <see cref="GetLineColorizer"/> creates an independent colorizer for it,
+		/// so that different ranges of lines could be colorized in parallel.
+		/// </p>
+		/// <p>
+		/// States are compared by value, including [F:vl.regex.RegexProcessingToken.interTokenState].
+		/// If <see cref="RegexProc::extendProc"/> creates a new inter token state object for each call, walking will not stop early at lines ending inside such a token.
+		/// </p>
+		/// </remarks>
+		template<typename T>
+		class RegexDocumentColorizer_ : public Object
+		{
+			friend class RegexLexerBase_;
+		public:
+			using InternalState = typename RegexLexerColorizer_<T>::InternalState;
+			/// <summary>A callback to read a line, returning the text of the line with its line break.</summary>
+			using ReadLineProc = const T*(*)(void* argument, vint line, vint& length);
+
+		protected:
+			RegexLexerColorizer_<T>						colorizer;
+			collections::List<InternalState>			lineStates;					// line -> the state before this line, there is one more item for the state after the last line
+			vint										firstDirtyLine = -1;		// the first line which ends in an unknown state, the start state of every line until this one is known
+			vint										lastDirtyLine = -1;			// walking must not stop before passing this line
+
+			void										MarkDirty(vint first, vint last);
+			void										StoreLineEndState(vint line);
+			bool										IsLineStateKnown(vint line)const;
+
+			RegexDocumentColorizer_(const RegexLexerColorizer_<T>& _colorizer);
+		public:
+			RegexDocumentColorizer_(const RegexDocumentColorizer_<T>& colorizer) = default;
+			~RegexDocumentColorizer_() = default;
+
+			/// <summary>Get the number of lines.</summary>
+			/// <returns>The number of lines.</returns>
+			vint										GetLineCount()const;
+			/// <summary>Get the first line whose colorizer state at the end is unknown.</summary>
+			/// <returns>The line number, or -1 if states of all lines are known. The start state of every line until this one is known.</returns>
+			vint										GetFirstDirtyLine()const;
+			/// <summary>Insert empty lines.</summary>
+			/// <param name="line">The position of the first inserted line.</param>
+			/// <param name="count">The number of inserted lines.</param>
+			void										InsertLines(vint line, vint count);
+			/// <summary>Remove lines.</summary>
+			/// <param name="line">The first removed line.</param>
+			/// <param name="count">The number of removed lines.</param>
+			void										RemoveLines(vint line, vint count);
+			/// <summary>Notify that a line is edited.</summary>
+			/// <param name="line">The edited line.</param>
+			void										EditLine(vint line);
+			/// <summary>Walk through edited lines until colorizer states of all lines until the specified one are known.</summary>
+			/// <returns>The number of lines walked through.</returns>
+			/// <param name="lastLine">The last line whose start state is needed, usually the last visible line.</param>
+			/// <param name="readLine">The callback to read a line.</param>
+			/// <param name="argument">The argument for the callback.</param>
+			/// <remarks>Callbacks in <see cref="RegexProc"/> will be called except colorizeProc.</remarks>
+			vint										Update(vint lastLine, ReadLineProc readLine, void* argument);
+			/// <summary>Create a colorizer for a line, whose start state should be known.</summary>
+			/// <returns>The colorizer, which is not affected by this object or other colorizers.</returns>
+			/// <param name="line">The line.</param>
+			RegexLexerColorizer_<T>						GetLineColorizer(vint line)const;
+			/// <summary>Colorize a line, whose start state should be known.</summary>
+			/// <returns>The inter token state at the end of the line, see <see cref="RegexLexerColorizer::Colorize"/>.</returns>
+			/// <param name="line">The line.</param>
+			/// <param name="input">The text of the line with its line break.</param>
+			/// <param name="length">Size of the text in encoded code units of <typeparamref name="T"/>.</param>
+			/// <remarks>If this line is the first dirty line, the state at the end of this line is also updated.</remarks>
+			void*										ColorizeLine(vint line, const T* input, vint length);
 		};
 
 /***********************************************************************
@@ -1125,10 +1780,23 @@ RegexLexer
 		protected:
 			regex_internal::PureInterpretor*			pure = nullptr;
 			collections::Array<vint>					stateTokens;
+#ifdef VCZH_REGEX_STATISTICS
+			mutable RegexStatistics						statistics;
+#endif
 
+			void										LoadStateTokens();
 		public:
 			~RegexLexerBase_();
 
+#ifdef VCZH_REGEX_STATISTICS
+			/// <summary>Get tables, compile time and counters of all tokenizing. Only available when VCZH_REGEX_STATISTICS is defined.</summary>
+			/// <returns>The statistics.</returns>
+			/// <remarks>Only tokens produced by <see cref="Parse"/> and <see cref="ParseIncrementally"/> are counted, walkers and colorizers are not instrumented.</remarks>
+			RegexStatistics								GetStatistics()const;
+			/// <summary>Reset counters of all tokenizing to 0. Only available when VCZH_REGEX_STATISTICS is defined.</summary>
+			void										ResetStatistics()const;
+#endif
+
 			/// <summary>Tokenize an input text.</summary>
 			/// <typeparam name="T">The encoded code-unit type of the text to parse.</typeparam>
 			/// <returns>All tokens, including recognized tokens or unrecognized tokens. For unrecognized tokens, [F:vl.regex.RegexToken.token] will be -1.</returns>
@@ -1140,6 +1808,14 @@ RegexLexer
 			RegexTokens_<T>								Parse(const ObjectString<T>& code, RegexProc_<T> proc = {}, vint codeIndex = -1)const;
 			template<typename T>
 			RegexTokens_<T>								Parse(const T* code, RegexProc_<T> proc = {}, vint codeIndex = -1) const { return Parse<T>(ObjectString<T>(code), proc, codeIndex); }
+			/// <summary>Tokenize an input text, and keep information to update tokens incrementally when the text is edited.</summary>
+			/// <typeparam name="T">The encoded code-unit type of the text to parse.</typeparam>
+			/// <returns>All tokens, which could be updated by <see cref="RegexIncrementalTokens::Edit"/>.</returns>
+			/// <param name="code">The text to tokenize.</param>
+			/// <param name="codeIndex">Extra information that will be copied to [F:vl.regex.RegexToken.codeIndex].</param>
+			/// <remarks>Callbacks in <see cref="RegexProc"/> are not supported, because they could make a token depend on any text before it.</remarks>
+			template<typename T>
+			RegexIncrementalTokens_<T>					ParseIncrementally(const ObjectString<T>& code, vint codeIndex = -1)const;
 			/// <summary>Create a equivalence walker from this lexical analyzer. A walker enable you to walk throught characters one by one,</summary>
 			/// <typeparam name="TInput>The character type of the text to parse.</typeparam>
 			/// <returns>The walker.</returns>
@@ -1152,6 +1828,22 @@ RegexLexer
 			/// <param name="proc">Configuration of all callbacks.</param>
 			template<typename T>
 			RegexLexerColorizer_<T>						Colorize(RegexProc_<T> proc)const;
+			/// <summary>Create a equivalence colorizer for a multi-lined document from this lexical analyzer.</summary>
+			/// <typeparam name="TInput>The character type of the text to parse.</typeparam>
+			/// <returns>The colorizer, with no lines.</returns>
+			/// <param name="proc">Configuration of all callbacks.</param>
+			template<typename T>
+			RegexDocumentColorizer_<T>					ColorizeDocument(RegexProc_<T> proc)const;
+
+			/// <summary>
+			/// Generate a C++ header containing a class that tokenizes a text in the same way as this lexical analyzer.
+			/// The DFA is stored in constexpr tables, nothing is built or loaded at runtime.
+			/// The generated class has a static function "Parse" producing the same tokens as <see cref="Parse"/> when no callback is specified.
+			/// </summary>
+			/// <param name="writer">The writer to receive the generated header.</param>
+			/// <param name="className">The name of the generated class.</param>
+			/// <param name="includeFile">The file to include in the generated header for <see cref="RegexToken_`1"/>.</param>
+			void										GenerateCpp(stream::TextWriter_<wchar_t>& writer, const WString& className, const WString& includeFile)const;
 		};
 
 		/// <summary>Lexical analyzer.</summary>
@@ -1164,13 +1856,25 @@ RegexLexer
 
 			/// <summary>Create a lexical analyzer by a set of regular expressions. [F:vl.regex.RegexToken.token] will be the index of the matched regular expression in the first argument.</summary>
 			/// <param name="tokens">All regular expression, each one represent a kind of tokens.</param>
-			RegexLexer_(const collections::IEnumerable<ObjectString<T>>& tokens);
+			/// <param name="maxDfaStateCount">The maximum number of DFA states to build, -1 for no limit. <see cref="RegexLimitException"/> is thrown when the DFA needs more states.</param>
+			RegexLexer_(const collections::IEnumerable<ObjectString<T>>& tokens, vint maxDfaStateCount = -1);
 			/// <summary>Create a lexical analyzer from definitions storing in a stream. The definition should be serialized by <see cref="Serialize"/>.</summary>
 			/// <param name="inputStream">The stream storing the definition.</param>
 			RegexLexer_(stream::IStream& inputStream);
+			/// <summary>
+			/// Create a lexical analyzer from definitions storing in memory. The definition should be serialized by <see cref="Serialize"/>.
+			/// Tables are used in place without copying, so the memory could be mapped directly from a file, and it must be alive until the lexical analyzer is destroyed.
+			/// </summary>
+			/// <param name="image">The memory storing the definition, which should be aligned to 8 bytes.</param>
+			/// <param name="size">The size of the memory in bytes.</param>
+			RegexLexer_(const void* image, vint size);
 			~RegexLexer_() = default;
 
-			/// <summary>Serialize the definition of the lexical analyzer.</summary>
+			/// <summary>
+			/// Serialize the definition of the lexical analyzer.
+			/// The result is aligned, with a header recording the format version, the byte order and a checksum.
+			/// Loading a damaged or incompatible definition throws <see cref="RegexImageException"/>.
+			/// </summary>
 			/// <param name="outputStream">The stream to store the definition.</param>
 			void				Serialize(stream::IStream & outputStream);
 		};
@@ -1226,11 +1930,26 @@ Template Instantiation
 		extern template class Regex_<char16_t>;
 		extern template class Regex_<char32_t>;
 
+		extern template void								RegexSetBase_::Matches<wchar_t>		(const ObjectString<wchar_t>& text, collections::List<vint>& ids)const;
+		extern template void								RegexSetBase_::Matches<char8_t>		(const ObjectString<char8_t>& text, collections::List<vint>& ids)const;
+		extern template void								RegexSetBase_::Matches<char16_t>	(const ObjectString<char16_t>& text, collections::List<vint>& ids)const;
+		extern template void								RegexSetBase_::Matches<char32_t>	(const ObjectString<char32_t>& text, collections::List<vint>& ids)const;
+
+		extern template class RegexSet_<wchar_t>;
+		extern template class RegexSet_<char8_t>;
+		extern template class RegexSet_<char16_t>;
+		extern template class RegexSet_<char32_t>;
+
 		extern template class RegexTokens_<wchar_t>;
 		extern template class RegexTokens_<char8_t>;
 		extern template class RegexTokens_<char16_t>;
 		extern template class RegexTokens_<char32_t>;
 
+		extern template class RegexIncrementalTokens_<wchar_t>;
+		extern template class RegexIncrementalTokens_<char8_t>;
+		extern template class RegexIncrementalTokens_<char16_t>;
+		extern template class RegexIncrementalTokens_<char32_t>;
+
 		extern template class RegexLexerWalker_<wchar_t>;
 		extern template class RegexLexerWalker_<char8_t>;
 		extern template class RegexLexerWalker_<char16_t>;
@@ -1241,21 +1960,34 @@ Template Instantiation
 		extern template class RegexLexerColorizer_<char16_t>;
 		extern template class RegexLexerColorizer_<char32_t>;
 
+		extern template class RegexDocumentColorizer_<wchar_t>;
+		extern template class RegexDocumentColorizer_<char8_t>;
+		extern template class RegexDocumentColorizer_<char16_t>;
+		extern template class RegexDocumentColorizer_<char32_t>;
+
 		extern template RegexTokens_<wchar_t>				RegexLexerBase_::Parse<wchar_t>			(const ObjectString<wchar_t>& code, RegexProc_<wchar_t> _proc, vint codeIndex)const;
+		extern template RegexIncrementalTokens_<wchar_t>	RegexLexerBase_::ParseIncrementally<wchar_t>(const ObjectString<wchar_t>& code, vint codeIndex)const;
 		extern template RegexLexerWalker_<wchar_t>			RegexLexerBase_::Walk<wchar_t>			()const;
 		extern template RegexLexerColorizer_<wchar_t>		RegexLexerBase_::Colorize<wchar_t>		(RegexProc_<wchar_t> _proc)const;
+		extern template RegexDocumentColorizer_<wchar_t>	RegexLexerBase_::ColorizeDocument<wchar_t>(RegexProc_<wchar_t> _proc)const;
 
 		extern template RegexTokens_<char8_t>				RegexLexerBase_::Parse<char8_t>			(const ObjectString<char8_t>& code, RegexProc_<char8_t> _proc, vint codeIndex)const;
+		extern template RegexIncrementalTokens_<char8_t>	RegexLexerBase_::ParseIncrementally<char8_t>(const ObjectString<char8_t>& code, vint codeIndex)const;
 		extern template RegexLexerWalker_<char8_t>			RegexLexerBase_::Walk<char8_t>			()const;
 		extern template RegexLexerColorizer_<char8_t>		RegexLexerBase_::Colorize<char8_t>		(RegexProc_<char8_t> _proc)const;
+		extern template RegexDocumentColorizer_<char8_t>	RegexLexerBase_::ColorizeDocument<char8_t>(RegexProc_<char8_t> _proc)const;
 
 		extern template RegexTokens_<char16_t>				RegexLexerBase_::Parse<char16_t>		(const ObjectString<char16_t>& code, RegexProc_<char16_t> _proc, vint codeIndex)const;
+		extern template RegexIncrementalTokens_<char16_t>	RegexLexerBase_::ParseIncrementally<char16_t>(const ObjectString<char16_t>& code, vint codeIndex)const;
 		extern template RegexLexerWalker_<char16_t>			RegexLexerBase_::Walk<char16_t>			()const;
 		extern template RegexLexerColorizer_<char16_t>		RegexLexerBase_::Colorize<char16_t>		(RegexProc_<char16_t> _proc)const;
+		extern template RegexDocumentColorizer_<char16_t>	RegexLexerBase_::ColorizeDocument<char16_t>(RegexProc_<char16_t> _proc)const;
 
 		extern template RegexTokens_<char32_t>				RegexLexerBase_::Parse<char32_t>		(const ObjectString<char32_t>& code, RegexProc_<char32_t> _proc, vint codeIndex)const;
+		extern template RegexIncrementalTokens_<char32_t>	RegexLexerBase_::ParseIncrementally<char32_t>(const ObjectString<char32_t>& code, vint codeIndex)const;
 		extern template RegexLexerWalker_<char32_t>			RegexLexerBase_::Walk<char32_t>			()const;
 		extern template RegexLexerColorizer_<char32_t>		RegexLexerBase_::Colorize<char32_t>		(RegexProc_<char32_t> _proc)const;
+		extern template RegexDocumentColorizer_<char32_t>	RegexLexerBase_::ColorizeDocument<char32_t>(RegexProc_<char32_t> _proc)const;
 
 		extern template class RegexLexer_<wchar_t>;
 		extern template class RegexLexer_<char8_t>;
@@ -1265,11 +1997,14 @@ Template Instantiation
 		using RegexString = RegexString_<wchar_t>;
 		using RegexMatch = RegexMatch_<wchar_t>;
 		using Regex = Regex_<wchar_t>;
+		using RegexSet = RegexSet_<wchar_t>;
 		using RegexToken = RegexToken_<wchar_t>;
 		using RegexProc = RegexProc_<wchar_t>;
 		using RegexTokens = RegexTokens_<wchar_t>;
+		using RegexIncrementalTokens = RegexIncrementalTokens_<wchar_t>;
 		using RegexLexerWalker = RegexLexerWalker_<wchar_t>;
 		using RegexLexerColorizer = RegexLexerColorizer_<wchar_t>;
+		using RegexDocumentColorizer = RegexDocumentColorizer_<wchar_t>;
 		using RegexLexer = RegexLexer_<wchar_t>;
 	}
 }
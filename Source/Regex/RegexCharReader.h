@@ -18,6 +18,7 @@ namespace vl
 		private:
 			encoding::UtfStringToStringReader<T, char32_t>	reader;
 			const T*										input;
+			vint											offset = 0;
 
 		public:
 			CharReader(const T* _input)
@@ -26,13 +27,21 @@ namespace vl
 			{
 			}
 
-			const T* Reading() { return input + reader.SourceCluster().index; }
-			vint Index() { return reader.SourceCluster().index; }
+			const T* Reading() { return input + Index(); }
+			vint Index() { return offset + reader.SourceCluster().index; }
 
 			char32_t Read()
 			{
 				return reader.Read();
 			}
+
+			char32_t Skip(vint length)
+			{
+				// length must be counted in code units and stop at a character boundary
+				offset = Index() + length;
+				reader = encoding::UtfStringToStringReader<T, char32_t>(input + offset);
+				return reader.Read();
+			}
 		};
 
 		template<>
@@ -65,6 +74,14 @@ namespace vl
 
 			const char32_t* Reading() { return input + Index(); }
 			vint Index() { return finished ? index : index - 1; }
+
+			char32_t Skip(vint length)
+			{
+				if (length == 0) return finished ? 0 : input[index - 1];
+				index = Index() + length;
+				finished = false;
+				return Read();
+			}
 		};
 	}
 }
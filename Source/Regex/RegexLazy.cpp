@@ -0,0 +1,449 @@
+/***********************************************************************
+Author: Zihan Chen (vczh)
+Licensed under https://github.com/vczh-libraries/License
+***********************************************************************/
+
+#include "RegexLazy.h"
+#include "RegexCharReader.h"
+
+namespace vl
+{
+	namespace regex_internal
+	{
+		using namespace collections;
+
+/***********************************************************************
+Helper Functions
+***********************************************************************/
+
+		vint FindCharSet(const Array<CharRange>& charRanges, char32_t c)
+		{
+			vint start = 0;
+			vint end = charRanges.Count() - 1;
+			while (start <= end)
+			{
+				vint middle = (start + end) / 2;
+				auto&& range = charRanges[middle];
+				if (c < range.begin)
+				{
+					end = middle - 1;
+				}
+				else if (c > range.end)
+				{
+					start = middle + 1;
+				}
+				else
+				{
+					return middle;
+				}
+			}
+			return -1;
+		}
+
+/***********************************************************************
+LazyInterpretor::StepBuffers
+***********************************************************************/
+
+		void LazyInterpretor::StepBuffers::Resize(vint nfaStateCount)
+		{
+			nfaMarks.Resize(nfaStateCount);
+			nextSet.Resize(nfaStateCount);
+			simulatedSet.Resize(nfaStateCount);
+			for (vint i = 0; i < nfaStateCount; i++)
+			{
+				nfaMarks[i] = 0;
+			}
+		}
+
+/***********************************************************************
+LazyInterpretor
+***********************************************************************/
+
+		vint LazyInterpretor::GetCharSet(char32_t c)
+		{
+			if (c < AsciiCharCount)
+			{
+				return asciiMap[c];
+			}
+			return FindCharSet(charRanges, c);
+		}
+
+		vint LazyInterpretor::GetBucket(const vint* nfaStates, vint count)
+		{
+			vuint64_t hash = 14695981039346656037ULL;
+			for (vint i = 0; i < count; i++)
+			{
+				hash ^= (vuint64_t)nfaStates[i];
+				hash *= 1099511628211ULL;
+			}
+			return (vint)(hash & (vuint64_t)(buckets.Count() - 1));
+		}
+
+		bool LazyInterpretor::IsFinalSet(const vint* nfaStates, vint count)
+		{
+			// the start state of a DFA is never a final state, which is consistent with NfaToDfa
+			if (count == 1 && nfaStates[0] == nfaStartState)
+			{
+				return false;
+			}
+
+			for (vint i = 0; i < count; i++)
+			{
+				if (nfaFinalStates[nfaStates[i]])
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void LazyInterpretor::Step(StepBuffers& buffers, const vint* nfaStates, vint count, vint charSetIndex)
+		{
+			auto& nfaMarks = buffers.nfaMarks;
+			auto& nfaMarkGeneration = buffers.nfaMarkGeneration;
+			auto& nextSet = buffers.nextSet;
+			auto& nextSetCount = buffers.nextSetCount;
+
+			nfaMarkGeneration++;
+			nextSetCount = 0;
+			for (vint i = 0; i < count; i++)
+			{
+				vint nfaState = nfaStates[i];
+				for (vint j = nfaTransitionStarts[nfaState]; j < nfaTransitionStarts[nfaState + 1]; j++)
+				{
+					if (nfaTransitionCharSets[j] == charSetIndex)
+					{
+						vint target = nfaTransitionTargets[j];
+						if (nfaMarks[target] != nfaMarkGeneration)
+						{
+							nfaMarks[target] = nfaMarkGeneration;
+							nextSet[nextSetCount++] = target;
+						}
+					}
+				}
+			}
+
+			if (nextSetCount > 1)
+			{
+				Sort(&nextSet[0], nextSetCount);
+			}
+		}
+
+		vint LazyInterpretor::FindState(const vint* nfaStates, vint count)
+		{
+			vint mask = buckets.Count() - 1;
+			for (vint bucket = GetBucket(nfaStates, count); buckets[bucket] != -1; bucket = (bucket + 1) & mask)
+			{
+				vint state = buckets[bucket];
+				vint first = stateSetStarts[state];
+				if (stateSetStarts[state + 1] - first == count && memcmp(&stateSets[first], nfaStates, sizeof(vint) * count) == 0)
+				{
+					return state;
+				}
+			}
+			return -1;
+		}
+
+		vint LazyInterpretor::AddState(const vint* nfaStates, vint count)
+		{
+			vint state = finalStates.Count();
+			for (vint i = 0; i < count; i++)
+			{
+				stateSets.Add(nfaStates[i]);
+			}
+			stateSetStarts.Add(stateSets.Count());
+			finalStates.Add(IsFinalSet(nfaStates, count));
+			for (vint i = 0; i < charSetCount; i++)
+			{
+				transitions.Add(UnknownState);
+			}
+
+			vint mask = buckets.Count() - 1;
+			vint bucket = GetBucket(nfaStates, count);
+			while (buckets[bucket] != -1)
+			{
+				bucket = (bucket + 1) & mask;
+			}
+			buckets[bucket] = state;
+			return state;
+		}
+
+		void LazyInterpretor::Flush()
+		{
+			stateSetStarts.Clear();
+			stateSets.Clear();
+			finalStates.Clear();
+			transitions.Clear();
+			for (vint i = 0; i < buckets.Count(); i++)
+			{
+				buckets[i] = -1;
+			}
+
+			stateSetStarts.Add(0);
+			AddState(&nfaStartState, 1);
+		}
+
+		vint LazyInterpretor::Transit(vint state, vint charSetIndex, vint& flushCount)
+		{
+			vint next = transitions[state * charSetCount + charSetIndex];
+			if (next != UnknownState)
+			{
+				return next;
+			}
+
+			auto& nextSet = cacheBuffers.nextSet;
+			auto& nextSetCount = cacheBuffers.nextSetCount;
+			vint first = stateSetStarts[state];
+			Step(cacheBuffers, &stateSets[first], stateSetStarts[state + 1] - first, charSetIndex);
+			if (nextSetCount == 0)
+			{
+				next = -1;
+			}
+			else
+			{
+				next = FindState(&nextSet[0], nextSetCount);
+				if (next == -1)
+				{
+					if (finalStates.Count() >= maxStateCount)
+					{
+						// the source state is dropped, so the transition is not recorded
+						Flush();
+						flushCount++;
+						return AddState(&nextSet[0], nextSetCount);
+					}
+					next = AddState(&nextSet[0], nextSetCount);
+				}
+			}
+
+			transitions[state * charSetCount + charSetIndex] = next;
+			return next;
+		}
+
+		bool LazyInterpretor::TryOwnCache()
+		{
+			vint expected = 0;
+			return cacheOwned.compare_exchange_strong(expected, 1);
+		}
+
+		void LazyInterpretor::ReleaseCache()
+		{
+			cacheOwned = 0;
+		}
+
+		template<typename TChar>
+		bool LazyInterpretor::MatchHeadInternal(const TChar* input, const TChar* start, PureResult& result, vint& flushCount, StepBuffers& buffers, bool cached)
+		{
+			auto& nextSet = buffers.nextSet;
+			auto& nextSetCount = buffers.nextSetCount;
+			auto& simulatedSet = buffers.simulatedSet;
+			auto& simulatedSetCount = buffers.simulatedSetCount;
+
+			CharReader<TChar> reader(input);
+			vint currentState = 0;
+			bool simulating = !cached || flushCount > MaxFlushCount;
+			if (simulating)
+			{
+				simulatedSet[0] = nfaStartState;
+				simulatedSetCount = 1;
+			}
+
+			bool found = false;
+			vint terminateLength = -1;
+
+			result.start = input - start;
+			result.length = -1;
+			result.finalState = -1;
+			result.terminateState = -1;
+
+			while (true)
+			{
+				auto c = reader.Read();
+
+				terminateLength = reader.Index();
+				if (simulating ? IsFinalSet(&simulatedSet[0], simulatedSetCount) : finalStates[currentState])
+				{
+					result.length = terminateLength;
+					found = true;
+				}
+
+				if (!c) break;
+				vint charSetIndex = GetCharSet(c);
+				if (charSetIndex == -1) break;
+
+				if (simulating)
+				{
+					Step(buffers, &simulatedSet[0], simulatedSetCount, charSetIndex);
+					if (nextSetCount == 0) break;
+					memcpy(&simulatedSet[0], &nextSet[0], sizeof(vint) * nextSetCount);
+					simulatedSetCount = nextSetCount;
+				}
+				else
+				{
+					currentState = Transit(currentState, charSetIndex, flushCount);
+					if (currentState == -1) break;
+
+					if (flushCount > MaxFlushCount)
+					{
+						// the cache is thrashing, simulate the NFA for the rest of the call
+						simulating = true;
+						vint first = stateSetStarts[currentState];
+						simulatedSetCount = stateSetStarts[currentState + 1] - first;
+						memcpy(&simulatedSet[0], &stateSets[first], sizeof(vint) * simulatedSetCount);
+					}
+				}
+			}
+
+			result.scannedLength = terminateLength + 1;
+			REGEX_STATISTICS(counters.matchHeads++);
+			REGEX_STATISTICS(counters.scannedChars += result.scannedLength);
+			if (!found)
+			{
+				result.length = terminateLength;
+			}
+			return found;
+		}
+
+		LazyInterpretor::LazyInterpretor(Ptr<Automaton> nfa, CharRange::List& subsets, vint _maxStateCount)
+			: maxStateCount(_maxStateCount)
+		{
+			CHECK_ERROR(maxStateCount > 0, L"LazyInterpretor::LazyInterpretor(Ptr<Automaton>, CharRange::List&, vint)#The cache should be able to store at least one state.");
+
+			// Map char to char set index
+			charSetCount = subsets.Count();
+			CopyFrom(charRanges, subsets);
+			for (vint i = 0; i < AsciiCharCount; i++)
+			{
+				asciiMap[i] = FindCharSet(charRanges, (char32_t)i);
+			}
+
+			// Flatten the NFA
+			Dictionary<State*, vint> nfaStateIndices;
+			vint nfaStateCount = nfa->states.Count();
+			vint nfaTransitionCount = 0;
+			for (auto [state, index] : indexed(nfa->states))
+			{
+				nfaStateIndices.Add(state.Obj(), index);
+				nfaTransitionCount += state->transitions.Count();
+			}
+
+			nfaStartState = nfaStateIndices[nfa->startState];
+			nfaFinalStates.Resize(nfaStateCount);
+			nfaTransitionStarts.Resize(nfaStateCount + 1);
+			nfaTransitionCharSets.Resize(nfaTransitionCount);
+			nfaTransitionTargets.Resize(nfaTransitionCount);
+
+			vint transitionIndex = 0;
+			for (vint i = 0; i < nfaStateCount; i++)
+			{
+				State* state = nfa->states[i].Obj();
+				nfaFinalStates[i] = state->finalState;
+				nfaTransitionStarts[i] = transitionIndex;
+				for (auto transition : state->transitions)
+				{
+					CHECK_ERROR(transition->type == Transition::Chars, L"LazyInterpretor::LazyInterpretor(Ptr<Automaton>, CharRange::List&, vint)#LazyInterpretor only accepts Transition::Chars transitions.");
+					vint charSetIndex = subsets.IndexOf(transition->range);
+					CHECK_ERROR(charSetIndex != -1, L"LazyInterpretor::LazyInterpretor(Ptr<Automaton>, CharRange::List&, vint)#Specified chars don't appear in the normalized char ranges.");
+					nfaTransitionCharSets[transitionIndex] = charSetIndex;
+					nfaTransitionTargets[transitionIndex] = nfaStateIndices[transition->target];
+					transitionIndex++;
+				}
+			}
+			nfaTransitionStarts[nfaStateCount] = transitionIndex;
+
+			// Prepare buffers
+			cacheBuffers.Resize(nfaStateCount);
+
+			// Prepare the cache with only the start state
+			vint bucketCount = 1;
+			while (bucketCount < (maxStateCount + 1) * 2)
+			{
+				bucketCount *= 2;
+			}
+			buckets.Resize(bucketCount);
+			Flush();
+		}
+
+		template<typename TChar>
+		bool LazyInterpretor::MatchHead(const TChar* input, const TChar* start, PureResult& result)
+		{
+			vint flushCount = 0;
+			bool found = false;
+			if (TryOwnCache())
+			{
+				found = MatchHeadInternal(input, start, result, flushCount, cacheBuffers, true);
+				ReleaseCache();
+			}
+			else
+			{
+				// another call is using the cache
+				StepBuffers buffers;
+				buffers.Resize(nfaFinalStates.Count());
+				found = MatchHeadInternal(input, start, result, flushCount, buffers, false);
+			}
+			REGEX_STATISTICS(counters.lazyFlushes += flushCount);
+			return found;
+		}
+
+		template<typename TChar>
+		bool LazyInterpretor::Match(const TChar* input, const TChar* start, PureResult& result)
+		{
+			bool cached = TryOwnCache();
+			StepBuffers localBuffers;
+			if (!cached)
+			{
+				// another call is using the cache
+				localBuffers.Resize(nfaFinalStates.Count());
+			}
+			auto& buffers = cached ? cacheBuffers : localBuffers;
+
+			vint flushCount = 0;
+			bool found = false;
+			CharReader<TChar> reader(input);
+			while (reader.Read())
+			{
+				REGEX_STATISTICS(if (reader.Reading() != input) counters.matchHeadRestarts++);
+				if (MatchHeadInternal(reader.Reading(), start, result, flushCount, buffers, cached))
+				{
+					found = true;
+					break;
+				}
+			}
+
+			if (cached)
+			{
+				ReleaseCache();
+			}
+			REGEX_STATISTICS(counters.lazyFlushes += flushCount);
+			return found;
+		}
+
+		vint LazyInterpretor::GetCachedStateCount()
+		{
+			return finalStates.Count();
+		}
+
+		vint LazyInterpretor::GetCharSetCount()
+		{
+			return charSetCount;
+		}
+
+		vint LazyInterpretor::GetTableSize()
+		{
+			return
+				sizeof(vint) * (stateSetStarts.Count() + stateSets.Count() + transitions.Count() + buckets.Count()) +
+				sizeof(bool) * finalStates.Count() +
+				sizeof(vint) * (nfaTransitionStarts.Count() + nfaTransitionCharSets.Count() + nfaTransitionTargets.Count()) +
+				sizeof(bool) * nfaFinalStates.Count();
+		}
+
+		template bool	LazyInterpretor::MatchHead<wchar_t>(const wchar_t* input, const wchar_t* start, PureResult& result);
+		template bool	LazyInterpretor::MatchHead<char8_t>(const char8_t* input, const char8_t* start, PureResult& result);
+		template bool	LazyInterpretor::MatchHead<char16_t>(const char16_t* input, const char16_t* start, PureResult& result);
+		template bool	LazyInterpretor::MatchHead<char32_t>(const char32_t* input, const char32_t* start, PureResult& result);
+
+		template bool	LazyInterpretor::Match<wchar_t>(const wchar_t* input, const wchar_t* start, PureResult& result);
+		template bool	LazyInterpretor::Match<char8_t>(const char8_t* input, const char8_t* start, PureResult& result);
+		template bool	LazyInterpretor::Match<char16_t>(const char16_t* input, const char16_t* start, PureResult& result);
+		template bool	LazyInterpretor::Match<char32_t>(const char32_t* input, const char32_t* start, PureResult& result);
+	}
+}
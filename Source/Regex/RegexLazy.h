@@ -0,0 +1,113 @@
+/***********************************************************************
+Author: Zihan Chen (vczh)
+Licensed under https://github.com/vczh-libraries/License
+***********************************************************************/
+
+#ifndef VCZH_REGEX_REGEXLAZY
+#define VCZH_REGEX_REGEXLAZY
+
+#include "RegexPure.h"
+
+namespace vl
+{
+	namespace regex_internal
+	{
+		// DFA states are built from the NFA on demand, and stored in a cache of limited size
+		// the whole cache is dropped when it is full
+		// when the cache is dropped too many times in a single call, the NFA is simulated for the rest of the call
+		// only one call owns the cache at a time, other calls running at the same time simulate the NFA with their own buffers
+		class LazyInterpretor : public Object
+		{
+			using CharRangeArray = collections::Array<CharRange>;
+		public:
+			static const vint			DefaultMaxStateCount = 1024;
+			static const vint			MaxFlushCount = 16;
+
+		protected:
+			static const vint			AsciiCharCount = 128;
+			static const vint			UnknownState = -2;
+
+			// buffers for stepping through the NFA
+			class StepBuffers
+			{
+			public:
+				collections::Array<vint>	nfaMarks;						// nfa state -> the last generation that the state is added to nextSet
+				vint						nfaMarkGeneration = 0;
+				collections::Array<vint>	nextSet;
+				vint						nextSetCount = 0;
+				collections::Array<vint>	simulatedSet;
+				vint						simulatedSetCount = 0;
+
+				void						Resize(vint nfaStateCount);
+			};
+
+			// char -> char set index
+			CharRangeArray				charRanges;
+			vint						asciiMap[AsciiCharCount];
+			vint						charSetCount;
+
+			// NFA
+			collections::Array<bool>	nfaFinalStates;						// nfa state -> bool
+			collections::Array<vint>	nfaTransitionStarts;				// nfa state -> the first transition, there is one more item for the end
+			collections::Array<vint>	nfaTransitionCharSets;				// transition -> char set index
+			collections::Array<vint>	nfaTransitionTargets;				// transition -> nfa state
+			vint						nfaStartState;
+
+			// DFA cache, the start state is always 0
+			vint						maxStateCount;
+			collections::List<vint>		stateSetStarts;						// state -> the first nfa state in stateSets, there is one more item for the end
+			collections::List<vint>		stateSets;							// nfa states of all states
+			collections::List<bool>		finalStates;						// state -> bool
+			collections::List<vint>		transitions;						// (state * charSetCount + charSetIndex) -> (state or -1 or UnknownState)
+			collections::Array<vint>	buckets;							// hash of nfa states -> (state or -1)
+
+			// buffers for building states, used by the call owning the cache
+			atomic_vint					cacheOwned = 0;						// 1 when a call is using the cache
+			StepBuffers					cacheBuffers;
+
+			vint						GetCharSet(char32_t c);
+			vint						GetBucket(const vint* nfaStates, vint count);
+			bool						IsFinalSet(const vint* nfaStates, vint count);
+			void						Step(StepBuffers& buffers, const vint* nfaStates, vint count, vint charSetIndex);
+			vint						FindState(const vint* nfaStates, vint count);
+			vint						AddState(const vint* nfaStates, vint count);
+			void						Flush();
+			vint						Transit(vint state, vint charSetIndex, vint& flushCount);
+
+			bool						TryOwnCache();
+			void						ReleaseCache();
+
+			template<typename TChar>
+			bool						MatchHeadInternal(const TChar* input, const TChar* start, PureResult& result, vint& flushCount, StepBuffers& buffers, bool cached);
+		public:
+			LazyInterpretor(Ptr<Automaton> nfa, CharRange::List& subsets, vint _maxStateCount = DefaultMaxStateCount);
+			~LazyInterpretor() = default;
+
+#ifdef VCZH_REGEX_STATISTICS
+			InterpretorCounters			counters;
+#endif
+
+			template<typename TChar>
+			bool						MatchHead(const TChar* input, const TChar* start, PureResult& result);
+
+			template<typename TChar>
+			bool						Match(const TChar* input, const TChar* start, PureResult& result);
+
+			vint						GetCachedStateCount();
+			vint						GetCharSetCount();
+			vint						GetTableSize();						// bytes of the flattened NFA and the DFA cache
+		};
+
+		extern template bool	LazyInterpretor::MatchHead<wchar_t>(const wchar_t* input, const wchar_t* start, PureResult& result);
+		extern template bool	LazyInterpretor::MatchHead<char8_t>(const char8_t* input, const char8_t* start, PureResult& result);
+		extern template bool	LazyInterpretor::MatchHead<char16_t>(const char16_t* input, const char16_t* start, PureResult& result);
+		extern template bool	LazyInterpretor::MatchHead<char32_t>(const char32_t* input, const char32_t* start, PureResult& result);
+
+		extern template bool	LazyInterpretor::Match<wchar_t>(const wchar_t* input, const wchar_t* start, PureResult& result);
+		extern template bool	LazyInterpretor::Match<char8_t>(const char8_t* input, const char8_t* start, PureResult& result);
+		extern template bool	LazyInterpretor::Match<char16_t>(const char16_t* input, const char16_t* start, PureResult& result);
+		extern template bool	LazyInterpretor::Match<char32_t>(const char32_t* input, const char32_t* start, PureResult& result);
+	}
+}
+
+#endif
@@ -4,6 +4,7 @@ Licensed under https://github.com/vczh-libraries/License
 ***********************************************************************/
 
 #include <VlppOS.h>
+#include "Regex.h"
 #include "RegexPure.h"
 #include "RegexCharReader.h"
 
@@ -14,207 +15,416 @@ namespace vl
 		using namespace collections;
 
 /***********************************************************************
-Read
+Checksum
 ***********************************************************************/
 
-		void ReadInt(stream::IStream& inputStream, vint& value)
+		vuint32_t UpdateCrc32(vuint32_t crc, const void* data, vint size)
 		{
-#ifdef VCZH_64
-			vint32_t x = 0;
-			CHECK_ERROR(
-				inputStream.Read(&x, sizeof(vint32_t)) == sizeof(vint32_t),
-				L"Failed to deserialize RegexLexer."
-				);
-			value = (vint)x;
-#else
-			CHECK_ERROR(
-				inputStream.Read(&value, sizeof(vint32_t)) == sizeof(vint32_t),
-				L"Failed to deserialize RegexLexer."
-				);
-#endif
-		}
-
-		void ReadInts(stream::IStream& inputStream, vint count, vint* values)
-		{
-#ifdef VCZH_64
-			Array<vint32_t> xs(count);
-			CHECK_ERROR(
-				inputStream.Read(&xs[0], sizeof(vint32_t) * count) == sizeof(vint32_t) * count,
-				L"Failed to deserialize RegexLexer."
-				);
-			for (vint i = 0; i < count; i++)
-			{
-				values[i] = (vint)xs[i];
-			}
-#else
-			CHECK_ERROR(
-				inputStream.Read(values, sizeof(vint32_t) * count) == sizeof(vint32_t) * count,
-				L"Failed to deserialize RegexLexer."
-				);
-#endif
-		}
+			struct Crc32Table
+			{
+				vuint32_t		items[256];
 
-		void ReadBools(stream::IStream& inputStream, vint count, bool* values)
-		{
-			Array<vuint8_t> bits((count + 7) / 8);
-			CHECK_ERROR(
-				inputStream.Read(&bits[0], sizeof(vuint8_t) * bits.Count()) == sizeof(vuint8_t) * bits.Count(),
-				L"Failed to deserialize RegexLexer."
-			);
+				Crc32Table()
+				{
+					for (vuint32_t i = 0; i < 256; i++)
+					{
+						vuint32_t c = i;
+						for (vint j = 0; j < 8; j++)
+						{
+							c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+						}
+						items[i] = c;
+					}
+				}
+			};
+			static const Crc32Table table;
 
-			for (vint i = 0; i < count; i++)
+			auto bytes = (const vuint8_t*)data;
+			crc = ~crc;
+			for (vint i = 0; i < size; i++)
 			{
-				vint x = i / 8;
-				vint y = i % 8;
-				values[i] = ((bits[x] >> y) & 1) == 1;
+				crc = table.items[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
 			}
+			return ~crc;
+		}
+
+		vuint32_t GetImageChecksum(const void* image, vint size)
+		{
+			// the checksum field is treated as 0
+			const vuint32_t zero = 0;
+			vint checksumOffset = offsetof(PureImageHeader, checksum);
+			vint afterChecksum = checksumOffset + sizeof(vuint32_t);
+			vuint32_t crc = UpdateCrc32(0, image, checksumOffset);
+			crc = UpdateCrc32(crc, &zero, sizeof(zero));
+			crc = UpdateCrc32(crc, (const vuint8_t*)image + afterChecksum, size - afterChecksum);
+			return crc;
 		}
 
 /***********************************************************************
-Write
+PureInterpretor (Serialization)
 ***********************************************************************/
 
-		void WriteInt(stream::IStream& outputStream, vint value)
+		void PureInterpretor::AttachImage(const void* image, vint size)
 		{
-#ifdef VCZH_64
-			vint32_t x = (vint32_t)value;
-			CHECK_ERROR(
-				outputStream.Write(&x, sizeof(vint32_t)) == sizeof(vint32_t),
-				L"Failed to serialize RegexLexer."
-				);
-#else
-			CHECK_ERROR(
-				outputStream.Write(&value, sizeof(vint32_t)) == sizeof(vint32_t),
-				L"Failed to serialize RegexLexer."
-				);
-#endif
-		}
+#define ERROR_MESSAGE_PREFIX L"PureInterpretor::AttachImage(const void*, vint)#"
+			using Reason = regex::RegexImageException::Reason;
+			auto check = [](bool condition, const wchar_t* message, Reason reason)
+			{
+				if (!condition)
+				{
+					throw regex::RegexImageException(WString(ERROR_MESSAGE_PREFIX) + message, reason);
+				}
+			};
+
+			check(image && (vint)image % 8 == 0, L"The image should be aligned to 8 bytes.", Reason::Incompatible);
+			check(size >= (vint)sizeof(PureImageHeader), L"The image is too small.", Reason::Truncated);
+
+			auto imageHeader = (const PureImageHeader*)image;
+			check(imageHeader->magic == PureImageHeader::Magic, L"The image is not a serialized regular expression.", Reason::NotAnImage);
+			check(imageHeader->endian == PureImageHeader::Endian, L"The image is serialized on a machine with a different byte order.", Reason::ByteOrder);
+			check(imageHeader->version == PureImageHeader::Version, L"The image is serialized in an unsupported version.", Reason::Version);
+			check(imageHeader->alphabet == PureImageHeader::AlphabetUtf32 && imageHeader->stateWidth == sizeof(vint32_t), L"The image uses an unsupported alphabet or state width.", Reason::Incompatible);
+			check(imageHeader->size <= size, L"The image is truncated.", Reason::Truncated);
+			check(imageHeader->size % 8 == 0 && imageHeader->size >= sizeof(PureImageHeader) + sizeof(PureImageSection) * imageHeader->sectionCount, L"The image is corrupted.", Reason::Corrupted);
+			check(imageHeader->checksum == GetImageChecksum(image, imageHeader->size), L"The checksum does not match the image.", Reason::Checksum);
+			check(
+				imageHeader->stateCount > 0 &&
+				imageHeader->charSetCount > 0 &&
+				0 <= imageHeader->startState && imageHeader->startState < imageHeader->stateCount &&
+				imageHeader->charBlockCount > 0,
+				L"The image is corrupted.", Reason::Corrupted);
+
+			header = imageHeader;
+			stateCount = imageHeader->stateCount;
+			charSetCount = imageHeader->charSetCount;
+			startState = imageHeader->startState;
+			charRanges = nullptr;
+			charRangeClasses = nullptr;
+			charRangeCount = 0;
+			charBlockIndex = nullptr;
+			charBlocks = nullptr;
+			transitions = nullptr;
+			combBases = nullptr;
+			combNext = nullptr;
+			combCheck = nullptr;
+			combLength = 0;
+			finalStates = nullptr;
+			stateTokens = nullptr;
+			deadStates = nullptr;
+			aliveStates = nullptr;
+
+			vint charRangeClassCount = 0;
+			auto sections = (const PureImageSection*)(imageHeader + 1);
+			for (vuint32_t i = 0; i < imageHeader->sectionCount; i++)
+			{
+				auto&& section = sections[i];
+				check(section.offset % 8 == 0 && section.offset <= imageHeader->size && section.size <= imageHeader->size - section.offset, L"The image is corrupted.", Reason::Corrupted);
 
-		void WriteInts(stream::IStream& outputStream, vint count, vint* values)
-		{
-#ifdef VCZH_64
-			Array<vint32_t> xs(count);
-			for (vint i = 0; i < count; i++)
-			{
-				xs[i] = (vint32_t)values[i];
-			}
-			CHECK_ERROR(
-				outputStream.Write(&xs[0], sizeof(vint32_t) * count) == sizeof(vint32_t) * count,
-				L"Failed to serialize RegexLexer."
-				);
-#else
-			CHECK_ERROR(
-				outputStream.Write(values, sizeof(vint32_t) * count) == sizeof(vint32_t) * count,
-				L"Failed to serialize RegexLexer."
-				);
-#endif
-		}
+				auto data = (const char*)image + section.offset;
+				auto expect = [&](vint itemSize, vint itemCount)
+				{
+					check(section.size == itemSize * itemCount, L"The image is corrupted.", Reason::Corrupted);
+					return data;
+				};
 
-		void WriteBools(stream::IStream& outputStream, vint count, bool* values)
-		{
-			Array<vuint8_t> bits((count + 7) / 8);
-			memset(&bits[0], 0, sizeof(vuint8_t) * bits.Count());
+				switch (section.id)
+				{
+				case PureImageSection::CharRanges:
+					charRangeCount = section.size / sizeof(CharRange);
+					charRanges = (const CharRange*)expect(sizeof(CharRange), charRangeCount);
+					break;
+				case PureImageSection::CharRangeClasses:
+					charRangeClassCount = section.size / sizeof(vint32_t);
+					charRangeClasses = (const vint32_t*)expect(sizeof(vint32_t), charRangeClassCount);
+					break;
+				case PureImageSection::CharBlockIndex:
+					charBlockIndex = (const vint32_t*)expect(sizeof(vint32_t), CharBlockCount);
+					break;
+				case PureImageSection::CharBlocks:
+					charBlocks = (const vint32_t*)expect(sizeof(vint32_t), imageHeader->charBlockCount * CharBlockSize);
+					break;
+				case PureImageSection::Transitions:
+					transitions = (const vint32_t*)expect(sizeof(vint32_t), stateCount * charSetCount);
+					break;
+				case PureImageSection::FinalStates:
+					finalStates = (const vuint32_t*)expect(sizeof(vuint32_t), (stateCount + 31) / 32);
+					break;
+				case PureImageSection::StateTokens:
+					stateTokens = (const vint32_t*)expect(sizeof(vint32_t), stateCount);
+					break;
+				case PureImageSection::DeadStates:
+					deadStates = (const vuint32_t*)expect(sizeof(vuint32_t), (stateCount + 31) / 32);
+					break;
+				case PureImageSection::AliveStates:
+					aliveStates = (const vuint32_t*)expect(sizeof(vuint32_t), (stateCount + 31) / 32);
+					break;
+				case PureImageSection::CombBases:
+					combBases = (const vint32_t*)expect(sizeof(vint32_t), stateCount);
+					break;
+				case PureImageSection::CombNext:
+					combLength = section.size / sizeof(vint32_t);
+					combNext = (const vint32_t*)expect(sizeof(vint32_t), combLength);
+					break;
+				case PureImageSection::CombCheck:
+					combCheck = (const vint32_t*)data;
+					break;
+				default:
+					check((section.flags & PureImageSection::Optional) != 0, L"The image requires an unsupported section.", Reason::Incompatible);
+				}
+			}
+			check(charBlockIndex && charBlocks && finalStates && deadStates && aliveStates, L"The image is corrupted.", Reason::Corrupted);
+			if (charRangeClasses)
+			{
+				check(charRangeClassCount == charRangeCount, L"The image is corrupted.", Reason::Corrupted);
+				for (vint i = 0; i < charRangeCount; i++)
+				{
+					check(0 <= charRangeClasses[i] && charRangeClasses[i] < charSetCount, L"The image is corrupted.", Reason::Corrupted);
+				}
+			}
+			else
+			{
+				check(charRangeCount == charSetCount - 1, L"The image is corrupted.", Reason::Corrupted);
+			}
+			if (!transitions)
+			{
+				// every item of a row should be inside the comb vector, so that no bound checking is needed in GetTransition
+				check(combBases && combNext && combCheck, L"The image is corrupted.", Reason::Corrupted);
+				for (vuint32_t i = 0; i < imageHeader->sectionCount; i++)
+				{
+					if (sections[i].id == PureImageSection::CombCheck)
+					{
+						check(sections[i].size == sizeof(vint32_t) * combLength, L"The image is corrupted.", Reason::Corrupted);
+					}
+				}
+				for (vint i = 0; i < stateCount; i++)
+				{
+					check(0 <= combBases[i] && combBases[i] + charSetCount <= combLength, L"The image is corrupted.", Reason::Corrupted);
+				}
+				for (vint i = 0; i < combLength; i++)
+				{
+					check(-1 <= combNext[i] && combNext[i] < stateCount, L"The image is corrupted.", Reason::Corrupted);
+					check(-1 <= combCheck[i] && combCheck[i] < stateCount, L"The image is corrupted.", Reason::Corrupted);
+				}
+			}
+			else
+			{
+				for (vint i = 0; i < stateCount * charSetCount; i++)
+				{
+					check(-1 <= transitions[i] && transitions[i] < stateCount, L"The image is corrupted.", Reason::Corrupted);
+				}
+			}
 
-			for (vint i = 0; i < count; i++)
+			// every index stored in the image is used without bound checking, so they are all verified here
+			vint charBlockItemCount = imageHeader->charBlockCount * CharBlockSize;
+			for (vint i = 0; i < CharBlockCount; i++)
 			{
-				if (values[i])
+				check(0 <= charBlockIndex[i] && charBlockIndex[i] + CharBlockSize <= charBlockItemCount, L"The image is corrupted.", Reason::Corrupted);
+			}
+			for (vint i = 0; i < charBlockItemCount; i++)
+			{
+				check(0 <= charBlocks[i] && charBlocks[i] < charSetCount, L"The image is corrupted.", Reason::Corrupted);
+			}
+			if (stateTokens)
+			{
+				for (vint i = 0; i < stateCount; i++)
 				{
-					vint x = i / 8;
-					vint y = i % 8;
-					bits[x] |= (vuint8_t)1 << y;
+					check(-1 <= stateTokens[i], L"The image is corrupted.", Reason::Corrupted);
 				}
 			}
 
-			CHECK_ERROR(
-				outputStream.Write(&bits[0], sizeof(vuint8_t) * bits.Count()) == sizeof(vuint8_t) * bits.Count(),
-				L"Failed to serialize RegexLexer."
-				);
+			// bits after the last state should not be set in state bitsets
+			if (stateCount % 32 != 0)
+			{
+				vint lastWord = stateCount / 32;
+				vuint32_t unusedBits = ~(vuint32_t)0 << (stateCount % 32);
+				check((finalStates[lastWord] & unusedBits) == 0, L"The image is corrupted.", Reason::Corrupted);
+				check((deadStates[lastWord] & unusedBits) == 0, L"The image is corrupted.", Reason::Corrupted);
+				check((aliveStates[lastWord] & unusedBits) == 0, L"The image is corrupted.", Reason::Corrupted);
+			}
+#undef ERROR_MESSAGE_PREFIX
 		}
 
-/***********************************************************************
-PureInterpretor (Serialization)
-***********************************************************************/
-
 		PureInterpretor::PureInterpretor(stream::IStream& inputStream)
 		{
-			ReadInt(inputStream, stateCount);
-			ReadInt(inputStream, charSetCount);
-			ReadInt(inputStream, startState);
+#define ERROR_MESSAGE_PREFIX L"PureInterpretor::PureInterpretor(IStream&)#"
+			using Reason = regex::RegexImageException::Reason;
+			auto check = [](bool condition, const wchar_t* message, Reason reason)
 			{
-				vint count = 0;
-				ReadInt(inputStream, count);
-				charRanges.Resize(count);
-				if (count > 0)
+				if (!condition)
 				{
-					vint size = charRanges.Count() * sizeof(CharRange);
-					CHECK_ERROR(inputStream.Read(&charRanges[0], size) == size, L"Failed to serialize RegexLexer.");
+					throw regex::RegexImageException(WString(ERROR_MESSAGE_PREFIX) + message, reason);
 				}
-				ExpandCharRanges();
+			};
+
+			PureImageHeader imageHeader;
+			check(inputStream.Read(&imageHeader, sizeof(imageHeader)) == sizeof(imageHeader), L"The stream is truncated.", Reason::Truncated);
+			check(imageHeader.magic == PureImageHeader::Magic, L"The stream does not contain a serialized regular expression.", Reason::NotAnImage);
+			check(imageHeader.endian == PureImageHeader::Endian, L"The stream is serialized on a machine with a different byte order.", Reason::ByteOrder);
+			check(imageHeader.version == PureImageHeader::Version, L"The stream is serialized in an unsupported version.", Reason::Version);
+			check(imageHeader.size % 8 == 0 && imageHeader.size >= sizeof(imageHeader), L"The stream is corrupted.", Reason::Corrupted);
+
+			// the size is not verified until the checksum is computed, so the buffer only grows as data is actually read
+			vint size = imageHeader.size;
+			vint loaded = sizeof(imageHeader);
+			ownedImage.Resize(loaded / 8);
+			memcpy(&ownedImage[0], &imageHeader, sizeof(imageHeader));
+			while (loaded < size)
+			{
+				vint capacity = loaded * 2 < size ? loaded * 2 : size;
+				ownedImage.Resize(capacity / 8);
+				vint expected = capacity - loaded;
+				check(inputStream.Read((char*)&ownedImage[0] + loaded, expected) == expected, L"The stream is truncated.", Reason::Truncated);
+				loaded = capacity;
 			}
+			AttachImage(&ownedImage[0], size);
+#undef ERROR_MESSAGE_PREFIX
+		}
 
-			transitions = new vint[stateCount * charSetCount];
-			ReadInts(inputStream, stateCount * charSetCount, transitions);
-
-			finalState = new bool[stateCount];
-			ReadBools(inputStream, stateCount, finalState);
+		PureInterpretor::PureInterpretor(const void* image, vint size)
+		{
+			AttachImage(image, size);
 		}
 
 		void PureInterpretor::Serialize(stream::IStream& outputStream)
 		{
-			WriteInt(outputStream, stateCount);
-			WriteInt(outputStream, charSetCount);
-			WriteInt(outputStream, startState);
-			{
-				WriteInt(outputStream, charRanges.Count());
-				if (charRanges.Count() > 0)
-				{
-					vint size = charRanges.Count() * sizeof(CharRange);
-					CHECK_ERROR(outputStream.Write(&charRanges[0], size) == size, L"Failed to serialize RegexLexer.");
-				}
-			}
-			WriteInts(outputStream, stateCount * charSetCount, transitions);
-			WriteBools(outputStream, stateCount, finalState);
+			vint size = header->size;
+			CHECK_ERROR(outputStream.Write((void*)header, size) == size, L"Failed to serialize RegexLexer.");
+		}
+
+		vint PureInterpretor::GetImageSize()
+		{
+			return header->size;
+		}
+
+		const vint32_t* PureInterpretor::GetStateTokens()
+		{
+			return stateTokens;
+		}
+
+		bool PureInterpretor::IsCompressed()
+		{
+			return transitions == nullptr;
 		}
 
 /***********************************************************************
 PureInterpretor
 ***********************************************************************/
 
-		void PureInterpretor::ExpandCharRanges()
+		vint PureInterpretor::GetCharSet(char32_t c)
+		{
+			return charBlocks[charBlockIndex[c >> CharBlockBits] + (c & (CharBlockSize - 1))];
+		}
+
+		bool PureInterpretor::IsFinal(vint state)
+		{
+			return ((finalStates[state / 32] >> (state % 32)) & 1) == 1;
+		}
+
+		vint PureInterpretor::GetTransition(vint state, vint charSetIndex)
 		{
-			for (vint i = 0; i < SupportedCharCount; i++)
+			if (transitions)
+			{
+				return transitions[state * charSetCount + charSetIndex];
+			}
+			vint index = combBases[state] + charSetIndex;
+			return combCheck[index] == state ? combNext[index] : -1;
+		}
+
+		void PureInterpretor::BuildStateTables(const Array<vint32_t>& transitions, const Array<vuint32_t>& finalStates, vint stateCount, vint charSetCount, Array<vuint32_t>& deadStates, Array<vuint32_t>& aliveStates)
+		{
+			vint wordCount = (stateCount + 31) / 32;
+			deadStates.Resize(wordCount);
+			aliveStates.Resize(wordCount);
+			for (vint i = 0; i < wordCount; i++)
+			{
+				deadStates[i] = 0;
+				aliveStates[i] = 0;
+			}
+
+			// collect transitions backward, sources of each target are stored in [reverseStarts[target], reverseStarts[target + 1])
+			Array<vint> reverseStarts(stateCount + 1);
+			for (vint i = 0; i <= stateCount; i++)
+			{
+				reverseStarts[i] = 0;
+			}
+			for (vint i = 0; i < stateCount; i++)
+			{
+				bool dead = true;
+				for (vint j = 0; j < charSetCount; j++)
+				{
+					vint target = transitions[i * charSetCount + j];
+					if (target != -1)
+					{
+						dead = false;
+						reverseStarts[target + 1]++;
+					}
+				}
+				if (dead)
+				{
+					deadStates[i / 32] |= (vuint32_t)1 << (i % 32);
+				}
+			}
+			for (vint i = 0; i < stateCount; i++)
+			{
+				reverseStarts[i + 1] += reverseStarts[i];
+			}
+
+			Array<vint> reverseSources(reverseStarts[stateCount] == 0 ? 1 : reverseStarts[stateCount]);
+			Array<vint> filled(stateCount);
+			for (vint i = 0; i < stateCount; i++)
+			{
+				filled[i] = reverseStarts[i];
+			}
+			for (vint i = 0; i < stateCount; i++)
+			{
+				for (vint j = 0; j < charSetCount; j++)
+				{
+					vint target = transitions[i * charSetCount + j];
+					if (target != -1)
+					{
+						reverseSources[filled[target]++] = i;
+					}
+				}
+			}
+
+			// walk backward from final states
+			Array<vint> queue(stateCount);
+			vint queueEnd = 0;
+			for (vint i = 0; i < stateCount; i++)
 			{
-				charMap[i] = charSetCount - 1;
+				if (((finalStates[i / 32] >> (i % 32)) & 1) == 1)
+				{
+					aliveStates[i / 32] |= (vuint32_t)1 << (i % 32);
+					queue[queueEnd++] = i;
+				}
 			}
-			// TODO: (enumerable) foreach
-			for (vint i = 0; i < charRanges.Count(); i++)
+			for (vint queueBegin = 0; queueBegin < queueEnd; queueBegin++)
 			{
-				CharRange range = charRanges[i];
-				for (char32_t j = range.begin; j <= range.end; j++)
+				vint target = queue[queueBegin];
+				for (vint i = reverseStarts[target]; i < reverseStarts[target + 1]; i++)
 				{
-					if (j > MaxChar32) break;
-					charMap[j] = i;
+					vint source = reverseSources[i];
+					if (((aliveStates[source / 32] >> (source % 32)) & 1) == 0)
+					{
+						aliveStates[source / 32] |= (vuint32_t)1 << (source % 32);
+						queue[queueEnd++] = source;
+					}
 				}
 			}
 		}
 
-		PureInterpretor::PureInterpretor(Ptr<Automaton> dfa, CharRange::List& subsets)
+		PureInterpretor::PureInterpretor(Ptr<Automaton> dfa, CharRange::List& subsets, const collections::Array<vint>* tokens, PureTableEncoding encoding)
 		{
-			stateCount = dfa->states.Count();
-			charSetCount = subsets.Count() + 1;
-			startState = dfa->states.IndexOf(dfa->startState);
+			vint imageStateCount = dfa->states.Count();
+			vint rangeColumnCount = subsets.Count() + 1;
 
-			// Map char to input index (equivalent char class)
-			CopyFrom(charRanges, subsets);
-			ExpandCharRanges();
-
-			// Create transitions from DFA, using input index to represent input char
-			transitions = new vint[stateCount * charSetCount];
-			for (vint i = 0; i < stateCount; i++)
+			// Create transitions from DFA, using range index to represent input char, the last column is for chars in no range
+			Array<vint32_t> rangeTransitions(imageStateCount * rangeColumnCount);
+			for (vint i = 0; i < imageStateCount; i++)
 			{
-				for (vint j = 0; j < charSetCount; j++)
+				for (vint j = 0; j < rangeColumnCount; j++)
 				{
-					transitions[i * charSetCount + j] = -1;
+					rangeTransitions[i * rangeColumnCount + j] = -1;
 				}
 
 				State* state = dfa->states[i].Obj();
@@ -229,30 +439,322 @@ PureInterpretor
 							vint index = subsets.IndexOf(dfaTransition->range);
 							if (index == -1)
 							{
-								CHECK_ERROR(false, L"PureInterpretor::PureInterpretor(Ptr<Automaton>, CharRange::List&)#Specified chars don't appear in the normalized char ranges.");
+								CHECK_ERROR(false, L"PureInterpretor::PureInterpretor(Ptr<Automaton>, CharRange::List&, const Array<vint>*, PureTableEncoding)#Specified chars don't appear in the normalized char ranges.");
 							}
-							transitions[i * charSetCount + index] = dfa->states.IndexOf(dfaTransition->target);
+							rangeTransitions[i * rangeColumnCount + index] = (vint32_t)dfa->states.IndexOf(dfaTransition->target);
 						}
 						break;
 					default:
-						CHECK_ERROR(false, L"PureInterpretor::PureInterpretor(Ptr<Automaton>, CharRange::List&)#PureInterpretor only accepts Transition::Chars transitions.");
+						CHECK_ERROR(false, L"PureInterpretor::PureInterpretor(Ptr<Automaton>, CharRange::List&, const Array<vint>*, PureTableEncoding)#PureInterpretor only accepts Transition::Chars transitions.");
+					}
+				}
+			}
+
+			// Merge ranges whose columns are identical in every state into one char set, chars in no range still use the last char set
+			Array<vint32_t> rangeClasses(rangeColumnCount);
+			vint imageCharSetCount = 0;
+			{
+				Array<vint> order(rangeColumnCount);
+				for (vint i = 0; i < rangeColumnCount; i++)
+				{
+					order[i] = i;
+				}
+				auto compareColumns = [&](vint a, vint b)
+				{
+					for (vint i = 0; i < imageStateCount; i++)
+					{
+						vint32_t ta = rangeTransitions[i * rangeColumnCount + a];
+						vint32_t tb = rangeTransitions[i * rangeColumnCount + b];
+						if (ta != tb) return ta <=> tb;
+					}
+					return std::strong_ordering::equal;
+				};
+				Sort(&order[0], order.Count(), [&](vint a, vint b)
+				{
+					auto result = compareColumns(a, b);
+					return result != 0 ? result : a <=> b;
+				});
+
+				// columns in a group are sorted by their indices, so the first one is the representative
+				Array<vint> representatives(rangeColumnCount);
+				for (vint i = 0; i < rangeColumnCount; i++)
+				{
+					representatives[order[i]] = i > 0 && compareColumns(order[i - 1], order[i]) == 0 ? representatives[order[i - 1]] : order[i];
+				}
+
+				vint otherRepresentative = representatives[rangeColumnCount - 1];
+				for (vint i = 0; i < rangeColumnCount; i++)
+				{
+					vint representative = representatives[i];
+					if (representative == otherRepresentative)
+					{
+						continue;
+					}
+					rangeClasses[i] = representative == i ? (vint32_t)imageCharSetCount++ : rangeClasses[representative];
+				}
+				for (vint i = 0; i < rangeColumnCount; i++)
+				{
+					if (representatives[i] == otherRepresentative)
+					{
+						rangeClasses[i] = (vint32_t)imageCharSetCount;
+					}
+				}
+				imageCharSetCount++;
+			}
+
+			Array<vint32_t> imageTransitions(imageStateCount * imageCharSetCount);
+			for (vint i = 0; i < imageStateCount; i++)
+			{
+				for (vint j = 0; j < rangeColumnCount; j++)
+				{
+					imageTransitions[i * imageCharSetCount + rangeClasses[j]] = rangeTransitions[i * rangeColumnCount + j];
+				}
+			}
+
+			// Map char to char set index in blocks, identical blocks are shared
+			Array<vint32_t> blockIndex(CharBlockCount);
+			List<vint32_t> blocks;
+			Dictionary<vint32_t, vint32_t> uniformBlocks;
+			{
+				vint32_t block[CharBlockSize];
+				vint range = 0;
+				for (vint i = 0; i < CharBlockCount; i++)
+				{
+					bool uniform = true;
+					for (vint j = 0; j < CharBlockSize; j++)
+					{
+						char32_t c = (char32_t)((i << CharBlockBits) + j);
+						while (range < subsets.Count() && subsets[range].end < c)
+						{
+							range++;
+						}
+						block[j] = rangeClasses[range < subsets.Count() && subsets[range].begin <= c ? range : rangeColumnCount - 1];
+						if (block[j] != block[0]) uniform = false;
+					}
+
+					vint previous = blocks.Count() - CharBlockSize;
+					vint uniformIndex = uniform ? uniformBlocks.Keys().IndexOf(block[0]) : -1;
+					if (uniformIndex != -1)
+					{
+						blockIndex[i] = uniformBlocks.Values()[uniformIndex];
+					}
+					else if (previous >= 0 && memcmp(&blocks[previous], block, sizeof(block)) == 0)
+					{
+						blockIndex[i] = (vint32_t)previous;
+					}
+					else
+					{
+						blockIndex[i] = (vint32_t)blocks.Count();
+						if (uniform)
+						{
+							uniformBlocks.Add(block[0], (vint32_t)blocks.Count());
+						}
+						for (vint j = 0; j < CharBlockSize; j++)
+						{
+							blocks.Add(block[j]);
+						}
 					}
 				}
 			}
 
 			// Mark final states
-			finalState = new bool[stateCount];
-			for (vint i = 0; i < stateCount; i++)
+			Array<vuint32_t> imageFinalStates((imageStateCount + 31) / 32);
+			memset(&imageFinalStates[0], 0, sizeof(vuint32_t) * imageFinalStates.Count());
+			for (vint i = 0; i < imageStateCount; i++)
+			{
+				if (dfa->states[i]->finalState)
+				{
+					imageFinalStates[i / 32] |= (vuint32_t)1 << (i % 32);
+				}
+			}
+
+			// Mark dead states and states which could still reach a final state
+			Array<vuint32_t> imageDeadStates;
+			Array<vuint32_t> imageAliveStates;
+			BuildStateTables(imageTransitions, imageFinalStates, imageStateCount, imageCharSetCount, imageDeadStates, imageAliveStates);
+
+			// Displace rows into a shared vector if the table is sparse
+			Array<vint32_t> imageCombBases;
+			List<vint32_t> imageCombNext;
+			List<vint32_t> imageCombCheck;
+			{
+				Array<vint> rowCounts(imageStateCount);
+				vint usedCount = 0;
+				for (vint i = 0; i < imageStateCount; i++)
+				{
+					rowCounts[i] = 0;
+					for (vint j = 0; j < imageCharSetCount; j++)
+					{
+						if (imageTransitions[i * imageCharSetCount + j] != -1)
+						{
+							rowCounts[i]++;
+						}
+					}
+					usedCount += rowCounts[i];
+				}
+
+				bool compress =
+					encoding == PureTableEncoding::Compressed ||
+					(encoding == PureTableEncoding::Auto && usedCount * CompressDensityDivisor <= imageTransitions.Count());
+				if (compress)
+				{
+					// rows with more transitions are placed first, each row is placed at the first base where it collides with no placed item
+					Array<vint> order(imageStateCount);
+					for (vint i = 0; i < imageStateCount; i++)
+					{
+						order[i] = i;
+					}
+					Sort(&order[0], order.Count(), [&](vint a, vint b)
+					{
+						if (rowCounts[a] != rowCounts[b]) return rowCounts[b] <=> rowCounts[a];
+						return a <=> b;
+					});
+
+					imageCombBases.Resize(imageStateCount);
+					vint firstFree = 0;
+					for (vint state : order)
+					{
+						auto row = &imageTransitions[state * imageCharSetCount];
+						vint firstColumn = 0;
+						while (firstColumn < imageCharSetCount && row[firstColumn] == -1)
+						{
+							firstColumn++;
+						}
+
+						vint base = firstColumn == imageCharSetCount ? 0 : firstFree - firstColumn;
+						if (base < 0) base = 0;
+						while (true)
+						{
+							bool collided = false;
+							for (vint j = firstColumn; j < imageCharSetCount; j++)
+							{
+								if (row[j] != -1 && base + j < imageCombCheck.Count() && imageCombCheck[base + j] != -1)
+								{
+									collided = true;
+									break;
+								}
+							}
+							if (!collided) break;
+							base++;
+						}
+
+						while (imageCombCheck.Count() < base + imageCharSetCount)
+						{
+							imageCombNext.Add(-1);
+							imageCombCheck.Add(-1);
+						}
+						imageCombBases[state] = (vint32_t)base;
+						for (vint j = firstColumn; j < imageCharSetCount; j++)
+						{
+							if (row[j] != -1)
+							{
+								imageCombNext[base + j] = row[j];
+								imageCombCheck[base + j] = (vint32_t)state;
+							}
+						}
+						while (firstFree < imageCombCheck.Count() && imageCombCheck[firstFree] != -1)
+						{
+							firstFree++;
+						}
+					}
+
+					if (encoding == PureTableEncoding::Auto && imageStateCount + imageCombCheck.Count() * 2 >= imageTransitions.Count())
+					{
+						imageCombBases.Resize(0);
+					}
+				}
+			}
+
+			// Collect sections
+			struct SectionData
 			{
-				finalState[i] = dfa->states[i]->finalState;
+				vuint32_t		id;
+				vuint32_t		flags;
+				const void*		data;
+				vint			size;
+			};
+
+			Array<CharRange> imageCharRanges;
+			CopyFrom(imageCharRanges, subsets);
+			Array<vint32_t> imageStateTokens;
+
+			List<SectionData> sectionData;
+			if (imageCharRanges.Count() > 0)
+			{
+				sectionData.Add({ PureImageSection::CharRanges, 0, &imageCharRanges[0], (vint)sizeof(CharRange) * imageCharRanges.Count() });
+				sectionData.Add({ PureImageSection::CharRangeClasses, 0, &rangeClasses[0], (vint)sizeof(vint32_t) * imageCharRanges.Count() });
+			}
+			sectionData.Add({ PureImageSection::CharBlockIndex, 0, &blockIndex[0], (vint)sizeof(vint32_t) * blockIndex.Count() });
+			sectionData.Add({ PureImageSection::CharBlocks, 0, &blocks[0], (vint)sizeof(vint32_t) * blocks.Count() });
+			if (imageCombBases.Count() > 0)
+			{
+				sectionData.Add({ PureImageSection::CombBases, 0, &imageCombBases[0], (vint)sizeof(vint32_t) * imageCombBases.Count() });
+				sectionData.Add({ PureImageSection::CombNext, 0, &imageCombNext[0], (vint)sizeof(vint32_t) * imageCombNext.Count() });
+				sectionData.Add({ PureImageSection::CombCheck, 0, &imageCombCheck[0], (vint)sizeof(vint32_t) * imageCombCheck.Count() });
 			}
+			else
+			{
+				sectionData.Add({ PureImageSection::Transitions, 0, &imageTransitions[0], (vint)sizeof(vint32_t) * imageTransitions.Count() });
+			}
+			sectionData.Add({ PureImageSection::FinalStates, 0, &imageFinalStates[0], (vint)sizeof(vuint32_t) * imageFinalStates.Count() });
+			sectionData.Add({ PureImageSection::DeadStates, 0, &imageDeadStates[0], (vint)sizeof(vuint32_t) * imageDeadStates.Count() });
+			sectionData.Add({ PureImageSection::AliveStates, 0, &imageAliveStates[0], (vint)sizeof(vuint32_t) * imageAliveStates.Count() });
+			if (tokens)
+			{
+				CHECK_ERROR(tokens->Count() == imageStateCount, L"PureInterpretor::PureInterpretor(Ptr<Automaton>, CharRange::List&, const Array<vint>*, PureTableEncoding)#There should be a token for each state.");
+				imageStateTokens.Resize(imageStateCount);
+				for (vint i = 0; i < imageStateCount; i++)
+				{
+					imageStateTokens[i] = (vint32_t)tokens->Get(i);
+				}
+				sectionData.Add({ PureImageSection::StateTokens, PureImageSection::Optional, &imageStateTokens[0], (vint)sizeof(vint32_t) * imageStateCount });
+			}
+
+			// Layout the image
+			auto align = [](vint size) { return (size + 7) / 8 * 8; };
+			vint size = align(sizeof(PureImageHeader) + sizeof(PureImageSection) * sectionData.Count());
+			for (auto&& section : sectionData)
+			{
+				size += align(section.size);
+			}
+			CHECK_ERROR(size <= 0xFFFFFFFF, L"PureInterpretor::PureInterpretor(Ptr<Automaton>, CharRange::List&, const Array<vint>*, PureTableEncoding)#The DFA is too large.");
+
+			ownedImage.Resize(size / 8);
+			memset(&ownedImage[0], 0, size);
+			auto image = (char*)&ownedImage[0];
+
+			auto imageHeader = (PureImageHeader*)image;
+			imageHeader->magic = PureImageHeader::Magic;
+			imageHeader->endian = PureImageHeader::Endian;
+			imageHeader->version = PureImageHeader::Version;
+			imageHeader->size = (vuint32_t)size;
+			imageHeader->alphabet = PureImageHeader::AlphabetUtf32;
+			imageHeader->stateWidth = sizeof(vint32_t);
+			imageHeader->sectionCount = (vuint32_t)sectionData.Count();
+			imageHeader->stateCount = (vint32_t)imageStateCount;
+			imageHeader->charSetCount = (vint32_t)imageCharSetCount;
+			imageHeader->startState = (vint32_t)dfa->states.IndexOf(dfa->startState);
+			imageHeader->charBlockCount = (vint32_t)(blocks.Count() / CharBlockSize);
+
+			auto imageSections = (PureImageSection*)(imageHeader + 1);
+			vint offset = align(sizeof(PureImageHeader) + sizeof(PureImageSection) * sectionData.Count());
+			for (auto [section, index] : indexed(sectionData))
+			{
+				imageSections[index].id = section.id;
+				imageSections[index].flags = section.flags;
+				imageSections[index].offset = (vuint32_t)offset;
+				imageSections[index].size = (vuint32_t)section.size;
+				memcpy(image + offset, section.data, section.size);
+				offset += align(section.size);
+			}
+
+			imageHeader->checksum = GetImageChecksum(image, size);
+			AttachImage(image, size);
 		}
 
 		PureInterpretor::~PureInterpretor()
 		{
 			if (relatedFinalState) delete[] relatedFinalState;
-			delete[] finalState;
-			delete[] transitions;
 		}
 
 		template<typename TChar>
@@ -274,7 +776,7 @@ PureInterpretor
 
 				terminateState = currentState;
 				terminateLength = reader.Index();
-				if (finalState[currentState])
+				if (IsFinal(currentState))
 				{
 					result.length = terminateLength;
 					result.finalState = currentState;
@@ -283,10 +785,13 @@ PureInterpretor
 				if (!c) break;
 				if (c >= SupportedCharCount) break;
 
-				vint charIndex = charMap[c];
-				currentState = transitions[currentState * charSetCount + charIndex];
+				vint charIndex = GetCharSet(c);
+				currentState = GetTransition(currentState, charIndex);
 			}
 
+			result.scannedLength = terminateLength + 1;
+			REGEX_STATISTICS(counters.matchHeads++);
+			REGEX_STATISTICS(counters.scannedChars += result.scannedLength);
 			if (result.finalState == -1)
 			{
 				if (terminateLength > 0)
@@ -308,6 +813,7 @@ PureInterpretor
 			CharReader<TChar> reader(input);
 			while (reader.Read())
 			{
+				REGEX_STATISTICS(if (reader.Reading() != input) counters.matchHeadRestarts++);
 				if (MatchHead(reader.Reading(), start, result))
 				{
 					return true;
@@ -316,6 +822,52 @@ PureInterpretor
 			return false;
 		}
 
+		template<typename TChar>
+		bool PureInterpretor::TestHead(const TChar* input)
+		{
+			// unlike MatchHead, stop at the first final state instead of finding the longest match
+			CharReader<TChar> reader(input);
+			vint currentState = startState;
+			while (!IsFinal(currentState))
+			{
+				auto c = reader.Read();
+				if (!c) return false;
+				if (c >= SupportedCharCount) return false;
+
+				vint charIndex = GetCharSet(c);
+				currentState = GetTransition(currentState, charIndex);
+				if (currentState == -1) return false;
+			}
+			return true;
+		}
+
+		vint PureInterpretor::GetStateCount()
+		{
+			return stateCount;
+		}
+
+		vint PureInterpretor::GetCharSetCount()
+		{
+			return charSetCount;
+		}
+
+		vint PureInterpretor::GetCharRangeCount()
+		{
+			return charRangeCount;
+		}
+
+		CharRange PureInterpretor::GetCharRange(vint index)
+		{
+			CHECK_ERROR(0 <= index && index < charRangeCount, L"PureInterpretor::GetCharRange(vint)#Argument out of range.");
+			return charRanges[index];
+		}
+
+		vint PureInterpretor::GetCharRangeClass(vint index)
+		{
+			CHECK_ERROR(0 <= index && index < charRangeCount, L"PureInterpretor::GetCharRangeClass(vint)#Argument out of range.");
+			return charRangeClasses ? charRangeClasses[index] : index;
+		}
+
 		vint PureInterpretor::GetStartState()
 		{
 			return startState;
@@ -325,8 +877,8 @@ PureInterpretor
 		{
 			if (0 <= state && state < stateCount && 0 <= input && input <= MaxChar32)
 			{
-				vint charIndex = charMap[input];
-				vint nextState = transitions[state * charSetCount + charIndex];
+				vint charIndex = GetCharSet(input);
+				vint nextState = GetTransition(state, charIndex);
 				return nextState;
 			}
 			else
@@ -337,20 +889,19 @@ PureInterpretor
 
 		bool PureInterpretor::IsFinalState(vint state)
 		{
-			return 0 <= state && state < stateCount&& finalState[state];
+			return 0 <= state && state < stateCount && IsFinal(state);
 		}
 
 		bool PureInterpretor::IsDeadState(vint state)
 		{
 			if (state == -1) return true;
-			for (vint i = 0; i < charSetCount; i++)
-			{
-				if (transitions[state * charSetCount + i] != -1)
-				{
-					return false;
-				}
-			}
-			return true;
+			return ((deadStates[state / 32] >> (state % 32)) & 1) == 1;
+		}
+
+		bool PureInterpretor::CanReachFinalState(vint state)
+		{
+			if (state == -1) return false;
+			return ((aliveStates[state / 32] >> (state % 32)) & 1) == 1;
 		}
 
 		void PureInterpretor::PrepareForRelatedFinalStateTable()
@@ -360,7 +911,7 @@ PureInterpretor
 				relatedFinalState = new vint[stateCount];
 				for (vint i = 0; i < stateCount; i++)
 				{
-					relatedFinalState[i] = finalState[i] ? i : -1;
+					relatedFinalState[i] = IsFinal(i) ? i : -1;
 				}
 				while (true)
 				{
@@ -372,7 +923,7 @@ PureInterpretor
 							vint state = -1;
 							for (vint j = 0; j < charSetCount; j++)
 							{
-								vint nextState = transitions[i * charSetCount + j];
+								vint nextState = GetTransition(i, j);
 								if (nextState != -1)
 								{
 									state = relatedFinalState[nextState];
@@ -411,5 +962,10 @@ PureInterpretor
 		template bool			PureInterpretor::Match<char8_t>(const char8_t* input, const char8_t* start, PureResult& result);
 		template bool			PureInterpretor::Match<char16_t>(const char16_t* input, const char16_t* start, PureResult& result);
 		template bool			PureInterpretor::Match<char32_t>(const char32_t* input, const char32_t* start, PureResult& result);
+
+		template bool			PureInterpretor::TestHead<wchar_t>(const wchar_t* input);
+		template bool			PureInterpretor::TestHead<char8_t>(const char8_t* input);
+		template bool			PureInterpretor::TestHead<char16_t>(const char16_t* input);
+		template bool			PureInterpretor::TestHead<char32_t>(const char32_t* input);
 	}
 }
\ No newline at end of file
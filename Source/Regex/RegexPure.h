@@ -8,6 +8,12 @@ Licensed under https://github.com/vczh-libraries/License
 
 #include "./Automaton/RegexAutomaton.h"
 
+#ifdef VCZH_REGEX_STATISTICS
+#define REGEX_STATISTICS(...) __VA_ARGS__
+#else
+#define REGEX_STATISTICS(...)
+#endif
+
 namespace vl
 {
 	namespace stream
@@ -24,30 +30,129 @@ namespace vl
 			vint				length;
 			vint				finalState;
 			vint				terminateState;
+			vint				scannedLength;		// code units read before the DFA stops, including the first code unit of the char that stops it
+		};
+
+		// counters updated by interpretors while matching, only available when VCZH_REGEX_STATISTICS is defined
+		struct InterpretorCounters
+		{
+			vint				matchHeads = 0;							// attempts to match from a position
+			vint				matchHeadRestarts = 0;					// attempts to match from a position other than the first one in Match
+			vint				scannedChars = 0;						// code units read, a code unit is counted again after backtracking
+			vint				backtracks = 0;
+			vint				stateSaverHighWaterMark = 0;			// the maximum number of saved states in a single attempt
+			vint				prefilterRejections = 0;				// positions skipped because the prefilter proves no match could start
+			vint				lazyFlushes = 0;						// times the DFA cache is dropped
+		};
+
+		extern vuint32_t		UpdateCrc32(vuint32_t crc, const void* data, vint size);
+
+		// the serialized PureInterpretor, which is used in place without any conversion, so it could be mapped directly from a file
+		// the header is followed by a section table, all offsets are in bytes from the beginning of the image, all sections are aligned to 8 bytes
+		// sections unknown to a reader are skipped if they are optional, otherwise the image is rejected
+		struct PureImageHeader
+		{
+			static const vuint32_t	Magic = 0x58475256;			// "VRGX"
+			static const vuint32_t	Endian = 0x01020304;		// reads differently on a machine with a different byte order
+			static const vuint32_t	Version = 3;
+			static const vuint32_t	AlphabetUtf32 = 1;			// char sets are ranges of UTF-32 code points
+
+			vuint32_t			magic;
+			vuint32_t			endian;
+			vuint32_t			version;
+			vuint32_t			size;						// size of the whole image, a multiple of 8
+			vuint32_t			checksum;					// CRC-32 of the whole image, with this field as 0
+			vuint32_t			alphabet;
+			vuint32_t			stateWidth;					// size of a state in bytes
+			vuint32_t			sectionCount;
+			vint32_t			stateCount;
+			vint32_t			charSetCount;
+			vint32_t			startState;
+			vint32_t			charBlockCount;
+		};
+
+		struct PureImageSection
+		{
+			static const vuint32_t	Optional = 1;
+
+			enum : vuint32_t
+			{
+				CharRanges = 1,								// CharRange[charRangeCount]
+				CharBlockIndex = 2,							// vint32_t[CharBlockCount], (char >> CharBlockBits) -> the first item of the block in CharBlocks
+				CharBlocks = 3,								// vint32_t[charBlockCount * CharBlockSize], char -> char set index
+				Transitions = 4,							// vint32_t[stateCount * charSetCount], (state * charSetCount + charSetIndex) -> state
+				FinalStates = 5,							// vuint32_t[(stateCount + 31) / 32], state -> bit
+				StateTokens = 6,							// vint32_t[stateCount], state -> token, optional, only for RegexLexer_
+				CombBases = 7,								// vint32_t[stateCount], state -> the first item of the row in CombNext and CombCheck, replacing Transitions
+				CombNext = 8,								// vint32_t[combLength], (base + charSetIndex) -> state
+				CombCheck = 9,								// vint32_t[combLength], (base + charSetIndex) -> the owner state of the item, or -1
+				CharRangeClasses = 10,						// vint32_t[charRangeCount], range -> char set index, when absent the i-th range is the i-th char set
+				DeadStates = 11,							// vuint32_t[(stateCount + 31) / 32], state -> bit, a state without any transition
+				AliveStates = 12,							// vuint32_t[(stateCount + 31) / 32], state -> bit, a state which could still reach a final state
+			};
+
+			vuint32_t			id;
+			vuint32_t			flags;
+			vuint32_t			offset;
+			vuint32_t			size;
+		};
+
+		enum class PureTableEncoding
+		{
+			Auto,											// Compressed if the transition table is sparse
+			Dense,											// a stateCount * charSetCount matrix
+			Compressed,										// rows are displaced into a shared vector, the owner of each item is checked
 		};
 
 		class PureInterpretor : public Object
 		{
-			using CharRangeArray = collections::Array<CharRange>;
 		protected:
 			static const vint	SupportedCharCount = MaxChar32 + 1;
+			static const vint	CharBlockBits = 8;
+			static const vint	CharBlockSize = 1 << CharBlockBits;
+			static const vint	CharBlockCount = SupportedCharCount >> CharBlockBits;
+			static const vint	CompressDensityDivisor = 4;							// a table is sparse if no more than 1/4 of transitions are not -1
 
-			CharRangeArray		charRanges;
-			vint				charMap[SupportedCharCount];		// char -> char set index
-			vint*				transitions = nullptr;				// (state * charSetCount + charSetIndex) -> state
-			bool*				finalState = nullptr;				// state -> bool
+			collections::Array<vuint64_t>	ownedImage;			// the image when it is not provided by the caller
+			const PureImageHeader*	header = nullptr;
+			const CharRange*	charRanges = nullptr;
+			const vint32_t*		charRangeClasses = nullptr;
+			vint				charRangeCount = 0;
+			const vint32_t*		charBlockIndex = nullptr;
+			const vint32_t*		charBlocks = nullptr;
+			const vint32_t*		transitions = nullptr;
+			const vint32_t*		combBases = nullptr;
+			const vint32_t*		combNext = nullptr;
+			const vint32_t*		combCheck = nullptr;
+			vint				combLength = 0;
+			const vuint32_t*	finalStates = nullptr;
+			const vint32_t*		stateTokens = nullptr;
 			vint*				relatedFinalState = nullptr;		// state -> (finalState or -1)
+			const vuint32_t*	deadStates = nullptr;
+			const vuint32_t*	aliveStates = nullptr;
 			vint				stateCount;
 			vint				charSetCount;
 			vint				startState;
 
-			void				ExpandCharRanges();
+			void				AttachImage(const void* image, vint size);
+			static void			BuildStateTables(const collections::Array<vint32_t>& transitions, const collections::Array<vuint32_t>& finalStates, vint stateCount, vint charSetCount, collections::Array<vuint32_t>& deadStates, collections::Array<vuint32_t>& aliveStates);
+			vint				GetCharSet(char32_t c);
+			bool				IsFinal(vint state);
+			vint				GetTransition(vint state, vint charSetIndex);
 		public:
-			PureInterpretor(Ptr<Automaton> dfa, CharRange::List& subsets);
+			PureInterpretor(Ptr<Automaton> dfa, CharRange::List& subsets, const collections::Array<vint>* tokens = nullptr, PureTableEncoding encoding = PureTableEncoding::Auto);
 			PureInterpretor(stream::IStream& inputStream);
+			PureInterpretor(const void* image, vint size);
 			~PureInterpretor();
 
+#ifdef VCZH_REGEX_STATISTICS
+			InterpretorCounters	counters;
+#endif
+
 			void				Serialize(stream::IStream& outputStream);
+			vint				GetImageSize();
+			const vint32_t*		GetStateTokens();
+			bool				IsCompressed();
 
 			template<typename TChar>
 			bool				MatchHead(const TChar* input, const TChar* start, PureResult& result);
@@ -55,10 +160,19 @@ namespace vl
 			template<typename TChar>
 			bool				Match(const TChar* input, const TChar* start, PureResult& result);
 
+			template<typename TChar>
+			bool				TestHead(const TChar* input);
+
+			vint				GetStateCount();
+			vint				GetCharSetCount();
+			vint				GetCharRangeCount();
+			CharRange			GetCharRange(vint index);
+			vint				GetCharRangeClass(vint index);
 			vint				GetStartState();
 			vint				Transit(char32_t input, vint state);
 			bool				IsFinalState(vint state);
 			bool				IsDeadState(vint state);
+			bool				CanReachFinalState(vint state);
 
 			void				PrepareForRelatedFinalStateTable();
 			vint				GetRelatedFinalState(vint state);
@@ -73,6 +187,11 @@ namespace vl
 		extern template bool	PureInterpretor::Match<char8_t>(const char8_t* input, const char8_t* start, PureResult& result);
 		extern template bool	PureInterpretor::Match<char16_t>(const char16_t* input, const char16_t* start, PureResult& result);
 		extern template bool	PureInterpretor::Match<char32_t>(const char32_t* input, const char32_t* start, PureResult& result);
+
+		extern template bool	PureInterpretor::TestHead<wchar_t>(const wchar_t* input);
+		extern template bool	PureInterpretor::TestHead<char8_t>(const char8_t* input);
+		extern template bool	PureInterpretor::TestHead<char16_t>(const char16_t* input);
+		extern template bool	PureInterpretor::TestHead<char32_t>(const char32_t* input);
 	}
 }
 
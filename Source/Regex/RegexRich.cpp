@@ -3,6 +3,8 @@ Author: Zihan Chen (vczh)
 Licensed under https://github.com/vczh-libraries/License
 ***********************************************************************/
 
+#include <VlppOS.h>
+#include "Regex.h"
 #include "RegexRich.h"
 #include "RegexCharReader.h"
 
@@ -29,7 +31,7 @@ Data Structures for Backtracking
 
 			CharReader<TChar>		reader;										// Current reading position
 			char32_t				ch;											// Current character
-			State*					currentState;								// Current state
+			vint					currentState;								// Current state
 			vint					minTransition = 0;							// The first transition to backtrack
 			vint					captureCount = 0;							// Available capture count			(the list size may larger than this)
 			vint					stateSaverCount = 0;						// Available saver count			(the list size may larger than this)
@@ -37,7 +39,7 @@ Data Structures for Backtracking
 			vint					extensionSaverCount = 0;					// Available extension saver count	(during executing)
 			StateStoreType			storeType = StateStoreType::Other;			// Reason to keep this record
 
-			StateSaver(const TChar* input, State* _currentState)
+			StateSaver(const TChar* input, vint _currentState)
 				: reader(input)
 				, currentState(_currentState)
 			{
@@ -62,7 +64,7 @@ Data Structures for Backtracking
 			char32_t				ch;											// Current character
 			vint					previous;									// Previous extension saver index
 			vint					captureListIndex;							// Where to write the captured text
-			Transition*				transition;									// The extension begin transition (Capture, Positive, Negative)
+			Transition::Type		type;										// The extension begin transition (Capture, Positive, Negative)
 
 			ExtensionSaver(const StateSaver<TChar>& saver)
 				: reader(saver.reader)
@@ -79,6 +81,28 @@ Data Structures for Backtracking
 				saver.ch = ch;
 			}
 		};
+
+		class CaptureSlot
+		{
+		public:
+			collections::List<vint>	records;									// Indices of capture records of the same capture	(the list size may larger than this)
+			vint					count = 0;									// Available record count
+		};
+
+		template<typename TChar>
+		class RichMatchContext
+		{
+		public:
+			collections::List<StateSaver<TChar>>		stateSavers;
+			collections::List<ExtensionSaver<TChar>>	extensionSavers;
+			collections::List<CaptureRecord>			captures;			// All capture records in order, also the undo log of slots
+			collections::Array<CaptureSlot>				slots;				// 0 for anonymous captures, (i + 1) for the named capture i
+
+			RichMatchContext(vint captureNameCount)
+				: slots(captureNameCount + 1)
+			{
+			}
+		};
 	}
 
 	namespace regex_internal
@@ -128,6 +152,69 @@ Data Structures for Backtracking
 		{
 			return elements[--count];
 		}
+
+		template<typename TChar>
+		bool IsSameText(const TChar* captured, const TChar* reading, vint length)
+		{
+			// the input is zero-terminated and captured text contains no zero
+			// so the loop always stops at the end of the input before reading further
+			for (vint i = 0; i < length; i++)
+			{
+				if (captured[i] != reading[i]) return false;
+			}
+			return true;
+		}
+
+		template<typename TChar>
+		void PushCapture(RichMatchContext<TChar>& context, vint& captureCount, const CaptureRecord& capture)
+		{
+			auto& slot = context.slots[capture.capture + 1];
+			PushNonSaver(slot.records, slot.count, captureCount);
+			PushNonSaver(context.captures, captureCount, capture);
+		}
+
+		template<typename TChar>
+		void RollbackCaptures(RichMatchContext<TChar>& context, vint captureCount, vint targetCaptureCount)
+		{
+			// records are pushed to slots in the same order, so undoing them only pops the top of slots
+			for (vint i = captureCount - 1; i >= targetCaptureCount; i--)
+			{
+				context.slots[context.captures[i].capture + 1].count--;
+			}
+		}
+
+		vint FindCharDispatch(const RichInterpretor::InstructionState& state, const RichInterpretor::CharDispatch* charDispatches, char32_t ch)
+		{
+			// ranges in a state never overlap, so at most one Chars instruction accepts the character
+			vint start = state.firstCharDispatch;
+			vint end = start + state.charDispatchCount - 1;
+			while (start <= end)
+			{
+				vint middle = (start + end) / 2;
+				auto& dispatch = charDispatches[middle];
+				if (ch < dispatch.range.begin)
+				{
+					end = middle - 1;
+				}
+				else if (ch > dispatch.range.end)
+				{
+					start = middle + 1;
+				}
+				else
+				{
+					return dispatch.instruction;
+				}
+			}
+			return -1;
+		}
+
+		vint NextCandidateInstruction(const RichInterpretor::InstructionState& state, const RichInterpretor::Instruction* instructions, vint index, vint charInstruction)
+		{
+			// skip all Chars instructions that does not accept the current character, keeping the order of the rest
+			if (index >= state.instructionCount) return state.instructionCount;
+			vint nonChars = instructions[state.firstInstruction + index].nextNonChars;
+			return index <= charInstruction && charInstruction < nonChars ? charInstruction : nonChars;
+		}
 	}
 
 	namespace regex_internal
@@ -138,74 +225,368 @@ RichInterpretor
 ***********************************************************************/
 
 		RichInterpretor::RichInterpretor(Ptr<Automaton> _dfa)
-			:dfa(_dfa)
 		{
-			datas = new UserData[dfa->states.Count()];
+			stateCount = _dfa->states.Count();
+			instructionCount = _dfa->transitions.Count();
+			charDispatchCount = From(_dfa->transitions)
+				.Where([](auto&& transition) { return transition->type == Transition::Chars; })
+				.Count();
+			states = new InstructionState[stateCount];
+			instructions = new Instruction[instructionCount];
+			charDispatches = new CharDispatch[charDispatchCount];
+			CopyFrom(captureNames, _dfa->captureNames);
+
+			Dictionary<State*, vint> stateIndices;
+			for (auto [state, index] : indexed(_dfa->states))
+			{
+				stateIndices.Add(state.Obj(), index);
+			}
+			startState = stateIndices[_dfa->startState];
 
-			// TODO: (enumerable) foreach
-			for (vint i = 0; i < dfa->states.Count(); i++)
+			vint currentInstruction = 0;
+			vint currentCharDispatch = 0;
+			for (vint i = 0; i < stateCount; i++)
 			{
-				State* state = dfa->states[i].Obj();
+				State* state = _dfa->states[i].Obj();
 				vint charEdges = 0;
 				vint nonCharEdges = 0;
 				bool mustSave = false;
-				// TODO: (enumerable) foreach
-				for (vint j = 0; j < state->transitions.Count(); j++)
+				for (auto transition : state->transitions)
 				{
-					if (state->transitions[j]->type == Transition::Chars)
+					if (transition->type == Transition::Chars)
 					{
 						charEdges++;
 					}
 					else
 					{
-						if (state->transitions[j]->type == Transition::Negative ||
-							state->transitions[j]->type == Transition::Positive)
+						if (transition->type == Transition::Negative ||
+							transition->type == Transition::Positive)
 						{
 							mustSave = true;
 						}
 						nonCharEdges++;
 					}
 				}
-				datas[i].NeedKeepState = mustSave || nonCharEdges > 1 || (nonCharEdges != 0 && charEdges != 0);
-				state->userData = &datas[i];
+				bool needKeepState = mustSave || nonCharEdges > 1 || (nonCharEdges != 0 && charEdges != 0);
+
+				auto& instructionState = states[i];
+				instructionState.firstInstruction = currentInstruction;
+				instructionState.instructionCount = state->transitions.Count();
+				instructionState.negativeFailTarget = -1;
+				instructionState.firstCharDispatch = currentCharDispatch;
+				instructionState.charDispatchCount = charEdges;
+				instructionState.finalState = state->finalState;
+
+				for (auto [transition, index] : indexed(state->transitions))
+				{
+					auto& instruction = instructions[currentInstruction++];
+					instruction.type = transition->type;
+					instruction.needKeepState = needKeepState;
+					instruction.target = stateIndices[transition->target];
+					instruction.range = transition->range;
+					instruction.capture = transition->capture;
+					instruction.index = transition->index;
+
+					if (transition->type == Transition::NegativeFail && instructionState.negativeFailTarget == -1)
+					{
+						instructionState.negativeFailTarget = instruction.target;
+					}
+
+					if (transition->type == Transition::Chars)
+					{
+						auto& dispatch = charDispatches[currentCharDispatch++];
+						dispatch.range = transition->range;
+						dispatch.instruction = index;
+					}
+				}
+
+				{
+					vint nonChars = instructionState.instructionCount;
+					for (vint j = instructionState.instructionCount - 1; j >= 0; j--)
+					{
+						auto& instruction = instructions[instructionState.firstInstruction + j];
+						if (instruction.type != Transition::Chars)
+						{
+							nonChars = j;
+						}
+						instruction.nextNonChars = nonChars;
+					}
+				}
+
+				{
+					auto dispatches = charDispatches + instructionState.firstCharDispatch;
+					Sort(dispatches, instructionState.charDispatchCount, [](const CharDispatch& a, const CharDispatch& b)
+					{
+						return a.range.begin <=> b.range.begin;
+					});
+					for (vint j = 1; j < instructionState.charDispatchCount; j++)
+					{
+						CHECK_ERROR(dispatches[j - 1].range.end < dispatches[j].range.begin, L"RichInterpretor::RichInterpretor(Ptr<Automaton>)#Character ranges of transitions from the same state should not overlap.");
+					}
+				}
 			}
+			CHECK_ERROR(currentInstruction == instructionCount, L"RichInterpretor::RichInterpretor(Ptr<Automaton>)#Transitions in the automaton are not owned by its states.");
 		}
 
 		RichInterpretor::~RichInterpretor()
 		{
-			delete[] datas;
+			delete[] states;
+			delete[] instructions;
+			delete[] charDispatches;
+		}
+
+/***********************************************************************
+RichInterpretor (Serialization)
+***********************************************************************/
+
+		RichInterpretor::RichInterpretor(stream::IStream& inputStream)
+		{
+#define ERROR_MESSAGE_PREFIX L"RichInterpretor::RichInterpretor(IStream&)#"
+			using Reason = regex::RegexImageException::Reason;
+			auto check = [](bool condition, const wchar_t* message, Reason reason)
+			{
+				if (!condition)
+				{
+					throw regex::RegexImageException(WString(ERROR_MESSAGE_PREFIX) + message, reason);
+				}
+			};
+
+			RichProgramHeader header;
+			check(inputStream.Read(&header, sizeof(header)) == sizeof(header), L"The stream is truncated.", Reason::Truncated);
+			check(header.magic == RichProgramHeader::Magic, L"The stream does not contain a serialized regular expression.", Reason::NotAnImage);
+			check(header.endian == RichProgramHeader::Endian, L"The stream is serialized on a machine with a different byte order.", Reason::ByteOrder);
+			check(header.version == RichProgramHeader::Version, L"The stream is serialized in an unsupported version.", Reason::Version);
+
+			// the count is not verified until the checksum is computed, so the buffer only grows as data is actually read
+			Array<vint32_t> payload;
+			vint payloadSize = sizeof(vint32_t) * (vint)header.payloadCount;
+			vint loaded = 0;
+			while (loaded < payloadSize)
+			{
+				vint capacity = loaded * 2 < 4096 ? 4096 : loaded * 2;
+				if (capacity > payloadSize) capacity = payloadSize;
+				payload.Resize(capacity / sizeof(vint32_t));
+				vint expected = capacity - loaded;
+				check(inputStream.Read((char*)&payload[0] + loaded, expected) == expected, L"The stream is truncated.", Reason::Truncated);
+				loaded = capacity;
+			}
+			check(UpdateCrc32(0, payloadSize > 0 ? &payload[0] : nullptr, payloadSize) == header.checksum, L"The checksum does not match the stream.", Reason::Checksum);
+
+			vint reading = 0;
+			auto read = [&]()
+			{
+				check(reading < payload.Count(), L"The stream is corrupted.", Reason::Corrupted);
+				return (vint)payload[reading++];
+			};
+			auto readIndex = [&](vint count)
+			{
+				vint index = read();
+				check(-1 <= index && index < count, L"The stream is corrupted.", Reason::Corrupted);
+				return index;
+			};
+
+			stateCount = read();
+			instructionCount = read();
+			charDispatchCount = read();
+			check(stateCount > 0 && instructionCount >= 0 && charDispatchCount >= 0, L"The stream is corrupted.", Reason::Corrupted);
+			startState = readIndex(stateCount);
+			check(startState != -1, L"The stream is corrupted.", Reason::Corrupted);
+
+			states = new InstructionState[stateCount];
+			instructions = new Instruction[instructionCount];
+			charDispatches = new CharDispatch[charDispatchCount];
+
+			for (vint i = 0; i < stateCount; i++)
+			{
+				auto& state = states[i];
+				state.firstInstruction = read();
+				state.instructionCount = read();
+				state.negativeFailTarget = readIndex(stateCount);
+				state.firstCharDispatch = read();
+				state.charDispatchCount = read();
+				state.finalState = read() != 0;
+				check(
+					0 <= state.firstInstruction && 0 <= state.instructionCount && state.firstInstruction + state.instructionCount <= instructionCount &&
+					0 <= state.firstCharDispatch && 0 <= state.charDispatchCount && state.firstCharDispatch + state.charDispatchCount <= charDispatchCount,
+					L"The stream is corrupted.", Reason::Corrupted);
+			}
+
+			for (vint i = 0; i < instructionCount; i++)
+			{
+				auto& instruction = instructions[i];
+				vint type = read();
+				check(Transition::Chars <= type && type <= Transition::End, L"The stream is corrupted.", Reason::Corrupted);
+				instruction.type = (Transition::Type)type;
+				instruction.needKeepState = read() != 0;
+				instruction.target = readIndex(stateCount);
+				instruction.range.begin = (char32_t)read();
+				instruction.range.end = (char32_t)read();
+				instruction.capture = read();
+				instruction.index = read();
+				instruction.nextNonChars = readIndex(instructionCount + 1);
+			}
+
+			for (vint i = 0; i < charDispatchCount; i++)
+			{
+				auto& dispatch = charDispatches[i];
+				dispatch.range.begin = (char32_t)read();
+				dispatch.range.end = (char32_t)read();
+				dispatch.instruction = readIndex(instructionCount);
+			}
+
+			vint captureNameCount = read();
+			for (vint i = 0; i < captureNameCount; i++)
+			{
+				vint length = read();
+				check(0 <= length && length <= payload.Count() - reading, L"The stream is corrupted.", Reason::Corrupted);
+				Array<char32_t> buffer(length + 1);
+				for (vint j = 0; j < length; j++)
+				{
+					buffer[j] = (char32_t)read();
+				}
+				buffer[length] = 0;
+				captureNames.Add(U32String(&buffer[0]));
+			}
+
+			// indices in instructions and the dispatch table are relative to the state, they are used without bound checking while matching
+			for (vint i = 0; i < stateCount; i++)
+			{
+				auto& state = states[i];
+				for (vint j = 0; j < state.instructionCount; j++)
+				{
+					auto& instruction = instructions[state.firstInstruction + j];
+					check(j <= instruction.nextNonChars && instruction.nextNonChars <= state.instructionCount, L"The stream is corrupted.", Reason::Corrupted);
+				}
+				for (vint j = 0; j < state.charDispatchCount; j++)
+				{
+					auto& dispatch = charDispatches[state.firstCharDispatch + j];
+					check(
+						0 <= dispatch.instruction && dispatch.instruction < state.instructionCount &&
+						instructions[state.firstInstruction + dispatch.instruction].type == Transition::Chars &&
+						dispatch.range.begin <= dispatch.range.end &&
+						(j == 0 || charDispatches[state.firstCharDispatch + j - 1].range.end < dispatch.range.begin),
+						L"The stream is corrupted.", Reason::Corrupted);
+				}
+			}
+
+			for (vint i = 0; i < instructionCount; i++)
+			{
+				auto& instruction = instructions[i];
+				bool useCapture = instruction.type == Transition::Capture || instruction.type == Transition::Match;
+				check(
+					instruction.target != -1 &&
+					(!useCapture || (-1 <= instruction.capture && instruction.capture < captureNames.Count())) &&
+					(instruction.type != Transition::Match || instruction.index >= -1) &&
+					(instruction.type != Transition::Chars || instruction.range.begin <= instruction.range.end),
+					L"The stream is corrupted.", Reason::Corrupted);
+			}
+			check(reading == payload.Count(), L"The stream is corrupted.", Reason::Corrupted);
+#undef ERROR_MESSAGE_PREFIX
+		}
+
+		void RichInterpretor::Serialize(stream::IStream& outputStream)
+		{
+			List<vint32_t> payload;
+			auto write = [&](vint value)
+			{
+				payload.Add((vint32_t)value);
+			};
+
+			write(stateCount);
+			write(instructionCount);
+			write(charDispatchCount);
+			write(startState);
+
+			for (vint i = 0; i < stateCount; i++)
+			{
+				auto& state = states[i];
+				write(state.firstInstruction);
+				write(state.instructionCount);
+				write(state.negativeFailTarget);
+				write(state.firstCharDispatch);
+				write(state.charDispatchCount);
+				write(state.finalState ? 1 : 0);
+			}
+
+			for (vint i = 0; i < instructionCount; i++)
+			{
+				auto& instruction = instructions[i];
+				write(instruction.type);
+				write(instruction.needKeepState ? 1 : 0);
+				write(instruction.target);
+				write(instruction.range.begin);
+				write(instruction.range.end);
+				write(instruction.capture);
+				write(instruction.index);
+				write(instruction.nextNonChars);
+			}
+
+			for (vint i = 0; i < charDispatchCount; i++)
+			{
+				auto& dispatch = charDispatches[i];
+				write(dispatch.range.begin);
+				write(dispatch.range.end);
+				write(dispatch.instruction);
+			}
+
+			write(captureNames.Count());
+			for (auto&& name : captureNames)
+			{
+				write(name.Length());
+				for (vint i = 0; i < name.Length(); i++)
+				{
+					write(name[i]);
+				}
+			}
+
+			vint payloadSize = sizeof(vint32_t) * payload.Count();
+			RichProgramHeader header;
+			header.magic = RichProgramHeader::Magic;
+			header.endian = RichProgramHeader::Endian;
+			header.version = RichProgramHeader::Version;
+			header.checksum = UpdateCrc32(0, &payload[0], payloadSize);
+			header.payloadCount = (vuint32_t)payload.Count();
+			header.reserved = 0;
+
+			CHECK_ERROR(outputStream.Write(&header, sizeof(header)) == sizeof(header), L"Failed to serialize Regex.");
+			CHECK_ERROR(outputStream.Write(&payload[0], payloadSize) == payloadSize, L"Failed to serialize Regex.");
 		}
 
 		template<typename TChar>
-		bool RichInterpretor::MatchHead(const TChar* input, const TChar* start, RichResult& result)
+		bool RichInterpretor::MatchHeadInternal(const TChar* input, const TChar* start, RichResult& result, RichMatchContext<TChar>& context)
 		{
-			List<StateSaver<TChar>> stateSavers;
-			List<ExtensionSaver<TChar>> extensionSavers;
+			auto& stateSavers = context.stateSavers;
+			auto& extensionSavers = context.extensionSavers;
+			for (vint i = 0; i < context.slots.Count(); i++)
+			{
+				context.slots[i].count = 0;
+			}
 
-			StateSaver<TChar> currentState(input, dfa->startState);
+			StateSaver<TChar> currentState(input, startState);
+			REGEX_STATISTICS(counters.matchHeads++);
 
-			while (!currentState.currentState->finalState)
+			while (!states[currentState.currentState].finalState)
 			{
 				bool found = false; // true means at least one transition matches the input
 				StateSaver<TChar> oldState = currentState;
-				// Iterate through all transitions from the current state
-				// TODO: (enumerable) foreach:reversed
-				for (vint i = currentState.minTransition; i < currentState.currentState->transitions.Count(); i++)
+				const InstructionState* state = &states[currentState.currentState];
+				vint charInstruction = FindCharDispatch(*state, charDispatches, currentState.ch);
+				// Iterate through all instructions from the current state that could be used, in their original order
+				for (
+					vint i = NextCandidateInstruction(*state, instructions, currentState.minTransition, charInstruction);
+					i < state->instructionCount;
+					i = NextCandidateInstruction(*state, instructions, i + 1, charInstruction)
+					)
 				{
-					Transition* transition = currentState.currentState->transitions[i];
-					switch (transition->type)
+					const Instruction& instruction = instructions[state->firstInstruction + i];
+					switch (instruction.type)
 					{
 					case Transition::Chars:
 						{
-							// match the input if the current character fall into the range
-							CharRange range = transition->range;
-							found =
-								range.begin <= currentState.ch &&
-								range.end >= currentState.ch;
-							if (found)
-							{
-								currentState.ch = currentState.reader.Read();
-							}
+							// the only Chars instruction that is visited accepts the current character
+							found = true;
+							currentState.ch = currentState.reader.Read();
+							REGEX_STATISTICS(counters.scannedChars++);
 						}
 						break;
 					case Transition::BeginString:
@@ -231,55 +612,39 @@ RichInterpretor
 							// Push the capture information
 							ExtensionSaver<TChar> saver(currentState);
 							saver.captureListIndex = currentState.captureCount;
-							saver.transition = transition;
+							saver.type = instruction.type;
 							Push(extensionSavers, currentState.extensionSaverAvailable, currentState.extensionSaverCount, saver);
 
 							// Push the capture record, and it will be written if the input matches the regex
 							CaptureRecord capture;
-							capture.capture = transition->capture;
+							capture.capture = instruction.capture;
 							capture.start = currentState.reader.Index() + (input - start);
 							capture.length = -1;
-							PushNonSaver(result.captures, currentState.captureCount, capture);
+							PushCapture(context, currentState.captureCount, capture);
 
 							found = true;
 						}
 						break;
 					case Transition::Match:
 						{
-							vint index = 0;
-							for (vint j = 0; j < currentState.captureCount; j++)
+							// Find records of the capture directly from its slot
+							auto& slot = context.slots[instruction.capture + 1];
+							vint firstRecord = instruction.index == -1 ? 0 : instruction.index;
+							vint lastRecord = instruction.index == -1 ? slot.count - 1 : (instruction.index < slot.count ? instruction.index : -1);
+							for (vint j = firstRecord; j <= lastRecord; j++)
 							{
-								CaptureRecord& capture = result.captures[j];
-								// If the capture name matched
-								if (capture.capture == transition->capture)
+								CaptureRecord& capture = context.captures[slot.records[j]];
+								// If the capture has been closed
+								if (capture.length != -1)
 								{
-									// If the capture index matched, or it is -1
-									if (capture.length != -1 && (transition->index == -1 || transition->index == index))
-									{
-										// If the captured text matched
-										if (memcmp(start + capture.start, input + currentState.reader.Index(), sizeof(TChar) * capture.length) == 0)
-										{
-											// Consume so much input
-											vint targetIndex = currentState.reader.Index() + capture.length;
-											while (currentState.reader.Index() < targetIndex)
-											{
-												currentState.ch = currentState.reader.Read();
-											}
-											CHECK_ERROR(currentState.reader.Index() == targetIndex, L"vl::regex_internal::RichInterpretor::MatchHead<TChar>(const TChar*, const TChar*, RichResult&)#Input code could be an incorrect unicode sequence.");
-											found = true;
-											break;
-										}
-									}
-
-									// Fail if f the captured text with the specified name and index doesn't match
-									if (transition->index != -1 && index == transition->index)
+									// If the captured text matched
+									if (IsSameText(start + capture.start, currentState.reader.Reading(), capture.length))
 									{
+										// Consume so much input, the captured text always ends at a character boundary
+										currentState.ch = currentState.reader.Skip(capture.length);
+										found = true;
 										break;
 									}
-									else
-									{
-										index++;
-									}
 								}
 							}
 						}
@@ -289,7 +654,7 @@ RichInterpretor
 							// Push the positive lookahead information
 							ExtensionSaver<TChar> saver(currentState);
 							saver.captureListIndex = -1;
-							saver.transition = transition;
+							saver.type = instruction.type;
 							Push(extensionSavers, currentState.extensionSaverAvailable, currentState.extensionSaverCount, saver);
 
 							// Set found = true so that PushNonSaver(oldState) happens later
@@ -303,7 +668,7 @@ RichInterpretor
 
 							ExtensionSaver<TChar> saver(currentState);
 							saver.captureListIndex = -1;
-							saver.transition = transition;
+							saver.type = instruction.type;
 							Push(extensionSavers, currentState.extensionSaverAvailable, currentState.extensionSaverCount, saver);
 
 							// Set found = true so that PushNonSaver(oldState) happens later
@@ -320,12 +685,12 @@ RichInterpretor
 						{
 							// Find the corresponding extension saver so that we can know how to deal with a matched sub regex that ends here
 							ExtensionSaver extensionSaver = Pop(extensionSavers, currentState.extensionSaverAvailable, currentState.extensionSaverCount);
-							switch (extensionSaver.transition->type)
+							switch (extensionSaver.type)
 							{
 							case Transition::Capture:
 								{
 									// Write the captured text
-									CaptureRecord& capture = result.captures[extensionSaver.captureListIndex];
+									CaptureRecord& capture = context.captures[extensionSaver.captureListIndex];
 									capture.length = currentState.reader.Index() + (input - start) - capture.start;
 									found = true;
 								}
@@ -357,8 +722,11 @@ RichInterpretor
 										// restore the parsing state just before matching the negative lookahead, since positive lookahead doesn't consume input
 										oldState = stateSaver;
 										oldState.storeType = StateStoreType::Other;
+										RollbackCaptures(context, currentState.captureCount, stateSaver.captureCount);
 										currentState = stateSaver;
 										currentState.storeType = StateStoreType::Other;
+										state = &states[currentState.currentState];
+										charInstruction = FindCharDispatch(*state, charDispatches, currentState.ch);
 										i = currentState.minTransition - 1;
 										break;
 									}
@@ -374,13 +742,13 @@ RichInterpretor
 					// Save the parsing state when necessary
 					if (found)
 					{
-						UserData* data = (UserData*)currentState.currentState->userData;
-						if (data->NeedKeepState)
+						if (instruction.needKeepState)
 						{
 							oldState.minTransition = i + 1;
 							PushNonSaver(stateSavers, currentState.stateSaverCount, oldState);
+							REGEX_STATISTICS(if (counters.stateSaverHighWaterMark < currentState.stateSaverCount) counters.stateSaverHighWaterMark = currentState.stateSaverCount);
 						}
-						currentState.currentState = transition->target;
+						currentState.currentState = instruction.target;
 						currentState.minTransition = 0;
 						break;
 					}
@@ -392,26 +760,23 @@ RichInterpretor
 					// If there is a chance to do backtracking
 					if (currentState.stateSaverCount)
 					{
+						vint captureCount = currentState.captureCount;
 						currentState = PopNonSaver(stateSavers, currentState.stateSaverCount);
+						REGEX_STATISTICS(counters.backtracks++);
+						RollbackCaptures(context, captureCount, currentState.captureCount);
 						// minTransition - 1 is always valid since the value is stored with adding 1
 						// So minTransition - 1 record the transition, which is the reason the parsing state is saved
-						if (currentState.currentState->transitions[currentState.minTransition - 1]->type == Transition::Negative)
+						auto& savedState = states[currentState.currentState];
+						if (instructions[savedState.firstInstruction + currentState.minTransition - 1].type == Transition::Negative)
 						{
-							// Find the next NegativeFail transition
+							// Restore the state to the target of the NegativeFail transition to let the parsing continue
 							// Because when a negative lookahead regex failed to match, it is actually succeeded
 							// Since a negative lookahead means we don't want to match this regex
-							// TODO: (enumerable) foreach:reversed
-							for (vint i = 0; i < currentState.currentState->transitions.Count(); i++)
+							if (savedState.negativeFailTarget != -1)
 							{
-								Transition* transition = currentState.currentState->transitions[i];
-								if (transition->type == Transition::NegativeFail)
-								{
-									// Restore the state to the target of NegativeFail to let the parsing continue
-									currentState.currentState = transition->target;
-									currentState.minTransition = 0;
-									currentState.storeType = StateStoreType::Other;
-									break;
-								}
+								currentState.currentState = savedState.negativeFailTarget;
+								currentState.minTransition = 0;
+								currentState.storeType = StateStoreType::Other;
 							}
 						}
 					}
@@ -422,14 +787,20 @@ RichInterpretor
 				}
 			}
 
-			if (currentState.currentState->finalState)
+			if (states[currentState.currentState].finalState)
 			{
 				// Keep available captures if succeeded
+				// slots already group records by capture, so copy them slot by slot
+				// to return anonymous captures first and then named captures in ascending order
 				result.start = input - start;
 				result.length = currentState.reader.Index();
-				for (vint i = result.captures.Count() - 1; i >= currentState.captureCount; i--)
+				result.captures.Clear();
+				for (auto&& slot : context.slots)
 				{
-					result.captures.RemoveAt(i);
+					for (vint i = 0; i < slot.count; i++)
+					{
+						result.captures.Add(context.captures[slot.records[i]]);
+					}
 				}
 				return true;
 			}
@@ -441,13 +812,30 @@ RichInterpretor
 			}
 		}
 
+		template<typename TChar>
+		bool RichInterpretor::MatchHead(const TChar* input, const TChar* start, RichResult& result)
+		{
+			RichMatchContext<TChar> context(captureNames.Count());
+			return MatchHeadInternal(input, start, result, context);
+		}
+
 		template<typename TChar>
 		bool RichInterpretor::Match(const TChar* input, const TChar* start, RichResult& result)
 		{
+			// buffers in the context are reused for all positions
+			RichMatchContext<TChar> context(captureNames.Count());
 			CharReader<TChar> reader(input);
 			while (reader.Read())
 			{
-				if (MatchHead(reader.Reading(), start, result))
+				auto reading = reader.Reading();
+				// skip positions where the prefilter proves that no match could start
+				if (prefilter && !prefilter->TestHead(reading))
+				{
+					REGEX_STATISTICS(counters.prefilterRejections++);
+					continue;
+				}
+				REGEX_STATISTICS(if (reading != input) counters.matchHeadRestarts++);
+				if (MatchHeadInternal(reading, start, result, context))
 				{
 					return true;
 				}
@@ -455,9 +843,99 @@ RichInterpretor
 			return false;
 		}
 
+		vint RichInterpretor::GetStateCount()
+		{
+			return stateCount;
+		}
+
+		vint RichInterpretor::GetInstructionCount()
+		{
+			return instructionCount;
+		}
+
+		vint RichInterpretor::GetTableSize()
+		{
+			return
+				sizeof(InstructionState) * stateCount +
+				sizeof(Instruction) * instructionCount +
+				sizeof(CharDispatch) * charDispatchCount;
+		}
+
 		const List<U32String>& RichInterpretor::CaptureNames()
 		{
-			return dfa->captureNames;
+			return captureNames;
+		}
+
+		PureInterpretor* RichInterpretor::GetPrefilter()
+		{
+			return prefilter;
+		}
+
+		void RichInterpretor::SetPrefilter(PureInterpretor* _prefilter)
+		{
+			prefilter = _prefilter;
+		}
+
+		WString RichInterpretor::Dump()
+		{
+			auto captureName = [&](vint capture)
+			{
+				return capture == -1 ? WString::Unmanaged(L"<anonymous>") : u32tow(captureNames[capture]);
+			};
+
+			WString dump;
+			for (vint i = 0; i < stateCount; i++)
+			{
+				auto& state = states[i];
+				if (i == startState) dump += L"[START]";
+				if (state.finalState) dump += L"[FINISH]";
+				dump += L"State<" + itow(i) + L"> : #" + itow(state.firstInstruction) + L" x " + itow(state.instructionCount) + L"\r\n";
+
+				for (vint j = 0; j < state.instructionCount; j++)
+				{
+					auto& instruction = instructions[state.firstInstruction + j];
+					dump += L"    #" + itow(state.firstInstruction + j) + L" ";
+					switch (instruction.type)
+					{
+					case Transition::Chars:
+						dump += L"CHARS " + itow(instruction.range.begin) + L" " + itow(instruction.range.end);
+						break;
+					case Transition::BeginString:
+						dump += L"BEGIN-STRING";
+						break;
+					case Transition::EndString:
+						dump += L"END-STRING";
+						break;
+					case Transition::Nop:
+						dump += L"NOP";
+						break;
+					case Transition::Capture:
+						dump += L"CAPTURE " + captureName(instruction.capture);
+						break;
+					case Transition::Match:
+						dump += L"MATCH " + captureName(instruction.capture) + L";" + itow(instruction.index);
+						break;
+					case Transition::Positive:
+						dump += L"POSITIVE";
+						break;
+					case Transition::Negative:
+						dump += L"NEGATIVE";
+						break;
+					case Transition::NegativeFail:
+						dump += L"NEGATIVE-FAIL";
+						break;
+					case Transition::End:
+						dump += L"END";
+						break;
+					default:
+						dump += L"EPSILON";
+					}
+					dump += L" -> State<" + itow(instruction.target) + L">";
+					if (instruction.needKeepState) dump += L" [KEEP]";
+					dump += L"\r\n";
+				}
+			}
+			return dump;
 		}
 
 		template bool			RichInterpretor::MatchHead<wchar_t>(const wchar_t* input, const wchar_t* start, RichResult& result);
@@ -6,7 +6,7 @@ Licensed under https://github.com/vczh-libraries/License
 #ifndef VCZH_REGEX_REGEXRICH
 #define VCZH_REGEX_REGEXRICH
 
-#include "./Automaton/RegexAutomaton.h"
+#include "RegexPure.h"
 
 namespace vl
 {
@@ -23,37 +23,109 @@ namespace vl
 
 	namespace regex_internal
 	{
+		template<typename TChar>
+		class RichMatchContext;
+
 		class RichResult
 		{
 		public:
 			vint									start;
 			vint									length;
-			collections::List<CaptureRecord>		captures;
+			collections::List<CaptureRecord>		captures;					// anonymous captures first, then named captures in ascending order, each in the matching order
+		};
+
+		// the serialized RichInterpretor is a header followed by payloadCount vint32_t
+		struct RichProgramHeader
+		{
+			static const vuint32_t	Magic = 0x50475256;			// "VRGP"
+			static const vuint32_t	Endian = 0x01020304;		// reads differently on a machine with a different byte order
+			static const vuint32_t	Version = 1;
+
+			vuint32_t			magic;
+			vuint32_t			endian;
+			vuint32_t			version;
+			vuint32_t			checksum;					// CRC-32 of the payload
+			vuint32_t			payloadCount;
+			vuint32_t			reserved;
 		};
 
 		class RichInterpretor : public Object
 		{
 		public:
-		protected:
-			class UserData
+			/// <summary>
+			/// A flattened transition of the rich DFA.
+			/// Instructions of the same state are stored continuously in the same order of transitions,
+			/// so that trying them one by one keeps the priority of alternatives.
+			/// </summary>
+			class Instruction
+			{
+			public:
+				Transition::Type					type;
+				bool								needKeepState;			// true if the source state needs to be saved for backtracking
+				vint								target;					// index of the target state
+				CharRange							range;					// for Chars
+				vint								capture;				// for Capture and Match
+				vint								index;					// for Match
+				vint								nextNonChars;			// the first instruction in the same state that is not Chars, starting from this one
+			};
+
+			/// <summary>An entry in the sorted dispatch table of Chars instructions of a state.</summary>
+			class CharDispatch
 			{
 			public:
-				bool								NeedKeepState;
+				CharRange							range;
+				vint								instruction;			// index of the Chars instruction in the state
 			};
 
-			Ptr<Automaton>							dfa;
-			UserData*								datas;
+			/// <summary>A flattened state of the rich DFA, owning a range of instructions.</summary>
+			class InstructionState
+			{
+			public:
+				vint								firstInstruction;
+				vint								instructionCount;
+				vint								negativeFailTarget;		// target of the NegativeFail transition, -1 if there is no such transition
+				vint								firstCharDispatch;
+				vint								charDispatchCount;
+				bool								finalState;
+			};
+
+		protected:
+			InstructionState*						states = nullptr;
+			Instruction*							instructions = nullptr;
+			CharDispatch*							charDispatches = nullptr;
+			vint									stateCount = 0;
+			vint									instructionCount = 0;
+			vint									charDispatchCount = 0;
+			vint									startState = -1;
+			collections::List<U32String>			captureNames;
+			PureInterpretor*						prefilter = nullptr;	// a DFA accepting a superset of the regex, not owned by this object
+
+			template<typename TChar>
+			bool									MatchHeadInternal(const TChar* input, const TChar* start, RichResult& result, RichMatchContext<TChar>& context);
 		public:
 			RichInterpretor(Ptr<Automaton> _dfa);
+			RichInterpretor(stream::IStream& inputStream);
 			~RichInterpretor();
 
+#ifdef VCZH_REGEX_STATISTICS
+			InterpretorCounters						counters;
+#endif
+
+			void									Serialize(stream::IStream& outputStream);
+
 			template<typename TChar>
 			bool									MatchHead(const TChar* input, const TChar* start, RichResult& result);
 
 			template<typename TChar>
 			bool									Match(const TChar* input, const TChar* start, RichResult& result);
 
+			vint									GetStateCount();
+			vint									GetInstructionCount();
+			vint									GetTableSize();			// bytes of states, instructions and the char dispatch table
 			const collections::List<U32String>&		CaptureNames();
+			PureInterpretor*						GetPrefilter();
+			void									SetPrefilter(PureInterpretor* _prefilter);
+			WString									Dump();
 		};
 
 		extern template bool	RichInterpretor::MatchHead<wchar_t>(const wchar_t* input, const wchar_t* start, RichResult& result);
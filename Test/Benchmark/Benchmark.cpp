@@ -0,0 +1,507 @@
+#include "../../Source/Regex/Regex.h"
+#include <VlppOS.h>
+#include <chrono>
+#include <math.h>
+
+using namespace vl;
+using namespace vl::collections;
+using namespace vl::console;
+using namespace vl::stream;
+using namespace vl::regex;
+
+/***********************************************************************
+Measurement
+***********************************************************************/
+
+struct BenchmarkResult
+{
+	WString										name;
+	vint										iterations = 0;				// calls in each sample
+	vint										bytes = 0;					// bytes processed by each call
+	double										mean = 0;					// nanoseconds per call
+	double										median = 0;
+	double										stddev = 0;
+	double										min = 0;
+};
+
+class Benchmark
+{
+protected:
+	static const vint							SampleCount = 15;
+	static constexpr double						SampleNanoseconds = 20000000.0;
+	static const vint							MaxIterations = 1 << 24;
+
+	WString										filter;
+	List<BenchmarkResult>						results;
+
+	template<typename F>
+	static double Time(vint iterations, F& f)
+	{
+		auto begin = std::chrono::steady_clock::now();
+		for (vint i = 0; i < iterations; i++)
+		{
+			f();
+		}
+		auto end = std::chrono::steady_clock::now();
+		return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+	}
+
+public:
+	Benchmark(const WString& _filter)
+		:filter(_filter)
+	{
+	}
+
+	const List<BenchmarkResult>& GetResults()
+	{
+		return results;
+	}
+
+	// bytes is the size of the input processed by each call, 0 if throughput is meaningless
+	template<typename F>
+	void Run(const WString& name, vint bytes, F&& f)
+	{
+		if (filter != L"" && INVLOC.FindFirst(name, filter, Locale::None).key == -1) return;
+
+		// warm up, and grow the number of calls in a sample until a sample takes long enough
+		vint iterations = 1;
+		while (true)
+		{
+			double elapsed = Time(iterations, f);
+			if (elapsed >= SampleNanoseconds || iterations >= MaxIterations) break;
+			vint scale = elapsed <= 0 ? 16 : (vint)(SampleNanoseconds / elapsed * 1.2) + 1;
+			if (scale > 16) scale = 16;
+			if (scale < 2) scale = 2;
+			iterations *= scale;
+			if (iterations > MaxIterations) iterations = MaxIterations;
+		}
+
+		Array<double> samples(SampleCount);
+		for (vint i = 0; i < SampleCount; i++)
+		{
+			samples[i] = Time(iterations, f) / iterations;
+		}
+		Sort(&samples[0], samples.Count(), [](double a, double b) { return a < b ? std::strong_ordering::less : a > b ? std::strong_ordering::greater : std::strong_ordering::equal; });
+
+		BenchmarkResult result;
+		result.name = name;
+		result.iterations = iterations;
+		result.bytes = bytes;
+		result.min = samples[0];
+		result.median = SampleCount % 2 == 1 ? samples[SampleCount / 2] : (samples[SampleCount / 2 - 1] + samples[SampleCount / 2]) / 2;
+		for (vint i = 0; i < SampleCount; i++)
+		{
+			result.mean += samples[i];
+		}
+		result.mean /= SampleCount;
+		for (vint i = 0; i < SampleCount; i++)
+		{
+			result.stddev += (samples[i] - result.mean) * (samples[i] - result.mean);
+		}
+		result.stddev = sqrt(result.stddev / (SampleCount - 1));
+		results.Add(result);
+
+		WString line = name;
+		while (line.Length() < 56) line += L" ";
+		line += L"median " + ftow(round(result.median)) + L" ns";
+		line += L", mean " + ftow(round(result.mean)) + L" ns";
+		line += L" +- " + ftow(round(result.stddev / result.mean * 1000) / 10) + L"%";
+		if (bytes > 0)
+		{
+			line += L", " + ftow(round(bytes / result.median * 1000000000.0 / 1048576.0 * 10) / 10) + L" MiB/s";
+		}
+		Console::WriteLine(line);
+	}
+};
+
+// keeps results from being optimized away
+volatile vint benchmarkSink = 0;
+
+/***********************************************************************
+Corpora
+***********************************************************************/
+
+class CorpusRandom
+{
+protected:
+	vuint32_t									seed;
+
+public:
+	CorpusRandom(vuint32_t _seed)
+		:seed(_seed)
+	{
+	}
+
+	vint Next(vint max)
+	{
+		seed = seed * 1103515245 + 12345;
+		return (vint)((seed >> 8) % (vuint32_t)max);
+	}
+
+	template<vint Count>
+	const wchar_t* Pick(const wchar_t* (&items)[Count])
+	{
+		return items[Next(Count)];
+	}
+};
+
+WString GenerateLogCorpus(vint size)
+{
+	const wchar_t* levels[] = { L"INFO", L"INFO", L"INFO", L"DEBUG", L"WARN", L"ERROR" };
+	const wchar_t* services[] = { L"gateway", L"auth", L"billing", L"search", L"storage" };
+	const wchar_t* messages[] = { L"request completed", L"cache miss", L"retrying upstream call", L"connection reset by peer", L"user signed in" };
+
+	CorpusRandom random(20261019);
+	WString corpus;
+	while (corpus.Length() < size)
+	{
+		corpus +=
+			L"2026-10-" + itow(10 + random.Next(20)) +
+			L" " + itow(10 + random.Next(14)) + L":" + itow(10 + random.Next(50)) + L":" + itow(10 + random.Next(50)) +
+			L" [" + random.Pick(levels) + L"] " + random.Pick(services) +
+			L": " + random.Pick(messages) +
+			L" id=" + itow(random.Next(1000000)) +
+			L" from 10." + itow(random.Next(256)) + L"." + itow(random.Next(256)) + L"." + itow(random.Next(256)) +
+			L" took " + itow(random.Next(2000)) + L"ms\r\n";
+	}
+	return corpus;
+}
+
+WString GenerateSourceCorpus(vint size)
+{
+	const wchar_t* types[] = { L"int", L"double", L"auto", L"vint", L"WString" };
+	const wchar_t* names[] = { L"index", L"count", L"value", L"result", L"buffer", L"length" };
+	const wchar_t* operators[] = { L"+", L"-", L"*", L"/", L"==", L"<=", L"&&" };
+
+	CorpusRandom random(20261020);
+	WString corpus;
+	while (corpus.Length() < size)
+	{
+		corpus += L"/* computes " + WString::Unmanaged(random.Pick(names)) + L" from the input */\r\n";
+		corpus += WString::Unmanaged(random.Pick(types)) + L" Function" + itow(random.Next(1000)) + L"(" + random.Pick(types) + L" " + random.Pick(names) + L")\r\n{\r\n";
+		vint statements = 2 + random.Next(6);
+		for (vint i = 0; i < statements; i++)
+		{
+			corpus +=
+				WString(L"\t") + random.Pick(types) + L" " + random.Pick(names) + itow(i) +
+				L" = " + random.Pick(names) + L" " + random.Pick(operators) + L" " + itow(random.Next(100000)) +
+				L"." + itow(random.Next(100)) + L";\r\n";
+		}
+		corpus += L"\treturn \"" + WString::Unmanaged(random.Pick(names)) + L"\";\r\n}\r\n\r\n";
+	}
+	return corpus;
+}
+
+WString GenerateJsonCorpus(vint size)
+{
+	const wchar_t* keys[] = { L"id", L"name", L"price", L"tags", L"enabled", L"owner" };
+	const wchar_t* words[] = { L"alpha", L"beta", L"gamma", L"delta", L"\\u00e9t\\u00e9", L"quoted \\\"text\\\"" };
+
+	CorpusRandom random(20261021);
+	WString corpus = L"[\r\n";
+	while (corpus.Length() < size)
+	{
+		corpus += L"  {";
+		vint fields = 2 + random.Next(5);
+		for (vint i = 0; i < fields; i++)
+		{
+			if (i > 0) corpus += L", ";
+			corpus += L"\"" + WString::Unmanaged(random.Pick(keys)) + L"\": ";
+			switch (random.Next(4))
+			{
+			case 0:
+				corpus += itow(random.Next(1000000));
+				break;
+			case 1:
+				corpus += L"-" + itow(random.Next(1000)) + L"." + itow(random.Next(1000)) + L"e" + itow(random.Next(10));
+				break;
+			case 2:
+				corpus += L"\"" + WString::Unmanaged(random.Pick(words)) + L"\"";
+				break;
+			default:
+				corpus += random.Next(2) == 0 ? L"true" : L"null";
+			}
+		}
+		corpus += L"},\r\n";
+	}
+	corpus += L"  {}\r\n]\r\n";
+	return corpus;
+}
+
+template<typename T>
+ObjectString<T> ConvertCorpus(const WString& corpus)
+{
+	if constexpr (std::is_same_v<T, wchar_t>) return corpus;
+	if constexpr (std::is_same_v<T, char8_t>) return wtou8(corpus);
+	if constexpr (std::is_same_v<T, char16_t>) return wtou16(corpus);
+	if constexpr (std::is_same_v<T, char32_t>) return wtou32(corpus);
+}
+
+template<typename T>
+const wchar_t* CharTypeName()
+{
+	if constexpr (std::is_same_v<T, wchar_t>) return L"wchar_t";
+	if constexpr (std::is_same_v<T, char8_t>) return L"char8_t";
+	if constexpr (std::is_same_v<T, char16_t>) return L"char16_t";
+	if constexpr (std::is_same_v<T, char32_t>) return L"char32_t";
+}
+
+/***********************************************************************
+Regex
+***********************************************************************/
+
+struct RegexCase
+{
+	const wchar_t*								name;
+	const wchar_t*								pattern;
+	const WString*								corpus;
+};
+
+template<typename T>
+void BenchmarkRegexOnCharType(Benchmark& benchmark, const WString& prefix, Regex& regex, const WString& corpus)
+{
+	auto input = ConvertCorpus<T>(corpus);
+	auto line = input.Sub(0, 200);
+	vint bytes = input.Length() * sizeof(T);
+	vint lineBytes = line.Length() * sizeof(T);
+	WString name = prefix + L"/" + CharTypeName<T>();
+
+	benchmark.Run(name + L"/MatchHead", lineBytes, [&]()
+	{
+		benchmarkSink = benchmarkSink + (regex.MatchHead(line) ? 1 : 0);
+	});
+	benchmark.Run(name + L"/Match", lineBytes, [&]()
+	{
+		benchmarkSink = benchmarkSink + (regex.Match(line) ? 1 : 0);
+	});
+	benchmark.Run(name + L"/TestHead", lineBytes, [&]()
+	{
+		benchmarkSink = benchmarkSink + (regex.TestHead(line) ? 1 : 0);
+	});
+	benchmark.Run(name + L"/Test", lineBytes, [&]()
+	{
+		benchmarkSink = benchmarkSink + (regex.Test(line) ? 1 : 0);
+	});
+	benchmark.Run(name + L"/Search", bytes, [&]()
+	{
+		typename RegexMatch_<T>::List matches;
+		regex.Search(input, matches);
+		benchmarkSink = benchmarkSink + matches.Count();
+	});
+	benchmark.Run(name + L"/Split", bytes, [&]()
+	{
+		typename RegexMatch_<T>::List matches;
+		regex.Split(input, false, matches);
+		benchmarkSink = benchmarkSink + matches.Count();
+	});
+	benchmark.Run(name + L"/Cut", bytes, [&]()
+	{
+		typename RegexMatch_<T>::List matches;
+		regex.Cut(input, false, matches);
+		benchmarkSink = benchmarkSink + matches.Count();
+	});
+}
+
+void BenchmarkRegex(Benchmark& benchmark, const WString& logs, const WString& source, const WString& json)
+{
+	RegexCase cases[] =
+	{
+		{ L"ipv4", L"/d+./d+./d+./d+", &logs },
+		{ L"error-line", L"/[ERROR/][^\\r\\n]*", &logs },
+		{ L"duration", L"took (<ms>/d+)ms", &logs },
+		{ L"number", L"-?/d+(./d+)?([eE][+/-]?/d+)?", &json },
+		{ L"json-string", L"\"([^\"\\\\]|\\\\.)*\"", &json },
+		{ L"block-comment", L"///*([^*]|/*+[^*//])*/*+//", &source },
+		{ L"repeated-word", L"(<w>[a-z]+) (<$w>)", &source },
+	};
+
+	for (auto&& regexCase : cases)
+	{
+		for (vint mode = 0; mode < 2; mode++)
+		{
+			WString prefix = WString(L"Regex/") + regexCase.name + (mode == 0 ? L"/pure" : L"/rich");
+			benchmark.Run(prefix + L"/Construct", 0, [&]()
+			{
+				Regex regex(regexCase.pattern, mode == 0);
+				benchmarkSink = benchmarkSink + (regex.IsPureMatch() ? 1 : 0);
+			});
+
+			Regex regex(regexCase.pattern, mode == 0);
+			if (mode == 0 && !regex.IsPureTest()) continue;
+			BenchmarkRegexOnCharType<wchar_t>(benchmark, prefix, regex, *regexCase.corpus);
+			BenchmarkRegexOnCharType<char8_t>(benchmark, prefix, regex, *regexCase.corpus);
+			BenchmarkRegexOnCharType<char16_t>(benchmark, prefix, regex, *regexCase.corpus);
+			BenchmarkRegexOnCharType<char32_t>(benchmark, prefix, regex, *regexCase.corpus);
+
+			if (mode == 0)
+			{
+				benchmark.Run(prefix + L"/SerializeRoundTrip", 0, [&]()
+				{
+					MemoryStream stream;
+					regex.Serialize(stream);
+					stream.SeekFromBegin(0);
+					Regex loaded(stream);
+					benchmarkSink = benchmarkSink + (loaded.IsPureMatch() ? 1 : 0);
+				});
+			}
+		}
+	}
+}
+
+/***********************************************************************
+RegexLexer
+***********************************************************************/
+
+template<typename T>
+void BenchmarkLexerOnCharType(Benchmark& benchmark, const WString& prefix, RegexLexer& lexer, const WString& corpus)
+{
+	auto input = ConvertCorpus<T>(corpus);
+	vint bytes = input.Length() * sizeof(T);
+	WString name = prefix + L"/" + CharTypeName<T>();
+
+	benchmark.Run(name + L"/Parse", bytes, [&]()
+	{
+		vint count = 0;
+		for (auto&& token : lexer.Parse(input))
+		{
+			count += token.token;
+		}
+		benchmarkSink = benchmarkSink + count;
+	});
+
+	benchmark.Run(name + L"/Colorize", bytes, [&]()
+	{
+		vint count = 0;
+		RegexProc_<T> proc;
+		auto colorizer = lexer.Colorize(proc);
+		const T* reading = input.Buffer();
+		const T* end = reading + input.Length();
+		while (reading < end)
+		{
+			const T* lineEnd = reading;
+			while (lineEnd < end && *lineEnd++ != (T)'\n');
+			colorizer.Colorize(reading, lineEnd - reading, [&](vint, vint, vint token) { count += token; });
+			reading = lineEnd;
+		}
+		benchmarkSink = benchmarkSink + count;
+	});
+
+	benchmark.Run(name + L"/Walk", bytes, [&]()
+	{
+		auto walker = lexer.Walk<T>();
+		List<RegexWalkEvent> events;
+		vint state = walker.WalkRange(input.Buffer(), input.Length(), walker.GetStartState(), events);
+		benchmarkSink = benchmarkSink + state + events.Count();
+	});
+}
+
+void BenchmarkLexer(Benchmark& benchmark, const WString& source, const WString& json)
+{
+	List<WString> sourceTokens;
+	sourceTokens.Add(L"/d+(./d+)?");
+	sourceTokens.Add(L"[a-zA-Z_]/w*");
+	sourceTokens.Add(L"\"([^\"\\\\]|\\\\.)*\"");
+	sourceTokens.Add(L"///*([^*]|/*+[^*//])*/*+//");
+	sourceTokens.Add(L"[+/-*//=<>&|!;,(){}]+");
+	sourceTokens.Add(L"/s+");
+
+	List<WString> jsonTokens;
+	jsonTokens.Add(L"true|false|null");
+	jsonTokens.Add(L"-?/d+(./d+)?([eE][+/-]?/d+)?");
+	jsonTokens.Add(L"\"([^\"\\\\]|\\\\.)*\"");
+	jsonTokens.Add(L"[/[/]{}:,]");
+	jsonTokens.Add(L"/s+");
+
+	struct LexerCase
+	{
+		const wchar_t*							name;
+		List<WString>*							tokens;
+		const WString*							corpus;
+	};
+
+	LexerCase cases[] =
+	{
+		{ L"source", &sourceTokens, &source },
+		{ L"json", &jsonTokens, &json },
+	};
+
+	for (auto&& lexerCase : cases)
+	{
+		WString prefix = WString(L"RegexLexer/") + lexerCase.name;
+		benchmark.Run(prefix + L"/Construct", 0, [&]()
+		{
+			RegexLexer lexer(*lexerCase.tokens);
+			benchmarkSink = benchmarkSink + 1;
+		});
+
+		RegexLexer lexer(*lexerCase.tokens);
+		BenchmarkLexerOnCharType<wchar_t>(benchmark, prefix, lexer, *lexerCase.corpus);
+		BenchmarkLexerOnCharType<char8_t>(benchmark, prefix, lexer, *lexerCase.corpus);
+		BenchmarkLexerOnCharType<char16_t>(benchmark, prefix, lexer, *lexerCase.corpus);
+		BenchmarkLexerOnCharType<char32_t>(benchmark, prefix, lexer, *lexerCase.corpus);
+
+		benchmark.Run(prefix + L"/SerializeRoundTrip", 0, [&]()
+		{
+			MemoryStream stream;
+			lexer.Serialize(stream);
+			stream.SeekFromBegin(0);
+			RegexLexer loaded(stream);
+			benchmarkSink = benchmarkSink + 1;
+		});
+	}
+}
+
+/***********************************************************************
+Report
+***********************************************************************/
+
+void WriteJsonReport(const WString& path, const List<BenchmarkResult>& results)
+{
+	FileStream file(path, FileStream::WriteOnly);
+	Utf8Encoder encoder;
+	EncoderStream output(file, encoder);
+	StreamWriter writer(output);
+
+	writer.WriteLine(L"{");
+	writer.WriteLine(L"  \"unit\": \"ns\",");
+	writer.WriteLine(L"  \"benchmarks\": [");
+	for (auto [result, index] : indexed(results))
+	{
+		writer.WriteLine(
+			L"    { \"name\": \"" + result.name +
+			L"\", \"iterations\": " + itow(result.iterations) +
+			L", \"bytes\": " + itow(result.bytes) +
+			L", \"median\": " + ftow(result.median) +
+			L", \"mean\": " + ftow(result.mean) +
+			L", \"stddev\": " + ftow(result.stddev) +
+			L", \"min\": " + ftow(result.min) +
+			(index + 1 == results.Count() ? L" }" : L" },"));
+	}
+	writer.WriteLine(L"  ]");
+	writer.WriteLine(L"}");
+}
+
+int main(int argc, char* argv[])
+{
+	// Benchmark [filter] [json-path]
+	// the default path is Test/Output when running in Test/Linux/Benchmark or Test/UnitTest/Benchmark
+	WString filter = argc > 1 ? atow(argv[1]) : WString::Empty;
+	WString jsonPath = argc > 2 ? atow(argv[2]) : WString(L"../../Output/Benchmark.json");
+#ifndef NDEBUG
+	Console::WriteLine(L"Warning: the benchmark is not built with NDEBUG.");
+#endif
+
+	WString logs = GenerateLogCorpus(256 * 1024);
+	WString source = GenerateSourceCorpus(256 * 1024);
+	WString json = GenerateJsonCorpus(256 * 1024);
+
+	{
+		Benchmark benchmark(filter);
+		BenchmarkRegex(benchmark, logs, source, json);
+		BenchmarkLexer(benchmark, source, json);
+		WriteJsonReport(jsonPath, benchmark.GetResults());
+		Console::WriteLine(L"Results are written to " + jsonPath);
+	}
+	FinalizeGlobalStorage();
+	return 0;
+}
@@ -0,0 +1,243 @@
+﻿/***********************************************************************
+This file is generated by RegexLexer::GenerateCpp, DO NOT MODIFY
+***********************************************************************/
+
+#ifndef VCZH_REGEX_GENERATED_GENERATEDLEXER
+#define VCZH_REGEX_GENERATED_GENERATEDLEXER
+
+#include "../../../Source/Regex/Regex.h"
+
+class GeneratedLexer
+{
+public:
+	static constexpr vl::vint StateCount = 22;
+	static constexpr vl::vint CharSetCount = 24;
+	static constexpr vl::vint StartState = 0;
+
+	// char set -> { begin, end }
+	static constexpr char32_t CharRanges[CharSetCount][2] = {
+		{ 1, 8 },
+		{ 9, 9 },
+		{ 10, 10 },
+		{ 11, 12 },
+		{ 13, 13 },
+		{ 14, 31 },
+		{ 32, 32 },
+		{ 33, 33 },
+		{ 34, 34 },
+		{ 35, 41 },
+		{ 42, 42 },
+		{ 43, 45 },
+		{ 46, 46 },
+		{ 47, 47 },
+		{ 48, 57 },
+		{ 58, 64 },
+		{ 65, 90 },
+		{ 91, 91 },
+		{ 92, 92 },
+		{ 93, 94 },
+		{ 95, 95 },
+		{ 96, 96 },
+		{ 97, 122 },
+		{ 123, 1114111 },
+	};
+
+	// (state, char set) -> state
+	static constexpr vl::vint Transitions[StateCount][CharSetCount] = {
+		{ -1, 2, 2, -1, 2, -1, 2, -1, 4, -1, -1, -1, -1, 5, 1, -1, 3, -1, -1, -1, 3, -1, 3, -1 },
+		{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 7, -1, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+		{ -1, 8, 8, -1, 8, -1, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+		{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 9, -1, 9, -1, -1, -1, 9, -1, 9, -1 },
+		{ 10, 10, 10, 10, 10, 10, 10, 10, 12, 10, 10, 10, 10, 10, 10, 10, 10, 10, 11, 10, 10, 10, 10, 10 },
+		{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+		{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 7, -1, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+		{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+		{ -1, 8, 8, -1, 8, -1, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+		{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 9, -1, 9, -1, -1, -1, 9, -1, 9, -1 },
+		{ 10, 10, 10, 10, 10, 10, 10, 10, 12, 10, 10, 10, 10, 10, 10, 10, 10, 10, 11, 10, 10, 10, 10, 10 },
+		{ 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15 },
+		{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+		{ 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 17, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16 },
+		{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 18, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+		{ 10, 10, 10, 10, 10, 10, 10, 10, 12, 10, 10, 10, 10, 10, 10, 10, 10, 10, 11, 10, 10, 10, 10, 10 },
+		{ 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 17, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16 },
+		{ 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 19, 20, 20, 21, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20 },
+		{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 18, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+		{ 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 19, 20, 20, 21, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20 },
+		{ 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 17, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16 },
+		{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	};
+
+	// state -> token, -1 for non-final states
+	static constexpr vl::vint StateTokens[StateCount] = {
+		-1,
+		0,
+		1,
+		2,
+		-1,
+		-1,
+		0,
+		-1,
+		1,
+		2,
+		-1,
+		-1,
+		3,
+		-1,
+		0,
+		-1,
+		-1,
+		-1,
+		0,
+		-1,
+		-1,
+		4,
+	};
+
+	// state -> token of the related final state, which is the token of an incomplete token ending at this state
+	static constexpr vl::vint RelatedStateTokens[StateCount] = {
+		1,
+		0,
+		1,
+		2,
+		3,
+		4,
+		0,
+		0,
+		1,
+		2,
+		3,
+		3,
+		3,
+		4,
+		0,
+		3,
+		4,
+		4,
+		0,
+		4,
+		4,
+		4,
+	};
+
+	static constexpr vl::vint GetCharSet(char32_t c)
+	{
+		vl::vint start = 0;
+		vl::vint end = CharSetCount - 1;
+		while (start <= end)
+		{
+			vl::vint middle = (start + end) / 2;
+			if (c < CharRanges[middle][0]) end = middle - 1;
+			else if (c > CharRanges[middle][1]) start = middle + 1;
+			else return middle;
+		}
+		return -1;
+	}
+
+	// find the longest token at the beginning of the input
+	// when it fails, token is the token of an incomplete token ending at length, or -1
+	template<typename T>
+	static bool MatchHead(const T* input, vl::vint& length, vl::vint& token)
+	{
+		vl::encoding::UtfStringToStringReader<T, char32_t> reader(input);
+		vl::vint state = StartState;
+		vl::vint terminateState = -1;
+		vl::vint terminateLength = -1;
+		length = -1;
+		token = -1;
+
+		while (state != -1)
+		{
+			auto c = reader.Read();
+			terminateState = state;
+			terminateLength = reader.SourceCluster().index;
+			if (StateTokens[state] != -1)
+			{
+				length = terminateLength;
+				token = StateTokens[state];
+			}
+
+			if (!c) break;
+			vl::vint charSet = GetCharSet(c);
+			state = charSet == -1 ? -1 : Transitions[state][charSet];
+		}
+
+		if (token != -1) return true;
+		length = terminateLength;
+		if (terminateLength > 0) token = RelatedStateTokens[terminateState];
+		return false;
+	}
+
+	// tokenize the input in the same way as RegexLexer::Parse without any callback
+	template<typename T>
+	static void Parse(const T* code, vl::collections::List<vl::regex::RegexToken_<T>>& tokens, vl::vint codeIndex = -1)
+	{
+		const T* reading = code;
+		vl::vint rowStart = 0;
+		vl::vint columnStart = 0;
+		vl::regex::RegexToken_<T> token;
+		token.token = -2;
+
+		auto addToken = [&]()
+		{
+			token.rowStart = rowStart;
+			token.columnStart = columnStart;
+			token.rowEnd = rowStart;
+			token.columnEnd = columnStart;
+			for (vl::vint i = 0; i < token.length; i++)
+			{
+				token.rowEnd = rowStart;
+				token.columnEnd = columnStart;
+				if (token.reading[i] == '\n')
+				{
+					rowStart++;
+					columnStart = 0;
+				}
+				else
+				{
+					columnStart++;
+				}
+			}
+			tokens.Add(token);
+		};
+
+		while (*reading)
+		{
+			vl::vint length = -1;
+			vl::vint id = -1;
+			bool completeToken = true;
+			if (!MatchHead(reading, length, id))
+			{
+				if (id == -1)
+				{
+					vl::encoding::UtfStringToStringReader<T, char32_t> reader(reading);
+					reader.Read();
+					length = reader.SourceCluster().size;
+				}
+				else
+				{
+					completeToken = false;
+				}
+			}
+
+			if (token.token == -1 && id == -1)
+			{
+				token.length += length;
+			}
+			else
+			{
+				if (token.token != -2) addToken();
+				token.reading = reading;
+				token.start = reading - code;
+				token.length = length;
+				token.token = id;
+				token.codeIndex = codeIndex;
+				token.completeToken = completeToken;
+			}
+			reading += length;
+		}
+		if (token.token != -2) addToken();
+	}
+};
+
+#endif
@@ -0,0 +1,125 @@
+﻿/***********************************************************************
+This file is generated by Regex::GenerateCpp, DO NOT MODIFY
+***********************************************************************/
+
+#ifndef VCZH_REGEX_GENERATED_GENERATEDREGEX
+#define VCZH_REGEX_GENERATED_GENERATEDREGEX
+
+#include "../../../Source/Regex/Regex.h"
+
+class GeneratedRegex
+{
+public:
+	static constexpr vl::vint StateCount = 13;
+	static constexpr vl::vint CharSetCount = 6;
+	static constexpr vl::vint StartState = 0;
+
+	// char set -> { begin, end }
+	static constexpr char32_t CharRanges[CharSetCount][2] = {
+		{ 43, 43 },
+		{ 45, 45 },
+		{ 46, 46 },
+		{ 48, 57 },
+		{ 69, 69 },
+		{ 101, 101 },
+	};
+
+	// (state, char set) -> state
+	static constexpr vl::vint Transitions[StateCount][CharSetCount] = {
+		{ 1, 2, -1, 3, -1, -1 },
+		{ -1, -1, -1, 3, -1, -1 },
+		{ -1, -1, -1, 3, -1, -1 },
+		{ -1, -1, 5, 4, 6, 6 },
+		{ -1, -1, 5, 4, 6, 6 },
+		{ -1, -1, -1, 7, -1, -1 },
+		{ 8, 9, -1, 10, -1, -1 },
+		{ -1, -1, -1, 11, 6, 6 },
+		{ -1, -1, -1, 10, -1, -1 },
+		{ -1, -1, -1, 10, -1, -1 },
+		{ -1, -1, -1, 12, -1, -1 },
+		{ -1, -1, -1, 11, 6, 6 },
+		{ -1, -1, -1, 12, -1, -1 },
+	};
+
+	// state -> final
+	static constexpr bool FinalStates[StateCount] = {
+		false,
+		false,
+		false,
+		true,
+		true,
+		false,
+		false,
+		true,
+		false,
+		false,
+		true,
+		true,
+		true,
+	};
+
+	static constexpr vl::vint GetCharSet(char32_t c)
+	{
+		vl::vint start = 0;
+		vl::vint end = CharSetCount - 1;
+		while (start <= end)
+		{
+			vl::vint middle = (start + end) / 2;
+			if (c < CharRanges[middle][0]) end = middle - 1;
+			else if (c > CharRanges[middle][1]) start = middle + 1;
+			else return middle;
+		}
+		return -1;
+	}
+
+	// find the longest match at the beginning of the input
+	template<typename T>
+	static bool MatchHead(const T* input, vl::vint& length)
+	{
+		vl::encoding::UtfStringToStringReader<T, char32_t> reader(input);
+		vl::vint state = StartState;
+		length = -1;
+
+		while (state != -1)
+		{
+			auto c = reader.Read();
+			if (FinalStates[state]) length = reader.SourceCluster().index;
+			if (!c) break;
+			vl::vint charSet = GetCharSet(c);
+			state = charSet == -1 ? -1 : Transitions[state][charSet];
+		}
+		return length != -1;
+	}
+
+	// find the first match in the input
+	template<typename T>
+	static bool Match(const T* input, vl::vint& start, vl::vint& length)
+	{
+		vl::encoding::UtfStringToStringReader<T, char32_t> reader(input);
+		while (reader.Read())
+		{
+			start = reader.SourceCluster().index;
+			if (MatchHead(input + start, length)) return true;
+		}
+		start = -1;
+		length = -1;
+		return false;
+	}
+
+	template<typename T>
+	static bool TestHead(const T* input)
+	{
+		vl::vint length = -1;
+		return MatchHead(input, length);
+	}
+
+	template<typename T>
+	static bool Test(const T* input)
+	{
+		vl::vint start = -1;
+		vl::vint length = -1;
+		return Match(input, start, length);
+	}
+};
+
+#endif
@@ -1,4 +1,5 @@
 ﻿#include "../../Source/Regex/AST/RegexWriter.h"
+#include "../../Source/Regex/RegexRich.h"
 #include <VlppOS.h>
 
 using namespace vl;
@@ -97,6 +98,17 @@ void PrintAutomaton(WString fileName, Ptr<Automaton> automaton)
 	}
 }
 
+void PrintRichProgram(WString fileName, Ptr<Automaton> automaton)
+{
+	FileStream file(GetTestOutputPath() + fileName, FileStream::WriteOnly);
+	BomEncoder encoder(BomEncoder::Utf8);
+	EncoderStream output(file, encoder);
+	StreamWriter writer(output);
+
+	RichInterpretor interpretor(automaton);
+	writer.WriteString(interpretor.Dump());
+}
+
 void CompareToBaseline(WString fileName)
 {
 	File generatedFile = FilePath(GetTestOutputPath()) / fileName;
@@ -153,9 +165,11 @@ void PrintRegex(bool pure, WString name, U32String code)
 
 			PrintAutomaton(name + L".richNfa.txt", nfa);
 			PrintAutomaton(name + L".richDfa.txt", dfa);
+			PrintRichProgram(name + L".richProgram.txt", dfa);
 
 			CompareToBaseline(name + L".richNfa.txt");
 			CompareToBaseline(name + L".richDfa.txt");
+			CompareToBaseline(name + L".richProgram.txt");
 		}
 	});
 }
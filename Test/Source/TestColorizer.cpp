@@ -338,6 +338,269 @@ TEST_FILE
 		}
 	});
 
+	TEST_CASE(L"Test RegexLexerColorizer with a callable object")
+	{
+		List<WString> codes;
+		codes.Add(L"/d+(./d+)?");
+		codes.Add(L"[a-zA-Z_]/w*");
+		codes.Add(L"\"[^\"]*\"");
+
+		vint colors[100];
+		vint calls = 0;
+		auto colorize = [&](vint start, vint length, vint token)
+		{
+			calls++;
+			for (vint i = 0; i < length; i++)
+			{
+				colors[start + i] = token;
+			}
+		};
+
+		RegexProc proc;
+		RegexLexer lexer(codes);
+		RegexLexerColorizer colorizer = lexer.Colorize(proc);
+
+		{
+			const wchar_t input[] = L" genius 10..10.10   \"a";
+			vint expect[] = { -1, 1, 1, 1, 1, 1, 1, -1, 0, 0, -1, -1, 0, 0, 0, 0, 0, -1, -1, -1, 2, 2 };
+			vint expectCount = sizeof(expect) / sizeof(*expect);
+			TEST_ASSERT(colorizer.Colorize(input, expectCount, colorize) == nullptr);
+			TEST_ASSERT(calls == 11);
+			for (vint i = 0; i < expectCount; i++)
+			{
+				TEST_ASSERT(colors[i] == expect[i]);
+			}
+		}
+		colorizer.Pass(L'\r');
+		colorizer.Pass(L'\n');
+		{
+			const wchar_t input[] = L"b\"\"genius\"";
+			vint expect[] = { 2, 2, 2, 2, 2, 2, 2, 2, 2, 2 };
+			vint expectCount = sizeof(expect) / sizeof(*expect);
+			TEST_ASSERT(colorizer.Colorize(input, expectCount, colorize) == nullptr);
+			for (vint i = 0; i < expectCount; i++)
+			{
+				TEST_ASSERT(colors[i] == expect[i]);
+			}
+		}
+	});
+
+	TEST_CASE(L"Test RegexLexerColorizer with spans and token buffers")
+	{
+		List<WString> codes;
+		codes.Add(L"/d+(./d+)?");
+		codes.Add(L"[a-zA-Z_]/w*");
+		codes.Add(L"\"[^\"]*\"");
+
+		RegexProc proc;
+		RegexLexer lexer(codes);
+		const wchar_t input[] = L" genius 10..10.10   \"a";
+		vint length = sizeof(input) / sizeof(*input) - 1;
+		RegexColorizeSpan expect[] =
+		{
+			{ 0, 1, -1 },
+			{ 1, 6, 1 },
+			{ 7, 1, -1 },
+			{ 8, 2, 0 },
+			{ 10, 2, -1 },
+			{ 12, 5, 0 },
+			{ 17, 3, -1 },
+			{ 20, 2, 2 },
+		};
+		vint expectCount = sizeof(expect) / sizeof(*expect);
+
+		{
+			RegexColorizeSpan spans[100];
+			auto colorizer = lexer.Colorize(proc);
+			TEST_ASSERT(colorizer.ColorizeSpans(input, length, spans, 100) == expectCount);
+			for (vint i = 0; i < expectCount; i++)
+			{
+				TEST_ASSERT(spans[i].start == expect[i].start);
+				TEST_ASSERT(spans[i].length == expect[i].length);
+				TEST_ASSERT(spans[i].token == expect[i].token);
+			}
+		}
+		{
+			RegexColorizeSpan spans[5];
+			spans[4].start = 100;
+			auto colorizer = lexer.Colorize(proc);
+			TEST_ASSERT(colorizer.ColorizeSpans(input, length, spans, 4) == expectCount);
+			for (vint i = 0; i < 4; i++)
+			{
+				TEST_ASSERT(spans[i].start == expect[i].start);
+				TEST_ASSERT(spans[i].length == expect[i].length);
+				TEST_ASSERT(spans[i].token == expect[i].token);
+			}
+			TEST_ASSERT(spans[4].start == 100);
+		}
+		{
+			vuint16_t tokens[100];
+			auto colorizer = lexer.Colorize(proc);
+			TEST_ASSERT(colorizer.ColorizeTokens(input, length, tokens) == expectCount);
+			for (vint i = 0; i < expectCount; i++)
+			{
+				for (vint j = 0; j < expect[i].length; j++)
+				{
+					TEST_ASSERT(tokens[expect[i].start + j] == (vuint16_t)expect[i].token);
+				}
+			}
+		}
+	});
+
+	TEST_CATEGORY(L"Test RegexDocumentColorizer")
+	{
+		List<WString> codes;
+		codes.Add(L"/d+");
+		codes.Add(L"[a-zA-Z_]/w*");
+		codes.Add(L"/s+");
+		codes.Add(L"///*([^*]|/*+[^*//])*/*+//");
+
+		vint colors[100];
+		RegexProc proc;
+		proc.colorizeProc = &ColorizerProc;
+		proc.argument = colors;
+		RegexLexer lexer(codes);
+
+		auto readLine = [](void* argument, vint line, vint& length)
+		{
+			auto&& lines = *(List<WString>*)argument;
+			length = lines[line].Length();
+			return lines[line].Buffer();
+		};
+
+		auto assertDocument = [&](RegexDocumentColorizer& document, List<WString>& lines)
+		{
+			TEST_ASSERT(document.GetLineCount() == lines.Count());
+			TEST_ASSERT(document.GetFirstDirtyLine() == -1);
+			auto colorizer = lexer.Colorize(proc);
+			for (vint i = 0; i < lines.Count(); i++)
+			{
+				TEST_ASSERT(document.GetLineColorizer(i).GetInternalState() == colorizer.GetInternalState());
+				colorizer.Colorize(lines[i].Buffer(), lines[i].Length());
+			}
+			TEST_ASSERT(document.GetLineColorizer(lines.Count()).GetInternalState() == colorizer.GetInternalState());
+		};
+
+		TEST_CASE(L"Walking stops when a line ends in the same state")
+		{
+			List<WString> lines;
+			for (vint i = 0; i < 100; i++)
+			{
+				lines.Add(L"abc 123\n");
+			}
+			auto document = lexer.ColorizeDocument(proc);
+			document.InsertLines(0, lines.Count());
+			TEST_ASSERT(document.Update(lines.Count(), readLine, &lines) == 100);
+			assertDocument(document, lines);
+
+			lines[50] = L"xyz 45\n";
+			document.EditLine(50);
+			TEST_ASSERT(document.Update(lines.Count(), readLine, &lines) == 1);
+			assertDocument(document, lines);
+
+			lines[10] = L"abc /* 123\n";
+			document.EditLine(10);
+			TEST_ASSERT(document.Update(20, readLine, &lines) == 10);
+			TEST_ASSERT(document.GetFirstDirtyLine() == 20);
+			TEST_ASSERT(document.Update(lines.Count(), readLine, &lines) == 80);
+			assertDocument(document, lines);
+
+			lines.Insert(13, L"comment\n");
+			document.InsertLines(13, 1);
+			TEST_ASSERT(document.Update(lines.Count(), readLine, &lines) == 1);
+			assertDocument(document, lines);
+
+			lines.Insert(13, L"*/\n");
+			document.InsertLines(13, 1);
+			TEST_ASSERT(document.Update(lines.Count(), readLine, &lines) == 89);
+			assertDocument(document, lines);
+
+			lines.RemoveAt(13);
+			document.RemoveLines(13, 1);
+			TEST_ASSERT(document.Update(lines.Count(), readLine, &lines) == 88);
+			assertDocument(document, lines);
+		});
+
+		TEST_CASE(L"Colorizing lines updates states")
+		{
+			List<WString> lines;
+			lines.Add(L"/* a\n");
+			lines.Add(L"b */ c\n");
+			lines.Add(L"12");
+			auto document = lexer.ColorizeDocument(proc);
+			document.InsertLines(0, lines.Count());
+			for (vint i = 0; i < lines.Count(); i++)
+			{
+				TEST_ASSERT(document.GetFirstDirtyLine() == i);
+				document.ColorizeLine(i, lines[i].Buffer(), lines[i].Length());
+			}
+			TEST_ASSERT(colors[0] == 0 && colors[1] == 0);
+			assertDocument(document, lines);
+
+			document.ColorizeLine(1, lines[1].Buffer(), lines[1].Length());
+			TEST_ASSERT(colors[0] == 3 && colors[3] == 3 && colors[4] == 2 && colors[5] == 1);
+		});
+
+		TEST_CASE(L"Random edits")
+		{
+			const wchar_t* pieces[] = { L"a", L"1", L" ", L"/*", L"*/", L"*", L"/", L"#" };
+			vuint32_t seed = 20261018;
+			auto random = [&](vint max)
+			{
+				seed = seed * 1103515245 + 12345;
+				return (vint)((seed >> 8) % (vuint32_t)max);
+			};
+			auto randomLine = [&]()
+			{
+				WString line;
+				vint count = random(4);
+				for (vint i = 0; i < count; i++)
+				{
+					line += pieces[random(sizeof(pieces) / sizeof(*pieces))];
+				}
+				return line + L"\n";
+			};
+
+			List<WString> lines;
+			auto document = lexer.ColorizeDocument(proc);
+			for (vint i = 0; i < 500; i++)
+			{
+				switch (lines.Count() == 0 ? 1 : random(3))
+				{
+				case 0:
+					{
+						vint line = random(lines.Count());
+						lines[line] = randomLine();
+						document.EditLine(line);
+					}
+					break;
+				case 1:
+					{
+						vint line = random(lines.Count() + 1);
+						vint count = random(3) + 1;
+						for (vint j = 0; j < count; j++)
+						{
+							lines.Insert(line, randomLine());
+						}
+						document.InsertLines(line, count);
+					}
+					break;
+				default:
+					{
+						vint line = random(lines.Count());
+						vint count = random(lines.Count() - line) + 1;
+						if (count > 3) count = 3;
+						lines.RemoveRange(line, count);
+						document.RemoveLines(line, count);
+					}
+				}
+
+				document.Update(lines.Count(), readLine, &lines);
+				assertDocument(document, lines);
+			}
+		});
+	});
+
 	TEST_CASE(L"Test RegexLexerColorizer with Unicode scalars")
 	{
 		List<WString> wordCodes;
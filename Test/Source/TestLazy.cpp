@@ -0,0 +1,193 @@
+﻿#include <VlppOS.h>
+#include "../../Source/Regex/AST/RegexExpression.h"
+#include "../../Source/Regex/RegexPure.h"
+#include "../../Source/Regex/RegexLazy.h"
+
+using namespace vl;
+using namespace vl::collections;
+using namespace vl::regex_internal;
+
+namespace TestLazy_TestObjects
+{
+	Ptr<LazyInterpretor> BuildLazyInterpretor(const char32_t* code, vint maxStateCount)
+	{
+		CharRange::List subsets;
+		Dictionary<State*, State*> nfaStateMap;
+
+		auto regex = ParseRegexExpression(code);
+		auto expression = regex->Merge();
+		expression->NormalizeCharSet(subsets);
+		auto eNfa = expression->GenerateEpsilonNfa();
+		auto nfa = EpsilonNfaToNfa(eNfa, PureEpsilonChecker, nfaStateMap);
+		return Ptr(new LazyInterpretor(nfa, subsets, maxStateCount));
+	}
+
+	Ptr<PureInterpretor> BuildPureInterpretor(const char32_t* code)
+	{
+		CharRange::List subsets;
+		Dictionary<State*, State*> nfaStateMap;
+		Group<State*, State*> dfaStateMap;
+
+		auto regex = ParseRegexExpression(code);
+		auto expression = regex->Merge();
+		expression->NormalizeCharSet(subsets);
+		auto eNfa = expression->GenerateEpsilonNfa();
+		auto nfa = EpsilonNfaToNfa(eNfa, PureEpsilonChecker, nfaStateMap);
+		auto dfa = NfaToDfa(nfa, dfaStateMap);
+		return Ptr(new PureInterpretor(dfa, subsets));
+	}
+
+	WString BuildBoundedCacheInput(vint& expectedLength)
+	{
+		// the input for (/.*a/.{20}), expectedLength is the length of the longest match from the beginning
+		WString input;
+		expectedLength = -1;
+		for (vint i = 0; i < 1000; i++)
+		{
+			bool a = i % 7 == 0 || i % 11 == 0;
+			input += a ? L"a" : L"b";
+			if (a && i + 21 <= 1000)
+			{
+				expectedLength = i + 21;
+			}
+		}
+		return input;
+	}
+
+	void RunLazyInterpretor(const char32_t* code, const wchar_t* input)
+	{
+		TEST_CASE(u32tow(code) + WString(L" on ") + input)
+		{
+			auto pure = BuildPureInterpretor(code);
+			PureResult expected;
+			bool expectedSuccessful = pure->Match(input, input, expected);
+
+			vint maxStateCounts[] = { LazyInterpretor::DefaultMaxStateCount, 4, 1 };
+			for (auto maxStateCount : maxStateCounts)
+			{
+				auto lazy = BuildLazyInterpretor(code, maxStateCount);
+				for (vint i = 0; i < 2; i++)
+				{
+					PureResult actual;
+					TEST_ASSERT(lazy->Match(input, input, actual) == expectedSuccessful);
+					if (expectedSuccessful)
+					{
+						TEST_ASSERT(actual.start == expected.start);
+						TEST_ASSERT(actual.length == expected.length);
+					}
+					TEST_ASSERT(lazy->GetCachedStateCount() <= maxStateCount + 1);
+				}
+			}
+		});
+	}
+}
+using namespace TestLazy_TestObjects;
+
+TEST_FILE
+{
+	TEST_CATEGORY(L"Lazy interpretor")
+	{
+		RunLazyInterpretor(U"/d", L"abcde12345abcde");
+		RunLazyInterpretor(U"/d", L"vczh");
+		RunLazyInterpretor(U"(/+|-)?/d+(./d+)?", L"abcde-12345.54321abcde");
+		RunLazyInterpretor(U"(/+|-)?/d+(./d+)?", L"-+vczh+-");
+		RunLazyInterpretor(U"\"([^\\\\\"]|\\\\\\.)*\"", L"vczh\"i\\r\\ns\"genius");
+		RunLazyInterpretor(U"///*([^*]|/*+[^*//])*/*+//", L"vczh/***is***/genius");
+		RunLazyInterpretor(U"(a|b)*abb", L"abababbabb");
+		RunLazyInterpretor(U"x*", L"abc");
+		RunLazyInterpretor(U"(/.*a/.{5})", L"bbbbabbbbbbbabbbbbbaaaaaaaabbbbbbbbbbbbbb");
+		RunLazyInterpretor(U"(/.*a/.{5})", L"bbbbbbbbbbbbbbbbbbbbbbbbba");
+	});
+
+	TEST_CATEGORY(L"Bounded cache")
+	{
+		TEST_CASE(L"(/.*a/.{20}) with a small cache")
+		{
+			// the complete DFA has more than 2^20 states
+			auto lazy = BuildLazyInterpretor(U"(/.*a/.{20})", 64);
+			vint expectedLength = -1;
+			auto input = BuildBoundedCacheInput(expectedLength);
+
+			for (vint i = 0; i < 2; i++)
+			{
+				PureResult result;
+				TEST_ASSERT(lazy->MatchHead(input.Buffer(), input.Buffer(), result) == true);
+				TEST_ASSERT(result.start == 0);
+				TEST_ASSERT(result.length == expectedLength);
+				TEST_ASSERT(lazy->GetCachedStateCount() <= 65);
+			}
+		});
+	});
+
+	TEST_CATEGORY(L"Concurrent matching")
+	{
+		TEST_CASE(L"(/.*a/.{20}) with a small cache from multiple threads")
+		{
+			// only one call owns the cache, other calls simulate the NFA
+			auto lazy = BuildLazyInterpretor(U"(/.*a/.{20})", 64);
+			vint expectedLength = -1;
+			auto input = BuildBoundedCacheInput(expectedLength);
+
+			const vint threadCount = 4;
+			atomic_vint failures = 0;
+			Thread* threads[threadCount];
+			for (vint i = 0; i < threadCount; i++)
+			{
+				threads[i] = Thread::CreateAndStart([&]()
+				{
+					for (vint j = 0; j < 20; j++)
+					{
+						PureResult result;
+						bool found = j % 2 == 0
+							? lazy->MatchHead(input.Buffer(), input.Buffer(), result)
+							: lazy->Match(input.Buffer(), input.Buffer(), result);
+						if (!found || result.start != 0 || result.length != expectedLength)
+						{
+							failures++;
+						}
+					}
+				}, false);
+			}
+
+			for (auto thread : threads)
+			{
+				thread->Wait();
+				delete thread;
+			}
+			TEST_ASSERT(failures == 0);
+			TEST_ASSERT(lazy->GetCachedStateCount() <= 65);
+		});
+	});
+
+	TEST_CATEGORY(L"Unicode")
+	{
+		auto interpretor = BuildLazyInterpretor(U"[𣂕𣴑𣱳𦁚]+", LazyInterpretor::DefaultMaxStateCount);
+
+		TEST_CASE(L"char8_t")
+		{
+			auto input = u8"𩰪㦲𦰗𠀼 𣂕𣴑𣱳𦁚 Vczh is genius!@我是天才";
+			PureResult result;
+			interpretor->Match(input, input, result);
+			TEST_ASSERT(result.start == 16);
+			TEST_ASSERT(result.length == 16);
+		});
+
+		TEST_CASE(L"char16_t")
+		{
+			auto input = u"𩰪㦲𦰗𠀼 𣂕𣴑𣱳𦁚 Vczh is genius!@我是天才";
+			PureResult result;
+			interpretor->Match(input, input, result);
+			TEST_ASSERT(result.start == 8);
+			TEST_ASSERT(result.length == 8);
+		});
+
+		TEST_CASE(L"char32_t")
+		{
+			auto input = U"𩰪㦲𦰗𠀼 𣂕𣴑𣱳𦁚 Vczh is genius!@我是天才";
+			PureResult result;
+			interpretor->Match(input, input, result);
+			TEST_ASSERT(result.start == 5);
+			TEST_ASSERT(result.length == 4);
+		});
+	});
+}
@@ -1,11 +1,16 @@
 ﻿#include <VlppOS.h>
 #include "../../Source/Regex/Regex.h"
+#include "../Resources/Baseline/GeneratedLexer.h"
 
 using namespace vl;
 using namespace vl::collections;
 using namespace vl::stream;
+using namespace vl::filesystem;
 using namespace vl::regex;
 
+extern WString GetTestResourcePath();
+extern WString GetTestOutputPath();
+
 struct UnicodeLexerToken
 {
 	vint										start;
@@ -350,6 +355,71 @@ TEST_FILE
 		}
 	});
 
+	TEST_CASE(L"Test RegexLexer 2 (In-place Serialization)")
+	{
+		MemoryStream lexerStream;
+		{
+			List<WString> codes;
+			codes.Add(L"/d+");
+			codes.Add(L"[a-zA-Z_]/w*");
+			codes.Add(L"\"[^\"]*\"");
+			RegexLexer(codes).Serialize(lexerStream);
+		}
+
+		// an image is used in place, it must be aligned to 8 bytes like a mapped file
+		vint size = (vint)lexerStream.Size();
+		Array<vuint64_t> image((size + 7) / 8);
+		memcpy(&image[0], lexerStream.GetInternalBuffer(), size);
+		RegexLexer lexer(&image[0], size);
+
+		WString input =
+			L"12345vczh is a genius!"		L"\r\n"
+			L"67890\"vczh\"\"is\" \"a\"\"genius\"\"!\""		L"\r\n"
+			L"hey!";
+		{
+			List<RegexToken> tokens;
+			CopyFrom(tokens, lexer.Parse(input));
+			TestRegexLexer2Validation(tokens);
+		}
+
+		auto assertReason = [](RegexImageException::Reason reason)
+		{
+			return [=](const RegexImageException& e) { TEST_ASSERT(e.GetReason() == reason); };
+		};
+
+		// a damaged image is rejected
+		TEST_EXCEPTION(RegexLexer(&image[0], size - 8), RegexImageException, assertReason(RegexImageException::Reason::Truncated));
+		TEST_EXCEPTION(RegexLexer(&image[0], 16), RegexImageException, assertReason(RegexImageException::Reason::Truncated));
+
+		auto bytes = (vuint8_t*)&image[0];
+		bytes[size - 1] ^= 1;
+		TEST_EXCEPTION(RegexLexer(&image[0], size), RegexImageException, assertReason(RegexImageException::Reason::Checksum));
+		bytes[size - 1] ^= 1;
+
+		bytes[8] += 1;
+		TEST_EXCEPTION(RegexLexer(&image[0], size), RegexImageException, assertReason(RegexImageException::Reason::Version));
+		bytes[8] -= 1;
+
+		bytes[0] ^= 0xFF;
+		TEST_EXCEPTION(RegexLexer(&image[0], size), RegexImageException, assertReason(RegexImageException::Reason::NotAnImage));
+		bytes[0] ^= 0xFF;
+
+		{
+			MemoryStream truncatedStream;
+			truncatedStream.Write(&image[0], size / 2);
+			truncatedStream.SeekFromBegin(0);
+			TEST_EXCEPTION(RegexLexer{ truncatedStream }, RegexImageException, assertReason(RegexImageException::Reason::Truncated));
+		}
+
+		// the image is still valid after restoring all damages
+		RegexLexer restored(&image[0], size);
+		{
+			List<RegexToken> tokens;
+			CopyFrom(tokens, restored.Parse(input));
+			TestRegexLexer2Validation(tokens);
+		}
+	});
+
 	TEST_CASE(L"Test RegexLexer 3")
 	{
 		{
@@ -529,6 +599,50 @@ TEST_FILE
 		}
 	});
 
+	TEST_CATEGORY(L"Literal tokens")
+	{
+		TEST_CASE(L"Literal tokens mixed with regular expressions")
+		{
+			List<WString> codes;
+			codes.Add(L"if");
+			codes.Add(L"int");
+			codes.Add(L"i");
+			codes.Add(L"[a-zA-Z_]+");
+			codes.Add(L"in");
+			codes.Add(L"if");
+			codes.Add(L"/+");
+			codes.Add(L"/+/+");
+			codes.Add(L"/+=");
+			codes.Add(L"/s+");
+			codes.Add(L"/d");
+			RegexLexer lexer(codes);
+
+			UnicodeLexerToken expected[] = {
+				{ 0, 3, 1 },{ 3, 1, 9 },{ 4, 2, 0 },{ 6, 1, 9 },{ 7, 2, 3 },{ 9, 1, 9 },{ 10, 1, 2 },{ 11, 1, 9 },
+				{ 12, 9, 3 },{ 21, 1, 9 },{ 22, 2, 7 },{ 24, 1, 9 },{ 25, 2, 8 },{ 27, 1, 9 },{ 28, 1, 6 },{ 29, 1, 9 },
+				{ 30, 1, 10 },{ 31, 1, 3 },
+			};
+			AssertUnicodeLexer(lexer, WString(L"int if in i interface ++ += + 5x"), expected);
+		});
+
+		TEST_CASE(L"Many keywords")
+		{
+			List<WString> codes;
+			for (vint i = 0; i < 200; i++)
+			{
+				codes.Add(L"k" + itow(i));
+			}
+			codes.Add(L"[a-z][a-z0-9]*");
+			codes.Add(L"/s+");
+			RegexLexer lexer(codes);
+
+			UnicodeLexerToken expected[] = {
+				{ 0, 2, 5 },{ 2, 1, 201 },{ 3, 4, 150 },{ 7, 1, 201 },{ 8, 5, 200 },{ 13, 1, 201 },{ 14, 2, 200 },
+			};
+			AssertUnicodeLexer(lexer, WString(L"k5 k150 k1999 kx"), expected);
+		});
+	});
+
 	TEST_CATEGORY(L"Unicode")
 	{
 		List<U8String> codes;
@@ -769,4 +883,166 @@ TEST_FILE
 #endif
 		});
 	});
+
+	TEST_CATEGORY(L"Incremental tokenizing")
+	{
+		List<WString> codes;
+		codes.Add(L"/d+");
+		codes.Add(L"[a-zA-Z_]+");
+		codes.Add(L"/s+");
+		codes.Add(L"\"[^\"]*\"");
+		codes.Add(L"///*([^*]|/*+[^*//])*/*+//");
+		codes.Add(L"/+|/+/+|/+=");
+		RegexLexer lexer(codes);
+
+		auto assertSameTokens = [&](RegexIncrementalTokens& incremental)
+		{
+			List<RegexToken> expected;
+			CopyFrom(expected, lexer.Parse(incremental.GetCode()));
+			auto&& actual = incremental.GetTokens();
+			TEST_ASSERT(expected.Count() == actual.Count());
+			for (vint i = 0; i < expected.Count(); i++)
+			{
+				TEST_ASSERT(expected[i].start == actual[i].start);
+				TEST_ASSERT(expected[i].length == actual[i].length);
+				TEST_ASSERT(expected[i].token == actual[i].token);
+				TEST_ASSERT(expected[i].reading == actual[i].reading);
+				TEST_ASSERT(expected[i].completeToken == actual[i].completeToken);
+				TEST_ASSERT(expected[i].rowStart == actual[i].rowStart);
+				TEST_ASSERT(expected[i].columnStart == actual[i].columnStart);
+				TEST_ASSERT(expected[i].rowEnd == actual[i].rowEnd);
+				TEST_ASSERT(expected[i].columnEnd == actual[i].columnEnd);
+			}
+		};
+
+		TEST_CASE(L"Edits only tokenize nearby text")
+		{
+			WString line = L"abc 123 \"text\" ++ x += /* comment */ y\r\n";
+			WString code;
+			for (vint i = 0; i < 100; i++)
+			{
+				code += line;
+			}
+			auto incremental = lexer.ParseIncrementally(code);
+			assertSameTokens(incremental);
+
+			vint editStart = line.Length() * 50 + 4;
+			code = code.Left(editStart) + L"45" + code.Right(code.Length() - editStart - 3);
+			// the space before the edit is tokenized again because the DFA reads "1" to stop
+			TEST_ASSERT(incremental.Edit(code, editStart, 3, 2) == 2);
+			assertSameTokens(incremental);
+
+			editStart = line.Length() * 20 + 8;
+			code = code.Left(editStart) + L"/*" + code.Right(code.Length() - editStart);
+			// the new comment ends at the next "*/" in the same line
+			TEST_ASSERT(incremental.Edit(code, editStart, 0, 2) < 20);
+			assertSameTokens(incremental);
+
+			code = code.Left(editStart) + code.Right(code.Length() - editStart - 2);
+			TEST_ASSERT(incremental.Edit(code, editStart, 2, 0) < 20);
+			assertSameTokens(incremental);
+		});
+
+		TEST_CASE(L"Random edits")
+		{
+			const wchar_t* pieces[] = { L"a", L"b1", L"1", L" ", L"\r\n", L"\"", L"/*", L"*/", L"*", L"/", L"+", L"=", L"#" };
+			vuint32_t seed = 20261018;
+			auto random = [&](vint max)
+			{
+				seed = seed * 1103515245 + 12345;
+				return (vint)((seed >> 8) % (vuint32_t)max);
+			};
+
+			WString code;
+			auto incremental = lexer.ParseIncrementally(code);
+			for (vint i = 0; i < 1000; i++)
+			{
+				vint editStart = random(code.Length() + 1);
+				vint removedLength = random(code.Length() - editStart + 1);
+				if (removedLength > 4) removedLength = random(5);
+				WString inserted;
+				vint insertedCount = random(4);
+				for (vint j = 0; j < insertedCount; j++)
+				{
+					inserted += pieces[random(sizeof(pieces) / sizeof(*pieces))];
+				}
+
+				code = code.Left(editStart) + inserted + code.Right(code.Length() - editStart - removedLength);
+				incremental.Edit(code, editStart, removedLength, inserted.Length());
+				assertSameTokens(incremental);
+			}
+		});
+	});
+
+	TEST_CASE(L"Test RegexLexer code generation")
+	{
+		List<WString> codes;
+		codes.Add(L"/d+(./d+)?");
+		codes.Add(L"/s+");
+		codes.Add(L"[a-zA-Z_]/w*");
+		codes.Add(L"\"([^\\\\\"]|\\\\/.)*\"");
+		codes.Add(L"///*([^*]|/*+[^*//])*/*+//");
+		RegexLexer lexer(codes);
+
+		WString generated = GenerateToStream([&](StreamWriter& writer)
+		{
+			lexer.GenerateCpp(writer, L"GeneratedLexer", L"../../../Source/Regex/Regex.h");
+		});
+		{
+			FileStream file(GetTestOutputPath() + L"GeneratedLexer.h", FileStream::WriteOnly);
+			BomEncoder encoder(BomEncoder::Utf8);
+			EncoderStream output(file, encoder);
+			StreamWriter writer(output);
+			writer.WriteString(generated);
+		}
+
+		List<WString> generatedLines, baselineLines;
+		File(FilePath(GetTestOutputPath()) / L"GeneratedLexer.h").ReadAllLinesByBom(generatedLines);
+		File(FilePath(GetTestResourcePath()) / L"Baseline" / L"GeneratedLexer.h").ReadAllLinesByBom(baselineLines);
+		TEST_ASSERT(CompareEnumerable(generatedLines, baselineLines) == 0);
+
+		// GeneratedLexer.h is the same baseline, produced from this lexer
+		auto assertGeneratedLexer = [&]<typename T>(const ObjectString<T>& input)
+		{
+			List<RegexToken_<T>> expected, actual;
+			CopyFrom(expected, lexer.Parse(input, {}, 1));
+			GeneratedLexer::Parse(input.Buffer(), actual, 1);
+			TEST_ASSERT(expected.Count() == actual.Count());
+			for (vint i = 0; i < expected.Count(); i++)
+			{
+				auto&& e = expected[i];
+				auto&& a = actual[i];
+				TEST_ASSERT(e.start == a.start && e.length == a.length && e.token == a.token && e.reading == a.reading);
+				TEST_ASSERT(e.codeIndex == a.codeIndex && e.completeToken == a.completeToken);
+				TEST_ASSERT(e.rowStart == a.rowStart && e.columnStart == a.columnStart && e.rowEnd == a.rowEnd && e.columnEnd == a.columnEnd);
+			}
+		};
+
+		assertGeneratedLexer(WString(L"vczh is$$a&&genius  1234"));
+		assertGeneratedLexer(WString(L"x = 3.14\n\"a\\\"bc\" /* comment */ y\r\n$"));
+		assertGeneratedLexer(WString(L"\"unterminated"));
+		assertGeneratedLexer(WString(L"1.\n2 /* open"));
+		assertGeneratedLexer(WString(L"𩰪㦲𦰗𠀼 𣂕𣴑𣱳𦁚 Vczh is genius!@我是天才"));
+		assertGeneratedLexer(U8String(u8"x = \"𣂕\" 3.14 𩰪"));
+		assertGeneratedLexer(U16String(u"x = \"𣂕\" 3.14 𩰪"));
+		assertGeneratedLexer(U32String(U"x = \"𣂕\" 3.14 𩰪"));
+	});
+
+	TEST_CASE(L"Test RegexLexer with a DFA state limit")
+	{
+		List<WString> codes;
+		codes.Add(L"/d+");
+		codes.Add(L"/.*a/.{12}");
+		TEST_EXCEPTION(RegexLexer(codes, 64), RegexLimitException, [](const RegexLimitException& e)
+		{
+			TEST_ASSERT(e.GetMaxStateCount() == 64);
+		});
+
+		codes.RemoveAt(1);
+		RegexLexer lexer(codes, 64);
+		List<RegexToken> tokens;
+		CopyFrom(tokens, lexer.Parse(L"123"));
+		TEST_ASSERT(tokens.Count() == 1);
+		TEST_ASSERT(tokens[0].token == 0);
+	});
 }
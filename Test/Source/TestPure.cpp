@@ -1,6 +1,7 @@
 ﻿#include <VlppOS.h>
 #include "../../Source/Regex/AST/RegexExpression.h"
 #include "../../Source/Regex/RegexPure.h"
+#include "../../Source/Regex/Regex.h"
 
 using namespace vl;
 using namespace vl::collections;
@@ -9,7 +10,7 @@ using namespace vl::regex_internal;
 
 namespace TestPure_TestObjects
 {
-	Ptr<PureInterpretor> BuildPureInterpretor(const char32_t* code)
+	Ptr<PureInterpretor> BuildPureInterpretor(const char32_t* code, PureTableEncoding encoding = PureTableEncoding::Auto)
 	{
 		CharRange::List subsets;
 		Dictionary<State*, State*> nfaStateMap;
@@ -21,7 +22,25 @@ namespace TestPure_TestObjects
 		auto eNfa = expression->GenerateEpsilonNfa();
 		auto nfa = EpsilonNfaToNfa(eNfa, PureEpsilonChecker, nfaStateMap);
 		auto dfa = NfaToDfa(nfa, dfaStateMap);
-		return Ptr(new PureInterpretor(dfa, subsets));
+		return Ptr(new PureInterpretor(dfa, subsets, nullptr, encoding));
+	}
+
+	// patches an item in a section of a serialized image and fixes the checksum, so that only the range checking could reject it
+	void PatchImage(Array<vuint64_t>& image, vuint32_t sectionId, vint index, vint32_t value)
+	{
+		auto header = (PureImageHeader*)&image[0];
+		auto sections = (PureImageSection*)(header + 1);
+		for (vuint32_t i = 0; i < header->sectionCount; i++)
+		{
+			if (sections[i].id == sectionId)
+			{
+				((vint32_t*)((char*)header + sections[i].offset))[index] = value;
+				header->checksum = 0;
+				header->checksum = UpdateCrc32(0, header, header->size);
+				return;
+			}
+		}
+		TEST_ASSERT(false);
 	}
 
 	void RunPureInterpretor(const char32_t* code, const wchar_t* input, vint start, vint length)
@@ -119,4 +138,293 @@ TEST_FILE
 			TEST_ASSERT(result.length == 4);
 		});
 	});
+
+	TEST_CATEGORY(L"Compressed transition table")
+	{
+		const char32_t* codes[] = {
+			U"(/+|-)?/d+(./d+)?",
+			U"\"([^\\\\\"]|\\\\\\.)*\"",
+			U"///*([^*]|/*+[^*//])*/*+//",
+			U"if|else|while|for|return|break|continue|switch|case|default",
+			U"[𣂕𣴑𣱳𦁚]+",
+		};
+		const wchar_t* inputs[] = {
+			L"vczh/***is***/genius",
+			L"while (x) { return -12.5; } else \"i\\r\\ns\"",
+			L"𩰪㦲𦰗𠀼 𣂕𣴑𣱳𦁚 continue",
+		};
+
+		for (auto code : codes)
+		{
+			TEST_CASE(u32tow(code))
+			{
+				auto dense = BuildPureInterpretor(code, PureTableEncoding::Dense);
+				auto compressed = BuildPureInterpretor(code, PureTableEncoding::Compressed);
+				TEST_ASSERT(!dense->IsCompressed());
+				TEST_ASSERT(compressed->IsCompressed());
+
+				MemoryStream stream;
+				compressed->Serialize(stream);
+				stream.SeekFromBegin(0);
+				PureInterpretor loaded(stream);
+				TEST_ASSERT(loaded.IsCompressed());
+
+				TEST_ASSERT(dense->GetStateCount() == compressed->GetStateCount());
+				TEST_ASSERT(dense->GetCharRangeCount() == compressed->GetCharRangeCount());
+				for (vint state = 0; state < dense->GetStateCount(); state++)
+				{
+					TEST_ASSERT(dense->IsFinalState(state) == compressed->IsFinalState(state));
+					TEST_ASSERT(dense->IsDeadState(state) == compressed->IsDeadState(state));
+					TEST_ASSERT(dense->Transit(U'\x01', state) == compressed->Transit(U'\x01', state));
+					for (vint i = 0; i < dense->GetCharRangeCount(); i++)
+					{
+						auto range = dense->GetCharRange(i);
+						TEST_ASSERT(dense->Transit(range.begin, state) == compressed->Transit(range.begin, state));
+						TEST_ASSERT(dense->Transit(range.end, state) == loaded.Transit(range.end, state));
+					}
+				}
+
+				for (auto input : inputs)
+				{
+					PureResult expected, actual;
+					TEST_ASSERT(dense->Match(input, input, expected) == compressed->Match(input, input, actual));
+					TEST_ASSERT(expected.start == actual.start);
+					TEST_ASSERT(expected.length == actual.length);
+				}
+			});
+		}
+
+		TEST_CASE(L"Sparse tables are compressed automatically")
+		{
+			TEST_ASSERT(BuildPureInterpretor(U"if|else|while|for|return|break|continue|switch|case|default")->IsCompressed());
+			TEST_ASSERT(!BuildPureInterpretor(U"[a-z]+")->IsCompressed());
+		});
+	});
+
+	TEST_CATEGORY(L"Merged char sets")
+	{
+		const char32_t* codes[] = {
+			U"if|int|[a-zA-Z_]+",
+			U"(/+|-)?/d+(./d+)?",
+			U"if|else|while|for|return|break|continue|switch|case|default",
+			U"[𣂕𣴑𣱳𦁚]+",
+		};
+
+		for (auto code : codes)
+		{
+			TEST_CASE(u32tow(code))
+			{
+				auto interpretor = BuildPureInterpretor(code);
+				MemoryStream stream;
+				interpretor->Serialize(stream);
+				stream.SeekFromBegin(0);
+				PureInterpretor loaded(stream);
+				TEST_ASSERT(loaded.GetCharSetCount() == interpretor->GetCharSetCount());
+				TEST_ASSERT(interpretor->GetCharSetCount() <= interpretor->GetCharRangeCount() + 1);
+
+				// ranges share a char set if and only if they transit to the same states
+				for (vint i = 0; i < interpretor->GetCharRangeCount(); i++)
+				{
+					TEST_ASSERT(loaded.GetCharRangeClass(i) == interpretor->GetCharRangeClass(i));
+					for (vint j = 0; j < i; j++)
+					{
+						bool identical = true;
+						for (vint state = 0; state < interpretor->GetStateCount(); state++)
+						{
+							auto ci = interpretor->GetCharRange(i);
+							auto cj = interpretor->GetCharRange(j);
+							TEST_ASSERT(interpretor->Transit(ci.begin, state) == interpretor->Transit(ci.end, state));
+							if (interpretor->Transit(ci.begin, state) != interpretor->Transit(cj.begin, state))
+							{
+								identical = false;
+							}
+						}
+						TEST_ASSERT(identical == (interpretor->GetCharRangeClass(i) == interpretor->GetCharRangeClass(j)));
+					}
+				}
+			});
+		}
+
+		TEST_CASE(L"Letters outside keywords are merged")
+		{
+			auto interpretor = BuildPureInterpretor(U"if|int|[a-zA-Z_]+");
+			TEST_ASSERT(interpretor->GetCharRangeCount() > 4);
+			TEST_ASSERT(interpretor->GetCharSetCount() == 6);
+		});
+	});
+
+	TEST_CATEGORY(L"Precomputed state tables")
+	{
+		const char32_t* codes[] = {
+			U"/d+(./d+)?",
+			U"if|int|[a-zA-Z_]+",
+			U"///*([^*]|/*+[^*//])*/*+//",
+			U"[𣂕𣴑𣱳𦁚]+",
+		};
+
+		for (auto code : codes)
+		{
+			TEST_CASE(u32tow(code))
+			{
+				auto interpretor = BuildPureInterpretor(code);
+				MemoryStream stream;
+				interpretor->Serialize(stream);
+				stream.SeekFromBegin(0);
+				PureInterpretor loaded(stream);
+
+				vint stateCount = interpretor->GetStateCount();
+				Array<bool> dead(stateCount);
+				Array<bool> alive(stateCount);
+				for (vint state = 0; state < stateCount; state++)
+				{
+					dead[state] = true;
+					alive[state] = interpretor->IsFinalState(state);
+					for (vint i = 0; i < interpretor->GetCharRangeCount(); i++)
+					{
+						if (interpretor->Transit(interpretor->GetCharRange(i).begin, state) != -1)
+						{
+							dead[state] = false;
+						}
+					}
+				}
+
+				bool modified = true;
+				while (modified)
+				{
+					modified = false;
+					for (vint state = 0; state < stateCount; state++)
+					{
+						if (alive[state]) continue;
+						for (vint i = 0; i < interpretor->GetCharRangeCount(); i++)
+						{
+							vint target = interpretor->Transit(interpretor->GetCharRange(i).begin, state);
+							if (target != -1 && alive[target])
+							{
+								alive[state] = true;
+								modified = true;
+								break;
+							}
+						}
+					}
+				}
+
+				TEST_ASSERT(interpretor->IsDeadState(-1));
+				TEST_ASSERT(!interpretor->CanReachFinalState(-1));
+				for (vint state = 0; state < stateCount; state++)
+				{
+					TEST_ASSERT(interpretor->IsDeadState(state) == dead[state]);
+					TEST_ASSERT(loaded.IsDeadState(state) == dead[state]);
+					TEST_ASSERT(interpretor->CanReachFinalState(state) == alive[state]);
+					TEST_ASSERT(loaded.CanReachFinalState(state) == alive[state]);
+				}
+			});
+		}
+	});
+
+	TEST_CATEGORY(L"Damaged images")
+	{
+		auto assertCorrupted = [](const regex::RegexImageException& e)
+		{
+			TEST_ASSERT(e.GetReason() == regex::RegexImageException::Reason::Corrupted);
+		};
+
+		auto loadImage = [](PureTableEncoding encoding, Array<vuint64_t>& image)
+		{
+			MemoryStream stream;
+			BuildPureInterpretor(U"if|else|while|for|return|break|continue|switch|case|default", encoding)->Serialize(stream);
+			image.Resize(((vint)stream.Size() + 7) / 8);
+			memcpy(&image[0], stream.GetInternalBuffer(), (size_t)stream.Size());
+			PureInterpretor loaded(&image[0], (vint)stream.Size());
+			return loaded.GetStateCount();
+		};
+
+		TEST_CASE(L"Transition targets are checked")
+		{
+			Array<vuint64_t> image;
+			vint stateCount = loadImage(PureTableEncoding::Dense, image);
+			PatchImage(image, PureImageSection::Transitions, 0, (vint32_t)stateCount);
+			TEST_EXCEPTION(PureInterpretor(&image[0], image.Count() * 8), regex::RegexImageException, assertCorrupted);
+			PatchImage(image, PureImageSection::Transitions, 0, -2);
+			TEST_EXCEPTION(PureInterpretor(&image[0], image.Count() * 8), regex::RegexImageException, assertCorrupted);
+		});
+
+		TEST_CASE(L"Compressed transition targets are checked")
+		{
+			Array<vuint64_t> image;
+			vint stateCount = loadImage(PureTableEncoding::Compressed, image);
+			PatchImage(image, PureImageSection::CombNext, 0, (vint32_t)stateCount);
+			TEST_EXCEPTION(PureInterpretor(&image[0], image.Count() * 8), regex::RegexImageException, assertCorrupted);
+
+			loadImage(PureTableEncoding::Compressed, image);
+			PatchImage(image, PureImageSection::CombCheck, 0, (vint32_t)stateCount);
+			TEST_EXCEPTION(PureInterpretor(&image[0], image.Count() * 8), regex::RegexImageException, assertCorrupted);
+		});
+
+		TEST_CASE(L"Char set indices are checked")
+		{
+			Array<vuint64_t> image;
+			loadImage(PureTableEncoding::Dense, image);
+			PatchImage(image, PureImageSection::CharBlockIndex, 0, 0x40000000);
+			TEST_EXCEPTION(PureInterpretor(&image[0], image.Count() * 8), regex::RegexImageException, assertCorrupted);
+
+			loadImage(PureTableEncoding::Dense, image);
+			PatchImage(image, PureImageSection::CharBlocks, 0, 10000);
+			TEST_EXCEPTION(PureInterpretor(&image[0], image.Count() * 8), regex::RegexImageException, assertCorrupted);
+		});
+
+		TEST_CASE(L"State bitsets are checked")
+		{
+			Array<vuint64_t> image;
+			vint stateCount = loadImage(PureTableEncoding::Dense, image);
+			TEST_ASSERT(stateCount % 32 != 0);
+
+			// the highest bit of the last word is after the last state
+			vuint32_t sectionIds[] = { PureImageSection::FinalStates, PureImageSection::DeadStates, PureImageSection::AliveStates };
+			for (auto sectionId : sectionIds)
+			{
+				loadImage(PureTableEncoding::Dense, image);
+				PatchImage(image, sectionId, stateCount / 32, (vint32_t)0x80000000);
+				TEST_EXCEPTION(PureInterpretor(&image[0], image.Count() * 8), regex::RegexImageException, assertCorrupted);
+			}
+		});
+
+		TEST_CASE(L"The header of a stream is checked before reading the image")
+		{
+			auto assertReason = [](regex::RegexImageException::Reason reason)
+			{
+				return [=](const regex::RegexImageException& e) { TEST_ASSERT(e.GetReason() == reason); };
+			};
+
+			Array<vuint64_t> image;
+			loadImage(PureTableEncoding::Dense, image);
+			auto header = (PureImageHeader*)&image[0];
+
+			{
+				// the claimed size is not allocated before the data is read
+				PureImageHeader claimed = *header;
+				claimed.size = 0xFFFFFFF8;
+				MemoryStream stream;
+				stream.Write(&claimed, sizeof(claimed));
+				stream.Write(&image[0], image.Count() * 8);
+				stream.SeekFromBegin(0);
+				TEST_EXCEPTION(PureInterpretor{ stream }, regex::RegexImageException, assertReason(regex::RegexImageException::Reason::Truncated));
+			}
+			{
+				PureImageHeader claimed = *header;
+				claimed.version++;
+				MemoryStream stream;
+				stream.Write(&claimed, sizeof(claimed));
+				stream.SeekFromBegin(0);
+				TEST_EXCEPTION(PureInterpretor{ stream }, regex::RegexImageException, assertReason(regex::RegexImageException::Reason::Version));
+			}
+			{
+				PureImageHeader claimed = *header;
+				claimed.size = 12;
+				MemoryStream stream;
+				stream.Write(&claimed, sizeof(claimed));
+				stream.SeekFromBegin(0);
+				TEST_EXCEPTION(PureInterpretor{ stream }, regex::RegexImageException, assertReason(regex::RegexImageException::Reason::Corrupted));
+			}
+		});
+	});
 }
\ No newline at end of file
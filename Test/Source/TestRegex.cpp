@@ -1,10 +1,18 @@
-﻿#include "../../Source/Regex/AST/RegexWriter.h"
+﻿#include <VlppOS.h>
+#include "../../Source/Regex/AST/RegexWriter.h"
 #include "../../Source/Regex/Regex.h"
+#include "../Resources/Baseline/GeneratedRegex.h"
 
 using namespace vl;
+using namespace vl::collections;
+using namespace vl::stream;
+using namespace vl::filesystem;
 using namespace vl::regex;
 using namespace vl::regex_internal;
 
+extern WString GetTestResourcePath();
+extern WString GetTestOutputPath();
+
 void NormalizedRegexAssert(const char32_t* input, RegexNode node)
 {
 	CharRange::List subsets;
@@ -298,6 +306,290 @@ TEST_FILE
 		}
 	});
 
+	TEST_CASE(L"Test prefiltering rich regex")
+	{
+		auto assertMatch = [](const wchar_t* code, const wchar_t* input, vint start, vint length)
+		{
+			Regex regex(code);
+			TEST_ASSERT(regex.IsPureMatch() == false);
+			TEST_ASSERT(regex.IsPureTest() == false);
+
+			auto match = regex.Match(input);
+			if (start == -1)
+			{
+				TEST_ASSERT(!match);
+				TEST_ASSERT(regex.Test(input) == false);
+			}
+			else
+			{
+				TEST_ASSERT(match);
+				TEST_ASSERT(match->Result().Start() == start);
+				TEST_ASSERT(match->Result().Length() == length);
+				TEST_ASSERT(regex.Test(input) == true);
+			}
+		};
+
+		assertMatch(L"(<sec>/d+)x(<$sec>)", L"12x1 34x34", 5, 5);
+		assertMatch(L"(<sec>/d+)x(<$sec>)", L"12x1 34x3", -1, 0);
+		assertMatch(L"/d+(=px)", L"12 34px", 3, 2);
+		assertMatch(L"/d+(!px)", L"12px", 0, 1);
+		assertMatch(L"/d+?(!px)", L"ab12px", 2, 1);
+		assertMatch(L"^abc", L"xabc", -1, 0);
+		assertMatch(L"abc$", L"abcabc", 3, 3);
+		assertMatch(L"(<$x>)?a(<x>b)", L"xxab", 2, 2);
+		assertMatch(L"^(<x>a*)", L"bb", 0, 0);
+		assertMatch(L"(<x>a*)(<$x>)", L"b", 0, 0);
+
+		{
+			// a DFA accepting an empty string is not used to reject positions
+			Regex regex(L"(<x>a*)");
+			TEST_ASSERT(regex.IsPureMatch() == false);
+			auto match = regex.Match(L"b");
+			TEST_ASSERT(match);
+			TEST_ASSERT(match->Result().Start() == 0);
+			TEST_ASSERT(match->Result().Length() == 0);
+
+			MemoryStream stream;
+			regex.Serialize(stream);
+			stream.SeekFromBegin(0);
+			Regex loaded(stream);
+			match = loaded.Match(L"b");
+			TEST_ASSERT(match);
+			TEST_ASSERT(match->Result().Start() == 0);
+			TEST_ASSERT(match->Result().Length() == 0);
+		}
+
+		Regex regex(L"(<sec>/d+)x(<$sec>)");
+		RegexMatch::List matches;
+		regex.Search(L"1x1 2x3 45x45 6x6", matches);
+		TEST_ASSERT(matches.Count() == 3);
+		TEST_ASSERT(matches[0]->Result().Value() == L"1x1");
+		TEST_ASSERT(matches[1]->Result().Value() == L"45x45");
+		TEST_ASSERT(matches[2]->Result().Value() == L"6x6");
+	});
+
+	TEST_CASE(L"Test lazy DFA")
+	{
+		RegexOptions options;
+		options.lazyDfa = true;
+
+		const wchar_t* codes[] = {
+			L"/d+",
+			L"(/+|-)?/d+(./d+)?",
+			L"(<number>/d+)",
+			L"(a|b)*abb",
+			L"/d+(=px)",
+		};
+		const wchar_t* input = L"ab 12px abb -3.14 x+5 babb";
+
+		for (auto code : codes)
+		{
+			Regex eager(code);
+			Regex lazy(code, options);
+			TEST_ASSERT(eager.IsPureTest() == lazy.IsPureTest());
+			TEST_ASSERT(eager.IsPureMatch() == lazy.IsPureMatch());
+
+			RegexMatch::List expected, actual;
+			eager.Cut(input, false, expected);
+			lazy.Cut(input, false, actual);
+			TEST_ASSERT(expected.Count() == actual.Count());
+			for (vint i = 0; i < expected.Count(); i++)
+			{
+				TEST_ASSERT(expected[i]->Success() == actual[i]->Success());
+				TEST_ASSERT(expected[i]->Result().Start() == actual[i]->Result().Start());
+				TEST_ASSERT(expected[i]->Result().Length() == actual[i]->Result().Length());
+			}
+			TEST_ASSERT(eager.TestHead(input) == lazy.TestHead(input));
+		}
+	});
+
+	TEST_CASE(L"Test RegexSet")
+	{
+		List<WString> codes;
+		codes.Add(L"error");
+		codes.Add(L"warn(ing)?");
+		codes.Add(L"/d+");
+		codes.Add(L"[a-z]+@[a-z]+");
+		codes.Add(L"x*");
+		codes.Add(L"^start");
+		codes.Add(L"(<n>/d)(<$n>)");
+		codes.Add(L"err");
+		codes.Add(L"/s{2,}");
+		codes.Add(L"r(=o)");
+
+		const wchar_t* inputs[] = {
+			L"",
+			L"2 errors",
+			L"warning: disk 99% full",
+			L"start with a@b",
+			L"no match here",
+			L"foo  bar 11",
+			L"\u4F60\u597D",
+		};
+
+		RegexSet regexSet(codes);
+		TEST_ASSERT(regexSet.Count() == codes.Count());
+		for (auto input : inputs)
+		{
+			List<vint> expected, actual;
+			for (auto [code, index] : indexed(codes))
+			{
+				if (Regex(code).Test(input))
+				{
+					expected.Add(index);
+				}
+			}
+			regexSet.Matches(input, actual);
+			TEST_ASSERT(CompareEnumerable(expected, actual) == 0);
+		}
+
+		List<vint> ids;
+		regexSet.Matches(L"2 errors", ids);
+		TEST_ASSERT(ids.Count() == 4);
+		TEST_ASSERT(ids[0] == 0);
+		TEST_ASSERT(ids[1] == 2);
+		TEST_ASSERT(ids[2] == 7);
+		TEST_ASSERT(ids[3] == 9);
+	});
+
+	TEST_CASE(L"Test Regex serialization")
+	{
+		const wchar_t* codes[] = {
+			L"(/+|-)?/d+(./d+)?",
+			L"(<number>/d+)x(<$number>)",
+			L"(<sec>/d)+-(<$sec;1>)",
+			L"/d+(=px)",
+			L"^(<key>/w+)=(<value>[^;]*);?",
+			L"(?/w+)@(?/w+)",
+		};
+		const wchar_t* inputs[] = {
+			L"",
+			L"1x1 2x3 45x45 -3.14",
+			L"12-1 123-2 width=12px;height=3em",
+			L"a@b c=d; vczh@genius",
+		};
+
+		auto assertSameStrings = [](auto&& expected, auto&& actual)
+		{
+			TEST_ASSERT(expected.Count() == actual.Count());
+			for (vint i = 0; i < expected.Count(); i++)
+			{
+				TEST_ASSERT(expected[i] == actual[i]);
+			}
+		};
+
+		for (auto code : codes)
+		{
+			Regex expected(code);
+			MemoryStream stream;
+			expected.Serialize(stream);
+			stream.SeekFromBegin(0);
+			Regex actual(stream);
+
+			TEST_ASSERT(expected.IsPureMatch() == actual.IsPureMatch());
+			TEST_ASSERT(expected.IsPureTest() == actual.IsPureTest());
+			TEST_ASSERT(CompareEnumerable(expected.CaptureNames(), actual.CaptureNames()) == 0);
+
+			for (auto input : inputs)
+			{
+				RegexMatch::List expectedMatches, actualMatches;
+				expected.Cut(input, false, expectedMatches);
+				actual.Cut(input, false, actualMatches);
+				TEST_ASSERT(expectedMatches.Count() == actualMatches.Count());
+				for (vint i = 0; i < expectedMatches.Count(); i++)
+				{
+					auto e = expectedMatches[i];
+					auto a = actualMatches[i];
+					TEST_ASSERT(e->Success() == a->Success());
+					TEST_ASSERT(e->Result() == a->Result());
+					assertSameStrings(e->Captures(), a->Captures());
+					TEST_ASSERT(e->Groups().Count() == a->Groups().Count());
+					for (vint j = 0; j < e->Groups().Count(); j++)
+					{
+						TEST_ASSERT(e->Groups().Keys()[j] == a->Groups().Keys()[j]);
+						assertSameStrings(e->Groups().GetByIndex(j), a->Groups().GetByIndex(j));
+					}
+				}
+				TEST_ASSERT(expected.TestHead(input) == actual.TestHead(input));
+			}
+		}
+
+		{
+			MemoryStream stream;
+			Regex(L"(<number>/d+)x(<$number>)").Serialize(stream);
+			vint size = (vint)stream.Size();
+			auto bytes = (vuint8_t*)stream.GetInternalBuffer();
+			bytes[size - 1] ^= 1;
+			stream.SeekFromBegin(0);
+			TEST_EXCEPTION(Regex{ stream }, RegexImageException, [](const RegexImageException& e)
+			{
+				TEST_ASSERT(e.GetReason() == RegexImageException::Reason::Checksum);
+			});
+		}
+		{
+			MemoryStream stream;
+			List<WString> tokens;
+			tokens.Add(L"/d+");
+			RegexLexer(tokens).Serialize(stream);
+			stream.SeekFromBegin(0);
+			TEST_EXCEPTION(Regex{ stream }, RegexImageException, [](const RegexImageException& e)
+			{
+				TEST_ASSERT(e.GetReason() == RegexImageException::Reason::NotAnImage);
+			});
+		}
+		{
+			MemoryStream stream;
+			RegexOptions options;
+			options.lazyDfa = true;
+			TEST_ERROR(Regex(L"/d+", options).Serialize(stream));
+		}
+	});
+
+	TEST_CASE(L"Test Regex code generation")
+	{
+		Regex regex(L"(/+|-)?/d+(./d+)?([eE](/+|-)?/d+)?");
+		WString generated = GenerateToStream([&](StreamWriter& writer)
+		{
+			regex.GenerateCpp(writer, L"GeneratedRegex", L"../../../Source/Regex/Regex.h");
+		});
+		{
+			FileStream file(GetTestOutputPath() + L"GeneratedRegex.h", FileStream::WriteOnly);
+			BomEncoder encoder(BomEncoder::Utf8);
+			EncoderStream output(file, encoder);
+			StreamWriter writer(output);
+			writer.WriteString(generated);
+		}
+
+		List<WString> generatedLines, baselineLines;
+		File(FilePath(GetTestOutputPath()) / L"GeneratedRegex.h").ReadAllLinesByBom(generatedLines);
+		File(FilePath(GetTestResourcePath()) / L"Baseline" / L"GeneratedRegex.h").ReadAllLinesByBom(baselineLines);
+		TEST_ASSERT(CompareEnumerable(generatedLines, baselineLines) == 0);
+
+		// GeneratedRegex.h is the same baseline, produced from this regex
+		auto assertGeneratedRegex = [&]<typename T>(const ObjectString<T>& input)
+		{
+			auto match = regex.Match(input);
+			vint start = -1;
+			vint length = -1;
+			TEST_ASSERT(GeneratedRegex::Match(input.Buffer(), start, length) == (bool)match);
+			if (match)
+			{
+				TEST_ASSERT(start == match->Result().Start());
+				TEST_ASSERT(length == match->Result().Length());
+			}
+			TEST_ASSERT(GeneratedRegex::Test(input.Buffer()) == regex.Test(input));
+			TEST_ASSERT(GeneratedRegex::TestHead(input.Buffer()) == regex.TestHead(input));
+		};
+
+		assertGeneratedRegex(WString(L""));
+		assertGeneratedRegex(WString(L"-3.14e+10 and more"));
+		assertGeneratedRegex(WString(L"x = 1e"));
+		assertGeneratedRegex(WString(L"no number"));
+		assertGeneratedRegex(U8String(u8"𬀪㦲 +42"));
+		assertGeneratedRegex(U16String(u"𬀪㦲 +42"));
+		assertGeneratedRegex(U32String(U"𬀪㦲 +42"));
+	});
+
 	TEST_CATEGORY(L"Unicode")
 	{
 		Regex_<char8_t> regex(u8"/./.(?[𣂕𣴑𣱳𦁚]+)/./.");
@@ -346,8 +638,298 @@ TEST_FILE
 			TEST_ASSERT(match->Captures()[0].Length() == 4);
 			TEST_ASSERT(match->Captures()[0].Value() == captured);
 		});
+
+		TEST_CASE(L"Backreference")
+		{
+			{
+				Regex_<char8_t> regex8(u8"(<x>[𣂕𣴑]+)-(<$x>)");
+				auto match = regex8.Match(u8"a𣂕𣴑-𣂕𣴑!");
+				TEST_ASSERT(match);
+				TEST_ASSERT(match->Result().Value() == u8"𣂕𣴑-𣂕𣴑");
+				TEST_ASSERT(!regex8.Match(u8"a𣂕𣴑-𣂕𣂕!"));
+				TEST_ASSERT(!regex8.Match(u8"a𣂕𣴑-𣂕"));
+			}
+			{
+				Regex_<char16_t> regex16(u"(<x>[𣂕𣴑]+)-(<$x>)");
+				auto match = regex16.Match(u"a𣂕𣴑-𣂕𣴑!");
+				TEST_ASSERT(match);
+				TEST_ASSERT(match->Result().Value() == u"𣂕𣴑-𣂕𣴑");
+				TEST_ASSERT(!regex16.Match(u"a𣂕𣴑-𣂕𣂕!"));
+				TEST_ASSERT(!regex16.Match(u"a𣂕𣴑-𣂕"));
+			}
+			{
+				Regex_<char32_t> regex32(U"(<x>[𣂕𣴑]+)-(<$x>)");
+				auto match = regex32.Match(U"a𣂕𣴑-𣂕𣴑!");
+				TEST_ASSERT(match);
+				TEST_ASSERT(match->Result().Value() == U"𣂕𣴑-𣂕𣴑");
+				TEST_ASSERT(!regex32.Match(U"a𣂕𣴑-𣂕𣂕!"));
+				TEST_ASSERT(!regex32.Match(U"a𣂕𣴑-𣂕"));
+			}
+		});
+	});
+
+	TEST_CATEGORY(L"Test Regex::Analyze")
+	{
+		TEST_CASE(L"DFA")
+		{
+			auto complexity = Regex::Analyze(L"/d+(./d+)?");
+			TEST_ASSERT(!complexity.requiresBacktracking);
+			TEST_ASSERT(complexity.canTestWithDfa);
+			TEST_ASSERT(complexity.nfaStateCount > 0);
+			TEST_ASSERT(complexity.dfaStateCount > 0);
+			TEST_ASSERT(!complexity.dfaStateCountExceeded);
+			TEST_ASSERT(complexity.nestedQuantifiers == 0);
+			TEST_ASSERT(complexity.overlappingAlternations == 0);
+			TEST_ASSERT(!complexity.exponentialBacktracking);
+			TEST_ASSERT(complexity.recommendedEngine == RegexComplexity::Engine::Dfa);
+			TEST_ASSERT(!complexity.recommendedOptions.lazyDfa);
+			TEST_ASSERT(complexity.recommendedOptions.maxDfaStateCount == 4096);
+
+			Regex regex(L"/d+(./d+)?");
+			TEST_ASSERT(regex.IsPureMatch());
+		});
+
+		TEST_CASE(L"DFA blowup")
+		{
+			auto complexity = Regex::Analyze(L"/.*a/.{12}", 256);
+			TEST_ASSERT(!complexity.requiresBacktracking);
+			TEST_ASSERT(complexity.dfaStateCountExceeded);
+			TEST_ASSERT(complexity.dfaStateCount == 256);
+			TEST_ASSERT(complexity.recommendedEngine == RegexComplexity::Engine::LazyDfa);
+			TEST_ASSERT(complexity.recommendedOptions.lazyDfa);
+			TEST_ASSERT(complexity.recommendedOptions.maxDfaStateCount == 256);
+
+			Regex regex(L"/.*a/.{12}", complexity.recommendedOptions);
+			TEST_ASSERT(regex.Test(L"xxa123456789012"));
+			TEST_ASSERT(!regex.Test(L"xxa12345678901"));
+		});
+
+		TEST_CASE(L"Backtracking")
+		{
+			{
+				auto complexity = Regex::Analyze(L"(<x>/w+)-(<$x>)");
+				TEST_ASSERT(complexity.requiresBacktracking);
+				TEST_ASSERT(!complexity.canTestWithDfa);
+				TEST_ASSERT(!complexity.exponentialBacktracking);
+				TEST_ASSERT(complexity.recommendedEngine == RegexComplexity::Engine::Backtracking);
+			}
+			{
+				auto complexity = Regex::Analyze(L"^(<x>[a-z]+)+$");
+				TEST_ASSERT(complexity.requiresBacktracking);
+				TEST_ASSERT(complexity.nestedQuantifiers == 1);
+				TEST_ASSERT(complexity.exponentialBacktracking);
+			}
+			{
+				auto complexity = Regex::Analyze(L"^(a|ab|b)*$");
+				TEST_ASSERT(complexity.requiresBacktracking);
+				TEST_ASSERT(complexity.nestedQuantifiers == 0);
+				TEST_ASSERT(complexity.overlappingAlternations == 1);
+				TEST_ASSERT(complexity.exponentialBacktracking);
+			}
+			{
+				auto complexity = Regex::Analyze(L"(a+)+b");
+				TEST_ASSERT(!complexity.requiresBacktracking);
+				TEST_ASSERT(complexity.nestedQuantifiers == 1);
+				TEST_ASSERT(!complexity.exponentialBacktracking);
+				TEST_ASSERT(complexity.recommendedEngine == RegexComplexity::Engine::Dfa);
+			}
+			{
+				auto complexity = Regex_<char8_t>::Analyze(u8"(<x>a|b)*c");
+				TEST_ASSERT(complexity.requiresBacktracking);
+				TEST_ASSERT(complexity.canTestWithDfa);
+				TEST_ASSERT(complexity.overlappingAlternations == 0);
+				TEST_ASSERT(!complexity.exponentialBacktracking);
+			}
+		});
+
+		TEST_CASE(L"Backtracking DFA blowup")
+		{
+			// the DFA for testing fits in the limit, but the DFA for matching with captures does not
+			TEST_ASSERT(!Regex::Analyze(L"/d+-/d+", 8).dfaStateCountExceeded);
+			auto complexity = Regex::Analyze(L"(<x>/d+)-(<x>/d+)", 8);
+			TEST_ASSERT(complexity.requiresBacktracking);
+			TEST_ASSERT(complexity.canTestWithDfa);
+			TEST_ASSERT(complexity.dfaStateCountExceeded);
+			TEST_ASSERT(complexity.dfaStateCount == 8);
+			TEST_ASSERT(complexity.recommendedEngine == RegexComplexity::Engine::Backtracking);
+			TEST_ASSERT(!complexity.recommendedOptions.lazyDfa);
+			TEST_ASSERT(complexity.recommendedOptions.maxDfaStateCount == -1);
+
+			RegexOptions options;
+			options.maxDfaStateCount = 8;
+			TEST_EXCEPTION(Regex(L"(<x>/d+)-(<x>/d+)", options), RegexLimitException, [](const RegexLimitException&) {});
+
+			Regex regex(L"(<x>/d+)-(<x>/d+)", complexity.recommendedOptions);
+			TEST_ASSERT(regex.Match(L"a12-34")->Result().Value() == L"12-34");
+		});
 	});
 
+	TEST_CATEGORY(L"Test DFA state limit")
+	{
+		TEST_CASE(L"Within the limit")
+		{
+			RegexOptions options;
+			options.maxDfaStateCount = 64;
+			Regex regex(L"/d+(./d+)?", options);
+			TEST_ASSERT(regex.IsPureMatch());
+			TEST_ASSERT(regex.Match(L"abc3.14")->Result().Value() == L"3.14");
+
+			// a DFA built in the constructor could be serialized
+			MemoryStream stream;
+			regex.Serialize(stream);
+		});
+
+		TEST_CASE(L"Fall back to a lazy DFA")
+		{
+			RegexOptions options;
+			options.maxDfaStateCount = 64;
+			Regex regex(L"/.*a/.{12}", options);
+			TEST_ASSERT(regex.IsPureMatch());
+			TEST_ASSERT(regex.IsPureTest());
+			TEST_ASSERT(regex.Test(L"xxa123456789012"));
+			TEST_ASSERT(!regex.Test(L"xxa12345678901"));
+			TEST_ASSERT(regex.MatchHead(L"xxa123456789012")->Result().Length() == 15);
+
+			// DFA states are built on demand, which cannot be serialized
+			MemoryStream stream;
+			TEST_ERROR(regex.Serialize(stream));
+		});
+
+		TEST_CASE(L"Captures")
+		{
+			RegexOptions options;
+			options.maxDfaStateCount = 4;
+			TEST_EXCEPTION(Regex(L"(<x>/d+)-(<$x>)", options), RegexLimitException, [](const RegexLimitException& e)
+			{
+				TEST_ASSERT(e.GetMaxStateCount() == 4);
+			});
+
+			// the lazy DFA for testing is already created when the DFA for captures exceeds the limit
+			options.maxDfaStateCount = 1;
+			TEST_EXCEPTION(Regex(L"(<x>/d+)", options), RegexLimitException, [](const RegexLimitException& e)
+			{
+				TEST_ASSERT(e.GetMaxStateCount() == 1);
+			});
+
+			options.maxDfaStateCount = 64;
+			Regex regex(L"(<x>/.*a/.{12})", options);
+			TEST_ASSERT(!regex.IsPureMatch());
+			TEST_ASSERT(regex.IsPureTest());
+			TEST_ASSERT(regex.Match(L"xxa123456789012")->Groups()[regex.CaptureNames().IndexOf(L"x")][0].Value() == L"xxa123456789012");
+		});
+
+		TEST_CASE(L"Prefilter")
+		{
+			// the prefilter is skipped instead of failing the constructor
+			RegexOptions options;
+			options.maxDfaStateCount = 64;
+			Regex regex(L"(/.*a/.{12})(<x>b)(<$x>)", options);
+			TEST_ASSERT(!regex.IsPureMatch());
+			TEST_ASSERT(regex.Match(L"xa123456789012bb"));
+		});
+	});
+
+#ifdef VCZH_REGEX_STATISTICS
+	TEST_CATEGORY(L"Test statistics")
+	{
+		TEST_CASE(L"DFA")
+		{
+			Regex regex(L"/d+");
+			auto statistics = regex.GetStatistics();
+			TEST_ASSERT(statistics.dfa);
+			TEST_ASSERT(!statistics.lazyDfa);
+			TEST_ASSERT(!statistics.backtracking);
+			TEST_ASSERT(statistics.dfaStateCount > 0);
+			TEST_ASSERT(statistics.dfaCharSetCount > 0);
+			TEST_ASSERT(statistics.tableBytes > 0);
+			TEST_ASSERT(statistics.matchHeads == 0);
+
+			TEST_ASSERT(regex.Match(L"ab123"));
+			statistics = regex.GetStatistics();
+			TEST_ASSERT(statistics.dfaCalls == 1);
+			TEST_ASSERT(statistics.backtrackingCalls == 0);
+			TEST_ASSERT(statistics.matchHeads == 3);
+			TEST_ASSERT(statistics.matchHeadRestarts == 2);
+			TEST_ASSERT(statistics.scannedChars == 6);
+			TEST_ASSERT(statistics.backtracks == 0);
+
+			regex.ResetStatistics();
+			statistics = regex.GetStatistics();
+			TEST_ASSERT(statistics.dfaCalls == 0);
+			TEST_ASSERT(statistics.matchHeads == 0);
+			TEST_ASSERT(statistics.scannedChars == 0);
+			TEST_ASSERT(statistics.dfaStateCount > 0);
+		});
+
+		TEST_CASE(L"Lazy DFA")
+		{
+			RegexOptions options;
+			options.lazyDfa = true;
+			Regex regex(L"/d+", options);
+			TEST_ASSERT(regex.TestHead(L"123"));
+			auto statistics = regex.GetStatistics();
+			TEST_ASSERT(statistics.dfa);
+			TEST_ASSERT(statistics.lazyDfa);
+			TEST_ASSERT(statistics.dfaStateCount > 1);
+			TEST_ASSERT(statistics.dfaCalls == 1);
+			TEST_ASSERT(statistics.matchHeads == 1);
+			TEST_ASSERT(statistics.lazyFlushes == 0);
+		});
+
+		TEST_CASE(L"Backtracking")
+		{
+			Regex regex(L"(<x>/w+)-(<$x>)");
+			auto statistics = regex.GetStatistics();
+			TEST_ASSERT(!statistics.dfa);
+			TEST_ASSERT(statistics.backtracking);
+			TEST_ASSERT(statistics.prefilter);
+			TEST_ASSERT(statistics.backtrackingStateCount > 0);
+			TEST_ASSERT(statistics.backtrackingInstructionCount > 0);
+
+			TEST_ASSERT(regex.MatchHead(L"abc-abc"));
+			statistics = regex.GetStatistics();
+			TEST_ASSERT(statistics.dfaCalls == 0);
+			TEST_ASSERT(statistics.backtrackingCalls == 1);
+			TEST_ASSERT(statistics.matchHeads == 1);
+			TEST_ASSERT(statistics.stateSaverHighWaterMark > 0);
+
+			regex.ResetStatistics();
+			TEST_ASSERT(regex.Match(L"+-abc-abc"));
+			statistics = regex.GetStatistics();
+			TEST_ASSERT(statistics.prefilterRejections == 2);
+
+			Regex backtracking(L"(<x>/w+)c");
+			TEST_ASSERT(backtracking.MatchHead(L"abc"));
+			statistics = backtracking.GetStatistics();
+			TEST_ASSERT(statistics.backtracks > 0);
+			TEST_ASSERT(statistics.scannedChars > 3);
+		});
+
+		TEST_CASE(L"Lexer")
+		{
+			List<WString> tokens;
+			tokens.Add(L"/d+");
+			tokens.Add(L"/s+");
+			RegexLexer lexer(tokens);
+			auto statistics = lexer.GetStatistics();
+			TEST_ASSERT(statistics.dfa);
+			TEST_ASSERT(statistics.dfaStateCount > 0);
+			TEST_ASSERT(statistics.tableBytes > 0);
+
+			List<RegexToken> parsed;
+			CopyFrom(parsed, lexer.Parse(L"12 34"));
+			TEST_ASSERT(parsed.Count() == 3);
+			statistics = lexer.GetStatistics();
+			TEST_ASSERT(statistics.dfaCalls == 1);
+			TEST_ASSERT(statistics.matchHeads == 3);
+			TEST_ASSERT(statistics.backtracks == 0);
+
+			lexer.ResetStatistics();
+			TEST_ASSERT(lexer.GetStatistics().matchHeads == 0);
+		});
+	});
+#endif
+
 #ifdef NDEBUG
 	auto FindRows = [](WString* lines, int count, const WString& pattern)
 	{
@@ -1,8 +1,11 @@
-﻿#include "../../Source/Regex/AST/RegexExpression.h"
+﻿#include <VlppOS.h>
+#include "../../Source/Regex/AST/RegexExpression.h"
 #include "../../Source/Regex/RegexRich.h"
+#include "../../Source/Regex/Regex.h"
 
 using namespace vl;
 using namespace vl::collections;
+using namespace vl::stream;
 using namespace vl::regex_internal;
 
 namespace TestRich_TestObjects
@@ -23,6 +26,17 @@ namespace TestRich_TestObjects
 		return Ptr(new RichInterpretor(dfa));
 	}
 
+	// loads a serialized RichInterpretor after fixing the checksum of a patched payload, so that only the range checking could reject it
+	void LoadPatchedRichInterpretor(RichProgramHeader header, Array<vint32_t>& payload)
+	{
+		header.checksum = UpdateCrc32(0, &payload[0], sizeof(vint32_t) * payload.Count());
+		MemoryStream stream;
+		stream.Write(&header, sizeof(header));
+		stream.Write(&payload[0], sizeof(vint32_t) * payload.Count());
+		stream.SeekFromBegin(0);
+		RichInterpretor loaded(stream);
+	}
+
 	void RunRichInterpretor(const char32_t* code, const wchar_t* input, vint start, vint length)
 	{
 		TEST_CASE(u32tow(code) + WString(L" on ") + input)
@@ -118,6 +132,16 @@ TEST_FILE
 		RunRichInterpretor(U"/d+?a", L"abcde12345abcde", 5, 6);
 	});
 
+	TEST_CATEGORY(L"Rich interpretor: alternatives")
+	{
+		RunRichInterpretor(U"(for|foreach)", L"x foreach", 2, 3);
+		RunRichInterpretor(U"(<k>if|int|in|for)", L"x inter", 2, 3);
+		RunRichInterpretor(U"(<k>if|in|int|for)", L"x inter", 2, 2);
+		RunRichInterpretor(U"(<k>if|in|int|for)(<$k>)", L"x inin intint", 2, 4);
+		RunRichInterpretor(U"(a|b|c|d|e|f|g)+?x", L"gfedcbax", 0, 8);
+		RunRichInterpretor(U"(a|b|c|d|e|f|g)+x", L"gfedcbay", -1, 0);
+	});
+
 	TEST_CATEGORY(L"Rich interpretor: capturing")
 	{
 		TEST_CASE(L"(<number>/d+) on abcde123456abcde")
@@ -138,6 +162,29 @@ TEST_FILE
 			TEST_ASSERT(result.captures[0].length == 6);
 		});
 
+		TEST_CASE(L"(<x>/d)(<y>/d)(?/d)(<x>/d) on 1234")
+		{
+			const char32_t* code = U"(<x>/d)(<y>/d)(?/d)(<x>/d)";
+			const wchar_t* input = L"1234";
+			RichResult result;
+			auto regex = BuildRichInterpretor(code);
+			TEST_ASSERT(regex->CaptureNames().IndexOf(U"x") == 0);
+			TEST_ASSERT(regex->CaptureNames().IndexOf(U"y") == 1);
+
+			TEST_ASSERT(regex->Match(input, input, result) == true);
+			TEST_ASSERT(result.start == 0);
+			TEST_ASSERT(result.length == 4);
+			TEST_ASSERT(result.captures.Count() == 4);
+			TEST_ASSERT(result.captures[0].capture == -1);
+			TEST_ASSERT(result.captures[0].start == 2);
+			TEST_ASSERT(result.captures[1].capture == 0);
+			TEST_ASSERT(result.captures[1].start == 0);
+			TEST_ASSERT(result.captures[2].capture == 0);
+			TEST_ASSERT(result.captures[2].start == 3);
+			TEST_ASSERT(result.captures[3].capture == 1);
+			TEST_ASSERT(result.captures[3].start == 1);
+		});
+
 		TEST_CASE(L"(<#sec>(<sec>/d+))((<&sec>).){3}(<&sec>) on 196.128.0.1")
 		{
 			const char32_t* code = U"(<#sec>(<sec>/d+))((<&sec>).){3}(<&sec>)";
@@ -200,6 +247,50 @@ TEST_FILE
 			TEST_ASSERT(result.captures[0].start == 5);
 			TEST_ASSERT(result.captures[0].length == 9);
 		});
+
+		TEST_CASE(L"(<sec>/d)+-(<$sec;1>) on 123-2 and 123-1")
+		{
+			const char32_t* code = U"(<sec>/d)+-(<$sec;1>)";
+			auto regex = BuildRichInterpretor(code);
+			{
+				const wchar_t* input = L"123-2";
+				RichResult result;
+				TEST_ASSERT(regex->Match(input, input, result) == true);
+				TEST_ASSERT(result.start == 0);
+				TEST_ASSERT(result.length == 5);
+				TEST_ASSERT(result.captures.Count() == 3);
+				TEST_ASSERT(result.captures[1].start == 1);
+				TEST_ASSERT(result.captures[1].length == 1);
+			}
+			{
+				const wchar_t* input = L"123-1";
+				RichResult result;
+				TEST_ASSERT(regex->Match(input, input, result) == false);
+				TEST_ASSERT(result.captures.Count() == 0);
+			}
+		});
+
+		TEST_CASE(L"((<x>a)|(<x>b))+c(<$x;0>) on abcb and abca")
+		{
+			const char32_t* code = U"((<x>a)|(<x>b))+c(<$x;0>)";
+			auto regex = BuildRichInterpretor(code);
+			{
+				const wchar_t* input = L"abcb";
+				RichResult result;
+				TEST_ASSERT(regex->Match(input, input, result) == true);
+				TEST_ASSERT(result.start == 1);
+				TEST_ASSERT(result.length == 3);
+				TEST_ASSERT(result.captures.Count() == 1);
+			}
+			{
+				const wchar_t* input = L"abca";
+				RichResult result;
+				TEST_ASSERT(regex->Match(input, input, result) == true);
+				TEST_ASSERT(result.start == 0);
+				TEST_ASSERT(result.length == 4);
+				TEST_ASSERT(result.captures.Count() == 2);
+			}
+		});
 	});
 
 	TEST_CATEGORY(L"Rich interpretor: prematching")
@@ -331,4 +422,108 @@ TEST_FILE
 			TEST_ASSERT(result.captures[0].length == 4);
 		});
 	});
+
+	TEST_CATEGORY(L"Damaged streams")
+	{
+		RichProgramHeader header;
+		Array<vint32_t> payload;
+		{
+			MemoryStream stream;
+			BuildRichInterpretor(U"(<x>[a-c]|e|g)z")->Serialize(stream);
+			stream.SeekFromBegin(0);
+			stream.Read(&header, sizeof(header));
+			payload.Resize(header.payloadCount);
+			stream.Read(&payload[0], sizeof(vint32_t) * payload.Count());
+		}
+
+		// find a state with more than one Chars instruction, see RichInterpretor::Serialize for the layout
+		vint stateCount = payload[0];
+		vint instructionCount = payload[1];
+		vint firstStateItem = 4;
+		vint firstInstructionItem = firstStateItem + 6 * stateCount;
+		vint firstDispatchItem = firstInstructionItem + 8 * instructionCount;
+		vint state = 0;
+		while (state < stateCount && payload[firstStateItem + 6 * state + 4] < 2)
+		{
+			state++;
+		}
+		vint stateInstructionCount = payload[firstStateItem + 6 * state + 1];
+		vint nextNonCharsItem = firstInstructionItem + 8 * payload[firstStateItem + 6 * state] + 7;
+		vint dispatchItem = firstDispatchItem + 3 * payload[firstStateItem + 6 * state + 3];
+
+		auto assertCorrupted = [](const regex::RegexImageException& e)
+		{
+			TEST_ASSERT(e.GetReason() == regex::RegexImageException::Reason::Corrupted);
+		};
+
+		TEST_CASE(L"The undamaged stream is loaded")
+		{
+			TEST_ASSERT(state < stateCount);
+			LoadPatchedRichInterpretor(header, payload);
+		});
+
+		TEST_CASE(L"Instructions are checked against their states")
+		{
+			Array<vint32_t> patched;
+			CopyFrom(patched, payload);
+			patched[nextNonCharsItem] = (vint32_t)stateInstructionCount + 1;
+			TEST_EXCEPTION(LoadPatchedRichInterpretor(header, patched), regex::RegexImageException, assertCorrupted);
+
+			CopyFrom(patched, payload);
+			patched[dispatchItem + 2] = (vint32_t)stateInstructionCount;
+			TEST_EXCEPTION(LoadPatchedRichInterpretor(header, patched), regex::RegexImageException, assertCorrupted);
+		});
+
+		TEST_CASE(L"Dispatch ranges are sorted and do not overlap")
+		{
+			Array<vint32_t> patched;
+			CopyFrom(patched, payload);
+			for (vint i = 0; i < 3; i++)
+			{
+				patched[dispatchItem + i] = payload[dispatchItem + 3 + i];
+				patched[dispatchItem + 3 + i] = payload[dispatchItem + i];
+			}
+			TEST_EXCEPTION(LoadPatchedRichInterpretor(header, patched), regex::RegexImageException, assertCorrupted);
+
+			CopyFrom(patched, payload);
+			patched[dispatchItem + 3] = payload[dispatchItem + 1];
+			TEST_EXCEPTION(LoadPatchedRichInterpretor(header, patched), regex::RegexImageException, assertCorrupted);
+		});
+
+		TEST_CASE(L"Instruction operands are checked")
+		{
+			RichProgramHeader matchHeader;
+			Array<vint32_t> matchPayload;
+			{
+				MemoryStream stream;
+				BuildRichInterpretor(U"(<x>a)(<$x>)")->Serialize(stream);
+				stream.SeekFromBegin(0);
+				stream.Read(&matchHeader, sizeof(matchHeader));
+				matchPayload.Resize(matchHeader.payloadCount);
+				stream.Read(&matchPayload[0], sizeof(vint32_t) * matchPayload.Count());
+			}
+			LoadPatchedRichInterpretor(matchHeader, matchPayload);
+
+			vint firstMatchInstructionItem = 4 + 6 * matchPayload[0];
+			vint matchItem = -1;
+			vint charsItem = -1;
+			for (vint i = 0; i < matchPayload[1]; i++)
+			{
+				vint item = firstMatchInstructionItem + 8 * i;
+				if (matchPayload[item] == Transition::Match && matchItem == -1) matchItem = item;
+				if (matchPayload[item] == Transition::Chars && charsItem == -1) charsItem = item;
+			}
+			TEST_ASSERT(matchItem != -1);
+			TEST_ASSERT(charsItem != -1);
+
+			Array<vint32_t> patched;
+			CopyFrom(patched, matchPayload);
+			patched[matchItem + 6] = -2;
+			TEST_EXCEPTION(LoadPatchedRichInterpretor(matchHeader, patched), regex::RegexImageException, assertCorrupted);
+
+			CopyFrom(patched, matchPayload);
+			patched[charsItem + 3] = patched[charsItem + 4] + 1;
+			TEST_EXCEPTION(LoadPatchedRichInterpretor(matchHeader, patched), regex::RegexImageException, assertCorrupted);
+		});
+	});
 }
\ No newline at end of file
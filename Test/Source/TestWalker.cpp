@@ -160,6 +160,54 @@ void AssertUnicodeWalker(RegexLexer& wordLexer, RegexLexer& scalarLexer, RegexLe
 	}
 }
 
+template<typename T>
+void AssertWalkRange(RegexLexer& lexer, const ObjectString<T>& input)
+{
+	auto walker = lexer.Walk<T>();
+	List<RegexWalkEvent> expected;
+	vint state = walker.GetStartState();
+	vint start = 0;
+	for (vint i = 0; i < input.Length(); i++)
+	{
+		vuint32_t unit = (vuint32_t)input[i];
+		bool continuation = sizeof(T) == 1 ? (unit & 0xC0) == 0x80 : sizeof(T) == 2 ? 0xDC00 <= unit && unit <= 0xDFFF : false;
+		if (!continuation)
+		{
+			start = i;
+		}
+
+		vint token = -1;
+		bool finalState = false;
+		bool previousTokenStop = false;
+		walker.Walk(input[i], state, token, finalState, previousTokenStop);
+		if (finalState || previousTokenStop)
+		{
+			RegexWalkEvent event;
+			event.start = start;
+			event.length = i + 1 - start;
+			event.state = state;
+			event.token = token;
+			event.finalState = finalState;
+			event.previousTokenStop = previousTokenStop;
+			expected.Add(event);
+		}
+	}
+
+	auto rangeWalker = lexer.Walk<T>();
+	List<RegexWalkEvent> events;
+	TEST_ASSERT(rangeWalker.WalkRange(input.Buffer(), input.Length(), rangeWalker.GetStartState(), events) == state);
+	TEST_ASSERT(events.Count() == expected.Count());
+	for (vint i = 0; i < events.Count(); i++)
+	{
+		TEST_ASSERT(events[i].start == expected[i].start);
+		TEST_ASSERT(events[i].length == expected[i].length);
+		TEST_ASSERT(events[i].state == expected[i].state);
+		TEST_ASSERT(events[i].token == expected[i].token);
+		TEST_ASSERT(events[i].finalState == expected[i].finalState);
+		TEST_ASSERT(events[i].previousTokenStop == expected[i].previousTokenStop);
+	}
+}
+
 TEST_FILE
 {
 #define WALK(INPUT, TOKEN, RESULT, STOP)\
@@ -245,5 +293,20 @@ TEST_FILE
 		AssertUnicodeWalker(wordLexer, scalarLexer, inverseWordLexer, U32String(U"𦁚"), U32String(U"𦁚A"));
 	});
 
+	TEST_CASE(L"Test RegexLexerWalker::WalkRange")
+	{
+		List<WString> codes;
+		codes.Add(L"/d+(./d+)?");
+		codes.Add(L"[a-zA-Z_]/w*");
+		codes.Add(L"\"[^\"]*\"");
+		codes.Add(L"[𦁚]+");
+		RegexLexer lexer(codes);
+
+		AssertWalkRange(lexer, WString(L" genius 10..10.10   \"\"\"𦁚genius\" 𦁚𦁚vczh 2.5"));
+		AssertWalkRange(lexer, U8String(u8" genius 10..10.10   \"\"\"𦁚genius\" 𦁚𦁚vczh 2.5"));
+		AssertWalkRange(lexer, U16String(u" genius 10..10.10   \"\"\"𦁚genius\" 𦁚𦁚vczh 2.5"));
+		AssertWalkRange(lexer, U32String(U" genius 10..10.10   \"\"\"𦁚genius\" 𦁚𦁚vczh 2.5"));
+	});
+
 #undef WALK
 }